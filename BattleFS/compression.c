@@ -1,9 +1,11 @@
 // compression.c
-// Implementacin didctica del algoritmo LZW para compresin y descompresin de archivos binarios en BattleFS.
+// Implementacin didctica del algoritmo LZW para compresin y descompresin de archivos binarios en BattleFS,
+// y un cdec sin prdida para BMP: predictor por fila al estilo PNG y cdigos de Huffman por canal.
 
 #include "compression.h"
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 
 #define MAX_DICT_SIZE 4096
 
@@ -142,3 +144,365 @@ int lzw_decompress(const unsigned char *input, long input_size, unsigned char **
     *output = out;
     return out_pos;
 }
+
+// --- CDEC DE IMGENES BMP ---
+// Un BMP sin compresin de 24 o 32 bits se guarda como:
+//   "BFSI", versin, tamao original, cabeceras tal cual (hasta bfOffBits), datos despus de los
+//   pxeles tal cual, bytes de relleno de las filas tal cual, un filtro por fila, las longitudes
+//   de los cdigos de Huffman de cada canal (4 bits cada una) y los residuos codificados.
+// Cada byte de una fila se predice con el filtro de la fila (ninguno, izquierda, arriba, promedio
+// o Paeth, como en PNG, usando el mismo canal del pxel anterior y de la fila anterior) y se
+// guarda la diferencia. A azul y rojo se les resta adems el residuo del verde, que suele llevar
+// la mayor parte de la variacin. Los residuos quedan cerca de 0 y Huffman los guarda en pocos bits.
+// Un flujo LZW empieza con un cdigo < 4096 (primer byte < 0x10), as que el prefijo "BFSI" no se
+// confunde con l y decompress_data distingue los dos formatos.
+
+#define IMG_MAGIC "BFSI"
+#define IMG_VERSION 1
+#define IMG_MAX_BITS 15
+#define IMG_FILTERS 5
+
+static uint32_t rd_u32(const unsigned char *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void wr_u32(unsigned char *p, uint32_t v) {
+    p[0] = v & 0xFF; p[1] = (v >> 8) & 0xFF; p[2] = (v >> 16) & 0xFF; p[3] = v >> 24;
+}
+
+typedef struct {
+    long offset;     // bfOffBits: inicio de los pxeles
+    int width, rows; // Ancho en pxeles y cantidad de filas
+    int bpp;         // Bytes por pxel: 3 o 4
+    long stride;     // Bytes por fila, con relleno a mltiplo de 4
+} BmpLayout;
+
+// Reconoce un BMP sin compresin de 24 o 32 bits cuyas filas entren en el archivo
+static int bmp_layout(const unsigned char *in, long size, BmpLayout *l) {
+    if (size < 54 || in[0] != 'B' || in[1] != 'M') return 0;
+    uint32_t info = rd_u32(in + 14);
+    if (info < 40 || 14 + (long)info > size) return 0;
+    int32_t w = (int32_t)rd_u32(in + 18), h = (int32_t)rd_u32(in + 22);
+    int bits = in[28] | (in[29] << 8);
+    uint32_t comp = rd_u32(in + 30);
+    if (w <= 0 || h == 0 || h == INT32_MIN || (bits != 24 && bits != 32)) return 0;
+    if (comp != 0 && !(comp == 3 && bits == 32)) return 0; // BI_RGB, o BI_BITFIELDS de 32 bits
+    l->offset = rd_u32(in + 10);
+    l->width = w;
+    l->rows = h < 0 ? -h : h;
+    l->bpp = bits / 8;
+    l->stride = (((long)w * bits + 31) / 32) * 4;
+    if (l->offset < 14 + (long)info || l->offset > size) return 0;
+    return l->stride * l->rows <= size - l->offset;
+}
+
+static int paeth(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+    if (pa <= pb && pa <= pc) return a;
+    return pb <= pc ? b : c;
+}
+
+// Prediccin del byte i de la fila con el filtro f (prev es NULL en la primera fila)
+static inline int predict(int f, const unsigned char *row, const unsigned char *prev, long i, int bpp) {
+    int a = i >= bpp ? row[i - bpp] : 0;
+    int b = prev ? prev[i] : 0;
+    int c = prev && i >= bpp ? prev[i - bpp] : 0;
+    switch (f) {
+    case 1: return a;
+    case 2: return b;
+    case 3: return (a + b) >> 1;
+    case 4: return paeth(a, b, c);
+    default: return 0;
+    }
+}
+
+// Residuos de una fila con el filtro f, con azul y rojo relativos al verde
+static void row_residuals(int f, const unsigned char *row, const unsigned char *prev, long n, int bpp,
+                          unsigned char *res) {
+    for (long i = 0; i < n; i++)
+        res[i] = (unsigned char)(row[i] - predict(f, row, prev, i, bpp));
+    for (long i = 0; i + 2 < n; i += bpp) {
+        res[i] = (unsigned char)(res[i] - res[i + 1]);
+        res[i + 2] = (unsigned char)(res[i + 2] - res[i + 1]);
+    }
+}
+
+// --- Huffman cannico ---
+
+typedef struct {
+    long count;
+    int left, right;
+} HuffNode;
+
+// Longitudes de cdigo (mximo IMG_MAX_BITS) para las frecuencias dadas. Si el rbol queda ms
+// profundo, se aplanan las frecuencias y se vuelve a construir.
+static void huff_lengths(const long freq[256], unsigned char len[256]) {
+    long f[256];
+    memcpy(f, freq, sizeof(f));
+    for (;;) {
+        HuffNode nodes[512];
+        int alive[512], n = 0, used = 0;
+        for (int s = 0; s < 256; s++) {
+            len[s] = 0;
+            if (!f[s]) continue;
+            nodes[n].count = f[s];
+            nodes[n].left = nodes[n].right = -1 - s; // Hoja: -1 - smbolo
+            alive[used++] = n++;
+        }
+        if (used == 0) return;
+        if (used == 1) { len[-1 - nodes[0].left] = 1; return; }
+        // Uniones de los dos menores (256 hojas como mximo: la bsqueda lineal alcanza)
+        while (used > 1) {
+            int m1 = 0, m2 = 1;
+            if (nodes[alive[m2]].count < nodes[alive[m1]].count) { m1 = 1; m2 = 0; }
+            for (int i = 2; i < used; i++) {
+                long c = nodes[alive[i]].count;
+                if (c < nodes[alive[m1]].count) { m2 = m1; m1 = i; }
+                else if (c < nodes[alive[m2]].count) m2 = i;
+            }
+            nodes[n].count = nodes[alive[m1]].count + nodes[alive[m2]].count;
+            nodes[n].left = alive[m1];
+            nodes[n].right = alive[m2];
+            int hi = m1 > m2 ? m1 : m2, lo = m1 < m2 ? m1 : m2;
+            alive[hi] = alive[--used];
+            alive[lo] = n++;
+        }
+        // Profundidad de cada hoja recorriendo desde la raz con una pila
+        int stack[512], depth[512], sp = 0, max_depth = 0;
+        stack[sp] = alive[0]; depth[sp++] = 0;
+        while (sp > 0) {
+            sp--;
+            int node = stack[sp], d = depth[sp];
+            if (nodes[node].left < 0) {
+                len[-1 - nodes[node].left] = (unsigned char)d;
+                if (d > max_depth) max_depth = d;
+                continue;
+            }
+            stack[sp] = nodes[node].left; depth[sp++] = d + 1;
+            stack[sp] = nodes[node].right; depth[sp++] = d + 1;
+        }
+        if (max_depth <= IMG_MAX_BITS) return;
+        for (int s = 0; s < 256; s++)
+            if (f[s]) f[s] = (f[s] >> 1) | 1;
+    }
+}
+
+// Cdigos cannicos: por longitud creciente y, a igual longitud, por smbolo
+static void huff_codes(const unsigned char len[256], unsigned short code[256]) {
+    int count[IMG_MAX_BITS + 1] = {0}, next[IMG_MAX_BITS + 2];
+    for (int s = 0; s < 256; s++) count[len[s]]++;
+    count[0] = 0;
+    next[1] = 0;
+    for (int b = 1; b <= IMG_MAX_BITS; b++) next[b + 1] = (next[b] + count[b]) << 1;
+    for (int s = 0; s < 256; s++)
+        if (len[s]) code[s] = (unsigned short)next[len[s]]++;
+}
+
+typedef struct {
+    unsigned char *out;
+    long pos;
+    uint64_t acc;
+    int bits;
+} BitWriter;
+
+static inline void bits_put(BitWriter *w, unsigned code, int n) {
+    w->acc = (w->acc << n) | code;
+    w->bits += n;
+    while (w->bits >= 8) {
+        w->bits -= 8;
+        w->out[w->pos++] = (unsigned char)(w->acc >> w->bits);
+    }
+}
+
+static void bits_flush(BitWriter *w) {
+    if (w->bits > 0) w->out[w->pos++] = (unsigned char)(w->acc << (8 - w->bits));
+    w->bits = 0;
+}
+
+int image_compress(const unsigned char *input, long input_size, unsigned char **output) {
+    BmpLayout l;
+    if (!input || !bmp_layout(input, input_size, &l)) return 0;
+    long n = (long)l.width * l.bpp;               // Bytes de pxeles por fila
+    long pad = l.stride - n;
+    long pix_end = l.offset + l.stride * l.rows;
+    long tail = input_size - pix_end;
+
+    unsigned char *res = malloc((size_t)n * l.rows);
+    unsigned char *filters = malloc(l.rows);
+    unsigned char *cand = malloc((size_t)n);
+    if (!res || !filters || !cand) { free(res); free(filters); free(cand); return 0; }
+
+    // Filtro de cada fila: el de menor suma de residuos en valor absoluto (la heurstica de PNG)
+    long freq[4][256];
+    memset(freq, 0, sizeof(freq));
+    for (int y = 0; y < l.rows; y++) {
+        const unsigned char *row = input + l.offset + (long)y * l.stride;
+        const unsigned char *prev = y > 0 ? row - l.stride : NULL;
+        unsigned char *best = res + (long)y * n;
+        long best_cost = -1;
+        for (int f = 0; f < IMG_FILTERS; f++) {
+            row_residuals(f, row, prev, n, l.bpp, cand);
+            long cost = 0;
+            for (long i = 0; i < n; i++) cost += cand[i] < 128 ? cand[i] : 256 - cand[i];
+            if (best_cost < 0 || cost < best_cost) {
+                best_cost = cost;
+                filters[y] = (unsigned char)f;
+                memcpy(best, cand, n);
+            }
+        }
+        for (long i = 0; i < n; i++) freq[i % l.bpp][best[i]]++;
+    }
+    free(cand);
+
+    unsigned char len[4][256];
+    unsigned short code[4][256];
+    long bits_total = 0;
+    for (int c = 0; c < l.bpp; c++) {
+        huff_lengths(freq[c], len[c]);
+        huff_codes(len[c], code[c]);
+        for (int s = 0; s < 256; s++) bits_total += freq[c][s] * len[c][s];
+    }
+
+    long head = 4 + 1 + 4 + 4 + 4 + 4;
+    long size = head + l.offset + tail + pad * l.rows + l.rows + 128L * l.bpp + (bits_total + 7) / 8;
+    unsigned char *out = malloc(size);
+    if (!out) { free(res); free(filters); return 0; }
+    memcpy(out, IMG_MAGIC, 4);
+    out[4] = IMG_VERSION;
+    wr_u32(out + 5, (uint32_t)input_size);
+    wr_u32(out + 9, (uint32_t)l.offset);
+    wr_u32(out + 13, (uint32_t)tail);
+    wr_u32(out + 17, (uint32_t)((bits_total + 7) / 8));
+    long pos = head;
+    memcpy(out + pos, input, l.offset); pos += l.offset;
+    memcpy(out + pos, input + pix_end, tail); pos += tail;
+    for (int y = 0; y < l.rows; y++) {
+        memcpy(out + pos, input + l.offset + (long)y * l.stride + n, pad);
+        pos += pad;
+    }
+    memcpy(out + pos, filters, l.rows); pos += l.rows;
+    for (int c = 0; c < l.bpp; c++)
+        for (int s = 0; s < 256; s += 2) out[pos++] = (unsigned char)(len[c][s] | (len[c][s + 1] << 4));
+
+    BitWriter w = { out, pos, 0, 0 };
+    for (int y = 0; y < l.rows; y++) {
+        const unsigned char *r = res + (long)y * n;
+        for (long i = 0; i < n; i += l.bpp)
+            for (int c = 0; c < l.bpp; c++) bits_put(&w, code[c][r[i + c]], len[c][r[i + c]]);
+    }
+    bits_flush(&w);
+
+    free(res);
+    free(filters);
+    *output = out;
+    return (int)w.pos;
+}
+
+// Tabla de decodificacin: para cada valor de los prximos IMG_MAX_BITS bits, smbolo y largo
+typedef struct {
+    unsigned char symbol, length;
+} HuffEntry;
+
+static int huff_table(const unsigned char len[256], HuffEntry *table) {
+    unsigned short code[256];
+    long filled = 0;
+    huff_codes(len, code);
+    for (int s = 0; s < 256; s++) {
+        if (!len[s]) continue;
+        int shift = IMG_MAX_BITS - len[s];
+        long first = (long)code[s] << shift, count = 1L << shift;
+        if (first + count > (1L << IMG_MAX_BITS)) return 0;
+        for (long i = 0; i < count; i++) {
+            table[first + i].symbol = (unsigned char)s;
+            table[first + i].length = len[s];
+        }
+        filled += count;
+    }
+    // Un solo smbolo usa medio espacio de cdigos; con ms, los largos deben completar el rbol
+    return filled == (1L << IMG_MAX_BITS) || filled == (1L << (IMG_MAX_BITS - 1));
+}
+
+int image_decompress(const unsigned char *input, long input_size, unsigned char **output) {
+    if (!input || input_size < 21 || memcmp(input, IMG_MAGIC, 4) != 0 || input[4] != IMG_VERSION) return 0;
+    long size = rd_u32(input + 5), offset = rd_u32(input + 9), tail = rd_u32(input + 13), bytes = rd_u32(input + 17);
+    long pos = 21;
+    if (offset > input_size - pos) return 0;
+    BmpLayout l;
+    if (!bmp_layout(input + pos, offset >= 54 ? size : 0, &l) || l.offset != offset) return 0;
+    long n = (long)l.width * l.bpp, pad = l.stride - n;
+    if (offset + l.stride * l.rows + tail != size) return 0;
+    long need = offset + tail + pad * l.rows + l.rows + 128L * l.bpp;
+    if (need > input_size - pos || bytes > input_size - pos - need) return 0;
+
+    unsigned char *out = malloc(size);
+    HuffEntry *tables = malloc(sizeof(HuffEntry) * 4 << IMG_MAX_BITS);
+    if (!out || !tables) { free(out); free(tables); return 0; }
+    memset(tables, 0, sizeof(HuffEntry) * 4 << IMG_MAX_BITS);
+    memcpy(out, input + pos, offset); pos += offset;
+    memcpy(out + offset + l.stride * l.rows, input + pos, tail); pos += tail;
+    for (int y = 0; y < l.rows; y++) {
+        memcpy(out + offset + (long)y * l.stride + n, input + pos, pad);
+        pos += pad;
+    }
+    const unsigned char *filters = input + pos;
+    pos += l.rows;
+    int ok = 1;
+    for (int c = 0; c < l.bpp && ok; c++) {
+        unsigned char len[256];
+        for (int s = 0; s < 256; s += 2) {
+            len[s] = input[pos] & 0x0F;
+            len[s + 1] = input[pos++] >> 4;
+        }
+        ok = huff_table(len, tables + ((long)c << IMG_MAX_BITS));
+    }
+
+    // Lectura de bits con un acumulador de 64: se recarga de a bytes y se miran IMG_MAX_BITS por vez
+    const unsigned char *src = input + pos, *end = src + bytes;
+    uint64_t acc = 0;
+    int bits = 0;
+    for (int y = 0; y < l.rows && ok; y++) {
+        unsigned char *row = out + offset + (long)y * l.stride;
+        const unsigned char *prev = y > 0 ? row - l.stride : NULL;
+        int f = filters[y];
+        if (f >= IMG_FILTERS) { ok = 0; break; }
+        for (long i = 0; i < n; i += l.bpp) {
+            unsigned char r[4];
+            for (int c = 0; c < l.bpp; c++) {
+                while (bits <= 56) {
+                    acc = (acc << 8) | (src < end ? *src : 0);
+                    src++;
+                    bits += 8;
+                }
+                const HuffEntry *e = tables + ((long)c << IMG_MAX_BITS) + ((acc >> (bits - IMG_MAX_BITS)) & ((1 << IMG_MAX_BITS) - 1));
+                r[c] = e->symbol;
+                bits -= e->length;
+            }
+            if (l.bpp >= 3) {
+                r[0] = (unsigned char)(r[0] + r[1]);
+                r[2] = (unsigned char)(r[2] + r[1]);
+            }
+            for (int c = 0; c < l.bpp; c++)
+                row[i + c] = (unsigned char)(r[c] + predict(f, row, prev, i + c, l.bpp));
+        }
+    }
+    // Los bits ledos no pueden pasar del final del flujo (los de relleno del ltimo byte s)
+    if (ok && (src - (input + pos)) * 8 - bits > bytes * 8) ok = 0;
+    free(tables);
+    if (!ok) { free(out); return 0; }
+    *output = out;
+    return (int)size;
+}
+
+int compress_data(const unsigned char *input, long input_size, unsigned char **output) {
+    int size = image_compress(input, input_size, output);
+    if (size > 0 && size < input_size) return size;
+    if (size > 0) free(*output); // Imagen sin estructura (ruido) o muy chica: no gana nada
+    return lzw_compress(input, input_size, output);
+}
+
+int decompress_data(const unsigned char *input, long input_size, unsigned char **output) {
+    if (input_size >= 4 && memcmp(input, IMG_MAGIC, 4) == 0)
+        return image_decompress(input, input_size, output);
+    return lzw_decompress(input, input_size, output);
+}
@@ -5,4 +5,13 @@
 int lzw_compress(const unsigned char *input, long input_size, unsigned char **output);
 int lzw_decompress(const unsigned char *input, long input_size, unsigned char **output);
 
+// Cdec sin prdida para BMP de 24/32 bits (predictor PNG + Huffman por canal).
+// image_compress devuelve 0 si la entrada no es un BMP que sepa comprimir.
+int image_compress(const unsigned char *input, long input_size, unsigned char **output);
+int image_decompress(const unsigned char *input, long input_size, unsigned char **output);
+
+// Eligen el cdec: imagen para los BMP que lo admiten, LZW para el resto.
+int compress_data(const unsigned char *input, long input_size, unsigned char **output);
+int decompress_data(const unsigned char *input, long input_size, unsigned char **output);
+
 #endif
@@ -6,9 +6,18 @@
 #include <string.h>
 #include <dirent.h>
 #include <pthread.h>
+#include <signal.h>
 #include <sys/stat.h>
+#include <sys/time.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
 
 static FileIndex *fi = NULL;
+// Protege fi: filesystem_create se ejecuta en paralelo desde create_all
+static pthread_mutex_t fi_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 const char* basename(const char* filepath) {
     const char* p1 = strrchr(filepath, '\\');
@@ -24,72 +33,342 @@ int is_already_compressed(const char *filename, const char *comp_dir) {
     return stat(comp_path, &st) == 0;
 }
 
+static double now_seconds() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
 void filesystem_init() {
     if (fi) fileindex_free(fi);
     fi = fileindex_create();
     printf("Sistema limpio.\n");
 }
 
-void filesystem_create(const char *filepath, const char *comp_dir) {
+// Comprime un archivo y lo agrega al ndice.
+// Si io_seconds no es NULL, recibe el tiempo gastado en lectura/escritura de disco.
+// Devuelve 1 si se comprimi, 0 si ya exista comprimido (omitido) y -1 si hubo error.
+static int compress_one(const char *filepath, const char *comp_dir, double *io_seconds) {
+    double t0 = now_seconds();
+    if (io_seconds) *io_seconds = 0;
     const char *file = basename(filepath);
     if (is_already_compressed(file, comp_dir)) {
         printf("Ya existe comprimido: %s.lzw (omitido)\n", file);
-        return;
+        return 0;
     }
     FILE *f = fopen(filepath, "rb");
-    if (!f) { printf("No se pudo abrir %s\n", filepath); return; }
+    if (!f) { printf("No se pudo abrir %s\n", filepath); return -1; }
     fseek(f, 0, SEEK_END);
     long sz = ftell(f);
     fseek(f, 0, SEEK_SET);
 
-    if (sz <= 0) { fclose(f); printf("Archivo vaco o no legible: %s\n", filepath); return; }
+    if (sz <= 0) { fclose(f); printf("Archivo vaco o no legible: %s\n", filepath); return -1; }
 
     unsigned char *buf = (unsigned char*)malloc(sz);
-    if (!buf) { fclose(f); printf("Sin memoria para %s\n", filepath); return; }
+    if (!buf) { fclose(f); printf("Sin memoria para %s\n", filepath); return -1; }
     size_t read = fread(buf, 1, sz, f);
     fclose(f);
 
-    if ((long)read != sz) { free(buf); printf("Error al leer %s\n", filepath); return; }
+    if ((long)read != sz) { free(buf); printf("Error al leer %s\n", filepath); return -1; }
+    if (io_seconds) *io_seconds += now_seconds() - t0;
 
     unsigned char *comp = NULL;
-    int comp_sz = lzw_compress(buf, sz, &comp);
+    int comp_sz = compress_data(buf, sz, &comp);
 
-    if (!comp || comp_sz <= 0) { free(buf); printf("Error al comprimir %s\n", filepath); return; }
+    if (!comp || comp_sz <= 0) { free(buf); printf("Error al comprimir %s\n", filepath); return -1; }
 
-    char comp_path[512];
+    // Se escribe a un temporal y se renombra: un .lzw a medio escribir (por un corte)
+    // nunca se confunde con uno completo al reanudar
+    t0 = now_seconds();
+    char comp_path[512], tmp_path[520];
     snprintf(comp_path, sizeof(comp_path), "%s/%s.lzw", comp_dir, file);
-    FILE *cf = fopen(comp_path, "wb");
-    if (!cf) { printf("No se pudo guardar comprimido en %s\n", comp_path); free(buf); free(comp); return; }
-    fwrite(comp, 1, comp_sz, cf);
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", comp_path);
+    FILE *cf = fopen(tmp_path, "wb");
+    if (!cf) { printf("No se pudo guardar comprimido en %s\n", comp_path); free(buf); free(comp); return -1; }
+    size_t written = fwrite(comp, 1, comp_sz, cf);
     fclose(cf);
+    if (written != (size_t)comp_sz || rename(tmp_path, comp_path) != 0) {
+        printf("No se pudo guardar comprimido en %s\n", comp_path);
+        remove(tmp_path);
+        free(buf);
+        free(comp);
+        return -1;
+    }
+    if (io_seconds) *io_seconds += now_seconds() - t0;
 
+    pthread_mutex_lock(&fi_mutex);
     fileindex_insert(fi, file, sz, comp_sz, comp);
+    pthread_mutex_unlock(&fi_mutex);
 
     free(buf);
     free(comp);
 
     int percent = sz > 0 ? (100 * (sz - comp_sz)) / sz : 0;
     printf("Comprimido y guardado: %s -> %s.lzw (Ahorro: %d%%)\n", file, file, percent);
+    return 1;
+}
+
+void filesystem_create(const char *filepath, const char *comp_dir) {
+    compress_one(filepath, comp_dir, NULL);
+}
+
+// --- Compresin masiva reanudable ---
+// create_all lleva un checkpoint en <comp_dir>/create_all.ckpt con una lnea
+// "<tamao original>\t<nombre>" por cada archivo terminado. Si el trabajo se cancela
+// (Ctrl+C) o se corta, la siguiente ejecucin recupera esos archivos desde su .lzw
+// en vez de volver a comprimirlos. El checkpoint se borra al completar sin errores.
+
+#define CHECKPOINT_NAME "create_all.ckpt"
+#define PROGRESS_INTERVAL 1.0
+
+static volatile sig_atomic_t cancel_requested = 0;
+
+void filesystem_cancel() {
+    cancel_requested = 1;
+}
+
+static void on_sigint(int sig) {
+    (void)sig;
+    cancel_requested = 1;
+}
+
+typedef struct {
+    char name[256];
+    long size_original;
+} CheckpointEntry;
+
+static int compare_checkpoint(const void *a, const void *b) {
+    return strcmp(((const CheckpointEntry*)a)->name, ((const CheckpointEntry*)b)->name);
+}
+
+// Carga el checkpoint ordenado por nombre para buscar con bsearch. Devuelve la cantidad de entradas
+static int checkpoint_load(const char *path, CheckpointEntry **out) {
+    *out = NULL;
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+    int count = 0, capacity = 0;
+    CheckpointEntry *list = NULL;
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        char *tab = strchr(line, '\t');
+        if (!tab) continue;
+        *tab = '\0';
+        char *name = tab + 1;
+        name[strcspn(name, "\r\n")] = '\0';
+        if (!*name) continue;
+        if (count >= capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            CheckpointEntry *grown = realloc(list, sizeof(CheckpointEntry) * capacity);
+            if (!grown) break;
+            list = grown;
+        }
+        strncpy(list[count].name, name, sizeof(list[count].name) - 1);
+        list[count].name[sizeof(list[count].name) - 1] = '\0';
+        list[count].size_original = atol(line);
+        count++;
+    }
+    fclose(f);
+    qsort(list, count, sizeof(CheckpointEntry), compare_checkpoint);
+    *out = list;
+    return count;
+}
+
+// Recupera en el ndice un archivo ya terminado en una ejecucin anterior, leyendo su .lzw
+static int checkpoint_restore(const CheckpointEntry *ce, const char *comp_dir) {
+    char comp_path[512];
+    snprintf(comp_path, sizeof(comp_path), "%s/%s.lzw", comp_dir, ce->name);
+    FILE *cf = fopen(comp_path, "rb");
+    if (!cf) return 0;
+    fseek(cf, 0, SEEK_END);
+    long comp_sz = ftell(cf);
+    fseek(cf, 0, SEEK_SET);
+    unsigned char *data = comp_sz > 0 ? malloc(comp_sz) : NULL;
+    if (!data || fread(data, 1, comp_sz, cf) != (size_t)comp_sz) {
+        free(data);
+        fclose(cf);
+        return 0;
+    }
+    fclose(cf);
+    pthread_mutex_lock(&fi_mutex);
+    if (fileindex_find(fi, ce->name) == -1)
+        fileindex_insert(fi, ce->name, ce->size_original, (int)comp_sz, data);
+    pthread_mutex_unlock(&fi_mutex);
+    free(data);
+    return 1;
+}
+
+typedef struct {
+    char name[256];
+    long size;
+} PendingFile;
+
+// --- Control adaptativo de concurrencia ---
+// En modo automtico create_all arranca con un hilo por CPU en lnea y cada ADAPT_INTERVAL
+// segundos compara el rendimiento de la ventana con la anterior (bsqueda por escalada):
+// si mejor sigue en la misma direccin, si empeor la invierte. Si los hilos pasan ms de
+// IO_WAIT_HIGH de su tiempo esperando disco y agregar hilos no mejor, se reduce la cantidad.
+// Adems, los buffers en vuelo (entrada + salida LZW, ~3x el tamao del archivo) no pueden
+// superar el lmite de memoria configurado.
+
+#define ADAPT_INTERVAL 2.0
+#define IO_WAIT_HIGH 0.5
+#define MAX_WORKERS_PER_CPU 4
+#define DEFAULT_MEMORY_LIMIT_MB 256
+#define BUFFER_FACTOR 3
+
+static long long memory_limit = DEFAULT_MEMORY_LIMIT_MB * 1024LL * 1024LL;
+
+void filesystem_set_memory_limit(long megabytes) {
+    if (megabytes <= 0) megabytes = DEFAULT_MEMORY_LIMIT_MB;
+    memory_limit = megabytes * 1024LL * 1024LL;
+    printf("Lmite de memoria para create_all: %ld MB\n", megabytes);
+}
+
+static int online_cpus() {
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return si.dwNumberOfProcessors > 0 ? (int)si.dwNumberOfProcessors : 1;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
 }
 
+// Estado compartido de un trabajo create_all. Los hilos toman archivos de pending con next.
+// Solo los hilos con id < target trabajan; el resto queda en espera hasta que el control los active.
+typedef struct {
+    const char *folder_path;
+    const char *comp_dir;
+    PendingFile *pending;
+    int total;
+    int next;
+    int done, skipped, failed;
+    long long bytes_total, bytes_done;
+    double start, last_report;
+    FILE *ckpt;
+    int adaptive;                 // 1 si la cantidad de hilos se ajusta sola
+    int target;                   // Hilos activos deseados
+    int max_workers;              // Hilos creados (tope de target)
+    int direction;                // +1 o -1: ltimo sentido del ajuste
+    double window_start;          // Inicio de la ventana de medicin actual
+    long long window_bytes;       // Bytes terminados en la ventana
+    double window_io, window_cpu; // Segundos de E/S y de CPU de los archivos de la ventana
+    double last_rate;             // Rendimiento de la ventana anterior (bytes/s)
+    long long inflight_bytes;     // Memoria reservada por archivos en proceso
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} BulkJob;
+
 typedef struct {
-    char filepath[512];
-    char comp_dir[512];
-} CompressTask;
-
-void* compress_file_thread(void* arg) {
-    CompressTask* task = (CompressTask*)arg;
-    filesystem_create(task->filepath, task->comp_dir);
-    free(task);
+    BulkJob *job;
+    int id;
+} BulkWorker;
+
+// Imprime archivos completados, rendimiento y tiempo estimado restante. Llamar con job->lock tomado.
+static void report_progress(BulkJob *job, int force) {
+    double now = now_seconds();
+    if (!force && now - job->last_report < PROGRESS_INTERVAL) return;
+    job->last_report = now;
+    double elapsed = now - job->start;
+    double rate = elapsed > 0 ? job->bytes_done / elapsed : 0;
+    int processed = job->done + job->skipped + job->failed;
+    long eta = rate > 0 ? (long)((job->bytes_total - job->bytes_done) / rate) : 0;
+    printf("[Progreso] %d/%d archivos, %.2f MB/s, %d hilos, ETA %02ld:%02ld:%02ld\n",
+           processed, job->total, rate / (1024.0 * 1024.0), job->target, eta / 3600, (eta / 60) % 60, eta % 60);
+}
+
+// Ajusta job->target segn la ventana de medicin. Llamar con job->lock tomado.
+static void adapt_workers(BulkJob *job) {
+    double now = now_seconds();
+    double dt = now - job->window_start;
+    if (!job->adaptive || dt < ADAPT_INTERVAL || job->window_bytes == 0) return;
+
+    double rate = job->window_bytes / dt;
+    double busy = job->window_io + job->window_cpu;
+    double io_share = busy > 0 ? job->window_io / busy : 0;
+
+    if (job->last_rate > 0 && rate < job->last_rate * 0.95)
+        job->direction = -job->direction;
+    if (job->direction > 0 && io_share > IO_WAIT_HIGH && rate <= job->last_rate * 1.05)
+        job->direction = -1;
+
+    int target = job->target + job->direction;
+    if (target < 1) { target = 1; job->direction = 1; }
+    if (target > job->max_workers) { target = job->max_workers; job->direction = -1; }
+    if (target != job->target) {
+        printf("[Hilos] %d -> %d (%.2f MB/s, E/S %.0f%%)\n",
+               job->target, target, rate / (1024.0 * 1024.0), io_share * 100);
+        job->target = target;
+        pthread_cond_broadcast(&job->cond);
+    }
+    job->last_rate = rate;
+    job->window_start = now;
+    job->window_bytes = 0;
+    job->window_io = job->window_cpu = 0;
+}
+
+// Espera en la condicin del trabajo con un plazo corto, para notar la cancelacin (Ctrl+C)
+static void job_wait(BulkJob *job) {
+    struct timeval tv;
+    struct timespec ts;
+    gettimeofday(&tv, NULL);
+    long usec = tv.tv_usec + 200000;
+    ts.tv_sec = tv.tv_sec + usec / 1000000;
+    ts.tv_nsec = (usec % 1000000) * 1000;
+    pthread_cond_timedwait(&job->cond, &job->lock, &ts);
+}
+
+static void* bulk_worker(void *arg) {
+    BulkWorker *w = (BulkWorker*)arg;
+    BulkJob *job = w->job;
+    pthread_mutex_lock(&job->lock);
+    while (!cancel_requested && job->next < job->total) {
+        // Hilo sobrante segn el control adaptativo: queda en espera
+        if (w->id >= job->target) { job_wait(job); continue; }
+        // Respeta el lmite de memoria, salvo que no haya nada en vuelo (un archivo enorme igual avanza)
+        long long need = (long long)job->pending[job->next].size * BUFFER_FACTOR;
+        if (job->inflight_bytes > 0 && job->inflight_bytes + need > memory_limit) { job_wait(job); continue; }
+
+        int i = job->next++;
+        job->inflight_bytes += need;
+        pthread_mutex_unlock(&job->lock);
+
+        PendingFile *pf = &job->pending[i];
+        char filepath[512];
+        snprintf(filepath, sizeof(filepath), "%s/%s", job->folder_path, pf->name);
+        double t0 = now_seconds(), io = 0;
+        int r = compress_one(filepath, job->comp_dir, &io);
+        double total_time = now_seconds() - t0;
+
+        pthread_mutex_lock(&job->lock);
+        job->inflight_bytes -= need;
+        pthread_cond_broadcast(&job->cond);
+        if (r > 0) {
+            job->done++;
+            if (job->ckpt) {
+                fprintf(job->ckpt, "%ld\t%s\n", pf->size, pf->name);
+                fflush(job->ckpt);
+            }
+        } else if (r == 0) {
+            job->skipped++;
+        } else {
+            job->failed++;
+        }
+        job->bytes_done += pf->size;
+        job->window_bytes += pf->size;
+        job->window_io += io;
+        job->window_cpu += total_time > io ? total_time - io : 0;
+        adapt_workers(job);
+        report_progress(job, 0);
+    }
+    pthread_mutex_unlock(&job->lock);
     return NULL;
 }
 
 void filesystem_create_all_threads(const char *folder_path, const char *comp_dir, int max_threads) {
     DIR *dir;
     struct dirent *entry;
-    pthread_t threads[16];
-    int thread_count = 0;
-    int total_files = 0;
 
     dir = opendir(folder_path);
     if (!dir) {
@@ -97,6 +376,18 @@ void filesystem_create_all_threads(const char *folder_path, const char *comp_dir
         return;
     }
 
+    char ckpt_path[512];
+    snprintf(ckpt_path, sizeof(ckpt_path), "%s/%s", comp_dir, CHECKPOINT_NAME);
+    CheckpointEntry *finished = NULL;
+    int finished_count = checkpoint_load(ckpt_path, &finished);
+
+    BulkJob job;
+    memset(&job, 0, sizeof(job));
+    job.folder_path = folder_path;
+    job.comp_dir = comp_dir;
+    int capacity = 0, resumed = 0;
+
+    // Primera pasada: lista de pendientes (con tamaos para la ETA) y recuperacin del checkpoint
     while ((entry = readdir(dir)) != NULL) {
         if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
             continue;
@@ -106,32 +397,106 @@ void filesystem_create_all_threads(const char *folder_path, const char *comp_dir
         size_t len = strlen(entry->d_name);
         if (len > 4 && strcmp(entry->d_name + len - 4, ".lzw") == 0)
             continue;
+        if (len >= sizeof(job.pending[0].name))
+            continue;
 
-        char filepath[512];
-        snprintf(filepath, sizeof(filepath), "%s/%s", folder_path, entry->d_name);
-
-        CompressTask* task = malloc(sizeof(CompressTask));
-        strncpy(task->filepath, filepath, sizeof(task->filepath)-1);
-        task->filepath[sizeof(task->filepath)-1] = '\0';
-        strncpy(task->comp_dir, comp_dir, sizeof(task->comp_dir)-1);
-        task->comp_dir[sizeof(task->comp_dir)-1] = '\0';
-
-        pthread_create(&threads[thread_count], NULL, compress_file_thread, task);
-        thread_count++;
-        total_files++;
+        CheckpointEntry key;
+        strcpy(key.name, entry->d_name);
+        CheckpointEntry *ce = finished_count > 0
+            ? bsearch(&key, finished, finished_count, sizeof(CheckpointEntry), compare_checkpoint) : NULL;
+        if (ce && checkpoint_restore(ce, comp_dir)) {
+            resumed++;
+            continue;
+        }
 
-        if (thread_count >= max_threads) {
-            for (int i = 0; i < thread_count; i++)
-                pthread_join(threads[i], NULL);
-            thread_count = 0;
+        if (job.total >= capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            PendingFile *grown = realloc(job.pending, sizeof(PendingFile) * capacity);
+            if (!grown) { printf("Sin memoria para la lista de archivos.\n"); break; }
+            job.pending = grown;
         }
+        PendingFile *pf = &job.pending[job.total++];
+        strcpy(pf->name, entry->d_name);
+        char filepath[512];
+        snprintf(filepath, sizeof(filepath), "%s/%s", folder_path, entry->d_name);
+        struct stat st;
+        pf->size = stat(filepath, &st) == 0 ? (long)st.st_size : 0;
+        job.bytes_total += pf->size;
     }
     closedir(dir);
-
+    free(finished);
+
+    if (resumed > 0)
+        printf("Reanudando: %d archivos ya completados segn el checkpoint.\n", resumed);
+
+    job.ckpt = fopen(ckpt_path, "a");
+    if (!job.ckpt)
+        printf("Aviso: no se pudo abrir el checkpoint %s; el trabajo no ser reanudable.\n", ckpt_path);
+
+    // max_threads <= 0: modo automtico, empieza en un hilo por CPU y se ajusta sobre la marcha
+    int cpus = online_cpus();
+    job.adaptive = max_threads <= 0;
+    job.max_workers = job.adaptive ? cpus * MAX_WORKERS_PER_CPU : max_threads;
+    if (job.max_workers > job.total) job.max_workers = job.total > 0 ? job.total : 1;
+    job.target = job.adaptive ? cpus : job.max_workers;
+    if (job.target > job.max_workers) job.target = job.max_workers;
+    job.direction = 1;
+    if (job.adaptive)
+        printf("Concurrencia automtica: %d CPU, empezando con %d hilos (mximo %d, memoria %lld MB)\n",
+               cpus, job.target, job.max_workers, memory_limit / (1024 * 1024));
+
+    pthread_t *threads = malloc(sizeof(pthread_t) * job.max_workers);
+    BulkWorker *workers = malloc(sizeof(BulkWorker) * job.max_workers);
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.cond, NULL);
+    job.start = job.last_report = job.window_start = now_seconds();
+
+    // Ctrl+C pide una cancelacin cooperativa: cada hilo termina su archivo actual y se detiene
+    cancel_requested = 0;
+    void (*prev_handler)(int) = signal(SIGINT, on_sigint);
+
+    // El id es la cantidad de hilos creados hasta el momento: si falla un pthread_create no quedan
+    // huecos y los hilos con id < target son justamente los que existen
+    int thread_count = 0;
+    for (int i = 0; threads && workers && i < job.max_workers; i++) {
+        workers[thread_count].job = &job;
+        workers[thread_count].id = thread_count;
+        if (pthread_create(&threads[thread_count], NULL, bulk_worker, &workers[thread_count]) == 0)
+            thread_count++;
+    }
+    // Los hilos ya creados leen target y max_workers con el lock tomado
+    pthread_mutex_lock(&job.lock);
+    if (thread_count > 0 && thread_count < job.max_workers) job.max_workers = thread_count;
+    if (thread_count > 0 && thread_count < job.target) job.target = thread_count;
+    pthread_mutex_unlock(&job.lock);
+    if (thread_count == 0) {
+        // Sin hilos disponibles: se procesa todo en el hilo actual
+        BulkWorker self = { &job, 0 };
+        job.max_workers = 1;
+        job.target = 1;
+        bulk_worker(&self);
+    }
     for (int i = 0; i < thread_count; i++)
         pthread_join(threads[i], NULL);
 
-    printf("Completada la compresin multihilo de %d archivos.\n", total_files);
+    signal(SIGINT, prev_handler);
+    free(threads);
+    free(workers);
+    pthread_cond_destroy(&job.cond);
+    pthread_mutex_destroy(&job.lock);
+    report_progress(&job, 1);
+    if (job.ckpt) fclose(job.ckpt);
+
+    if (cancel_requested) {
+        printf("Compresin cancelada: %d de %d archivos procesados. Ejecute create_all de nuevo para reanudar.\n",
+               job.done + job.skipped + job.failed, job.total);
+    } else {
+        if (job.failed == 0) remove(ckpt_path);
+        printf("Completada la compresin multihilo de %d archivos (%d omitidos, %d con error, %d reanudados).\n",
+               job.total, job.skipped, job.failed, resumed);
+    }
+    cancel_requested = 0;
+    free(job.pending);
 }
 
 // Nueva funcin: descomprime y muestra en consola
@@ -169,7 +534,7 @@ void filesystem_read_in_console(const char *filename, const char *comp_dir) {
     }
 
     unsigned char *decomp = NULL;
-    int decomp_sz = lzw_decompress(comp_data, comp_sz, &decomp);
+    int decomp_sz = decompress_data(comp_data, comp_sz, &decomp);
 
     if (decomp_sz <= 0 || !decomp) {
         printf("Error al descomprimir: %s\n", filename);
@@ -190,26 +555,20 @@ void filesystem_read_in_console(const char *filename, const char *comp_dir) {
 }
 
 void filesystem_delete(const char *filename) {
+    pthread_mutex_lock(&fi_mutex);
     if (!fi || fi->count == 0) {
         printf("No hay archivos en el sistema.\n");
+        pthread_mutex_unlock(&fi_mutex);
         return;
     }
-    int idx = -1;
-    for (int i = 0; i < fi->count; i++) {
-        if (strcmp(fi->entries[i].name, filename) == 0) {
-            idx = i;
-            break;
-        }
-    }
+    int idx = fileindex_find(fi, filename);
     if (idx == -1) {
         printf("Archivo no encontrado en el sistema: %s\n", filename);
+        pthread_mutex_unlock(&fi_mutex);
         return;
     }
-    FileEntry *e = &fi->entries[idx];
-    free(e->data);
-    for (int i = idx; i < fi->count - 1; i++)
-        fi->entries[i] = fi->entries[i+1];
-    fi->count--;
+    fileindex_remove(fi, idx);
+    pthread_mutex_unlock(&fi_mutex);
 
     printf("Archivo eliminado del sistema: %s\n", filename);
 
@@ -218,37 +577,138 @@ void filesystem_delete(const char *filename) {
     remove(comp_path);
 }
 
-void filesystem_list() {
+#define LIST_PAGE_SIZE 20
+
+static void print_table_header() {
+    printf("+----------------------+------------+------------+--------+\n");
+    printf("| %-20s | %-10s | %-10s | %-6s |\n", "Archivo", "Original", "Comprimido", "Ahorro");
+    printf("+----------------------+------------+------------+--------+\n");
+}
+
+static void print_table_row(const FileEntry *e) {
+    int percent = e->size_original > 0 ? (100 * (e->size_original - e->size_compressed)) / e->size_original : 0;
+    printf("| %-20s | %10ld | %10d | %5d%% |\n", e->name, e->size_original, e->size_compressed, percent);
+}
+
+static void print_table_footer(int page, int total) {
+    int pages = (total + LIST_PAGE_SIZE - 1) / LIST_PAGE_SIZE;
+    printf("+----------------------+------------+------------+--------+\n");
+    printf("Pgina %d de %d (%d resultados)\n", page, pages > 0 ? pages : 1, total);
+}
+
+// Coincidencia simple de patrones con comodines: '*' (cualquier secuencia) y '?' (un caracter)
+static int glob_match(const char *pat, const char *s) {
+    const char *star = NULL, *resume = NULL;
+    while (*s) {
+        if (*pat == '?' || *pat == *s) { pat++; s++; }
+        else if (*pat == '*') { star = pat++; resume = s; }
+        else if (star) { pat = star + 1; s = ++resume; }
+        else return 0;
+    }
+    while (*pat == '*') pat++;
+    return *pat == '\0';
+}
+
+// Primer rango >= lo cuyo nombre ya no empieza con prefix. Los nombres con el prefijo
+// son contiguos en by_name, as que basta otra bsqueda binaria.
+static int prefix_end(const char *prefix, int lo) {
+    size_t plen = strlen(prefix);
+    int hi = fi->count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (strncmp(fi->entries[fi->by_name[mid]].name, prefix, plen) == 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// Muestra una pgina de las entradas cuyo nombre empieza con prefix y, si pattern no es NULL,
+// adems coinciden con el patrn. Recorre el ndice secundario sin copiar ni ordenar entradas.
+static void list_range(const char *prefix, const char *pattern, int page) {
     if (!fi || fi->count == 0) {
         printf("No hay archivos en el sistema.\n");
         return;
     }
-    FileEntry *sorted = malloc(sizeof(FileEntry) * fi->count);
-    if (!sorted) {
-        printf("Sin memoria para ordenar archivos.\n");
-        return;
+    if (page < 1) page = 1;
+    int first = (page - 1) * LIST_PAGE_SIZE;
+    int lo = fileindex_lower_bound(fi, prefix);
+    int hi = prefix_end(prefix, lo);
+    int total = 0;
+
+    print_table_header();
+    if (!pattern) {
+        // Sin patrn el rango completo coincide: se salta directamente a la pgina pedida
+        total = hi - lo;
+        for (int r = lo + first; r < hi && r < lo + first + LIST_PAGE_SIZE; r++)
+            print_table_row(&fi->entries[fi->by_name[r]]);
+    } else {
+        for (int r = lo; r < hi; r++) {
+            const FileEntry *e = &fi->entries[fi->by_name[r]];
+            if (!glob_match(pattern, e->name)) continue;
+            if (total >= first && total < first + LIST_PAGE_SIZE)
+                print_table_row(e);
+            total++;
+        }
     }
-    memcpy(sorted, fi->entries, sizeof(FileEntry) * fi->count);
+    print_table_footer(page, total);
+}
 
-    int compare_fileentry(const void *a, const void *b) {
-        const FileEntry *fa = (const FileEntry *)a;
-        const FileEntry *fb = (const FileEntry *)b;
-        return strcmp(fa->name, fb->name);
-    }
+void filesystem_list(int page) {
+    pthread_mutex_lock(&fi_mutex);
+    list_range("", NULL, page);
+    pthread_mutex_unlock(&fi_mutex);
+}
+
+void filesystem_prefix(const char *prefix, int page) {
+    pthread_mutex_lock(&fi_mutex);
+    list_range(prefix, NULL, page);
+    pthread_mutex_unlock(&fi_mutex);
+}
 
-    qsort(sorted, fi->count, sizeof(FileEntry), compare_fileentry);
+void filesystem_find(const char *pattern, int page) {
+    // El prefijo literal del patrn (hasta el primer comodn) acota el rango a recorrer
+    char prefix[256];
+    size_t n = strcspn(pattern, "*?");
+    if (n >= sizeof(prefix)) n = sizeof(prefix) - 1;
+    memcpy(prefix, pattern, n);
+    prefix[n] = '\0';
+    pthread_mutex_lock(&fi_mutex);
+    list_range(prefix, pattern, page);
+    pthread_mutex_unlock(&fi_mutex);
+}
 
-    printf("+----------------------+------------+------------+--------+\n");
-    printf("| %-20s | %-10s | %-10s | %-6s |\n", "Archivo", "Original", "Comprimido", "Ahorro");
-    printf("+----------------------+------------+------------+--------+\n");
-    for (int i = 0; i < fi->count; i++) {
-        FileEntry *e = &sorted[i];
-        int percent = e->size_original > 0 ? (100 * (e->size_original - e->size_compressed)) / e->size_original : 0;
-        printf("| %-20s | %10ld | %10d | %5d%% |\n", e->name, e->size_original, e->size_compressed, percent);
-    }
-    printf("+----------------------+------------+------------+--------+\n");
+void filesystem_top(int n, const char *criterio, int page) {
+    FileIndexKey key;
+    if (!strcmp(criterio, "size")) key = FILEINDEX_BY_SIZE;
+    else if (!strcmp(criterio, "ratio")) key = FILEINDEX_BY_RATIO;
+    else { printf("Criterio no vlido: %s (use size o ratio)\n", criterio); return; }
+    if (n <= 0) { printf("N debe ser positivo\n"); return; }
 
-    free(sorted);
+    pthread_mutex_lock(&fi_mutex);
+    if (!fi || fi->count == 0) {
+        printf("No hay archivos en el sistema.\n");
+        pthread_mutex_unlock(&fi_mutex);
+        return;
+    }
+    if (n > fi->count) n = fi->count;
+    int *top = malloc(sizeof(int) * n);
+    if (!top) {
+        printf("Sin memoria para la consulta.\n");
+        pthread_mutex_unlock(&fi_mutex);
+        return;
+    }
+    int total = fileindex_top(fi, n, key, top);
+    if (page < 1) page = 1;
+    int first = (page - 1) * LIST_PAGE_SIZE;
+
+    print_table_header();
+    for (int i = first; i < total && i < first + LIST_PAGE_SIZE; i++)
+        print_table_row(&fi->entries[top[i]]);
+    print_table_footer(page, total);
+    pthread_mutex_unlock(&fi_mutex);
+    free(top);
 }
 
 void filesystem_load(const char *filename) {
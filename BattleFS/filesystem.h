@@ -8,11 +8,20 @@
 
 void filesystem_init();
 void filesystem_create(const char *filepath, const char *comp_dir);
+// max_threads <= 0 activa la concurrencia automtica (ajustada segn rendimiento y E/S)
 void filesystem_create_all_threads(const char *folder_path, const char *comp_dir, int max_threads);
+// Lmite de memoria para los buffers en vuelo de create_all, en MB (<= 0 restaura el valor por defecto)
+void filesystem_set_memory_limit(long megabytes);
+// Pide la cancelacin cooperativa del create_all en curso (tambin se activa con Ctrl+C)
+void filesystem_cancel();
 // Nueva funcin: muestra el archivo descomprimido en consola
 void filesystem_read_in_console(const char *filename, const char *comp_dir);
 void filesystem_delete(const char *filename);
-void filesystem_list();
+void filesystem_list(int page);
+// Consultas sobre el ndice, paginadas (page empieza en 1)
+void filesystem_find(const char *pattern, int page);
+void filesystem_prefix(const char *prefix, int page);
+void filesystem_top(int n, const char *criterio, int page);
 void filesystem_save(const char *filename);
 void filesystem_load(const char *filename);
 void filesystem_close();
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <sys/stat.h>
@@ -14,15 +15,26 @@ void print_help() {
     printf("Comandos:\n");
     printf("init                   - Inicializa el sistema de archivos limpio\n");
     printf("create <archivo>       - Comprime y guarda un archivo en el sistema\n");
-    printf("create_all             - Comprime todos los archivos del directorio base usando 16 hilos\n");
+    printf("create_all [hilos]     - Comprime todos los archivos del directorio base (sin hilos: automtico)\n");
+    printf("                         (Ctrl+C lo cancela; al repetirlo se reanuda desde el checkpoint)\n");
+    printf("memlimit <MB>          - Lmite de memoria para los buffers en vuelo de create_all\n");
     printf("read <archivo>         - Descomprime y muestra el archivo en vivo\n");
     printf("delete <archivo>       - Elimina un archivo del sistema\n");
-    printf("list                   - Muestra los nombres de archivos ordenados alfabticamente\n");
+    printf("list [pag]             - Muestra los nombres de archivos ordenados alfabticamente\n");
+    printf("find <patrn> [pag]    - Busca archivos por patrn con comodines * y ?\n");
+    printf("prefix <prefijo> [pag] - Muestra los archivos cuyo nombre empieza con el prefijo\n");
+    printf("top <n> size|ratio [pag] - Los n archivos ms grandes o con mayor ahorro\n");
     printf("save <nombre>          - Guarda el sistema en un archivo binario\n");
     printf("load <nombre>          - Carga un sistema desde archivo binario\n");
     printf("exit                   - Cierra el programa\n");
 }
 
+// Lee el nmero de pgina opcional de un comando (por defecto la primera)
+int parse_page(const char *tok) {
+    int page = tok ? atoi(tok) : 1;
+    return page > 0 ? page : 1;
+}
+
 void ensure_directories() {
 #ifdef _WIN32
     mkdir(comp_dir);
@@ -69,7 +81,13 @@ int main() {
             } else printf("Falta nombre de archivo\n");
         }
         else if (!strcmp(op, "create_all")) {
-            filesystem_create_all_threads(base_dir, comp_dir, 16);
+            char *hilos = strtok(NULL, " \n");
+            filesystem_create_all_threads(base_dir, comp_dir, hilos ? atoi(hilos) : 0);
+        }
+        else if (!strcmp(op, "memlimit")) {
+            char *mb = strtok(NULL, " \n");
+            if (mb) filesystem_set_memory_limit(atol(mb));
+            else printf("Falta el lmite en MB\n");
         }
         else if (!strcmp(op, "read")) {
             char *archivo = strtok(NULL, " \n");
@@ -85,7 +103,19 @@ int main() {
             else printf("Falta nombre de archivo\n");
         }
         else if (!strcmp(op, "list")) {
-            filesystem_list();
+            filesystem_list(parse_page(strtok(NULL, " \n")));
+        }
+        else if (!strcmp(op, "find") || !strcmp(op, "prefix")) {
+            char *arg = strtok(NULL, " \n");
+            if (!arg) printf("Falta patrn o prefijo\n");
+            else if (!strcmp(op, "find")) filesystem_find(arg, parse_page(strtok(NULL, " \n")));
+            else filesystem_prefix(arg, parse_page(strtok(NULL, " \n")));
+        }
+        else if (!strcmp(op, "top")) {
+            char *n = strtok(NULL, " \n");
+            char *criterio = strtok(NULL, " \n");
+            if (n && criterio) filesystem_top(atoi(n), criterio, parse_page(strtok(NULL, " \n")));
+            else printf("Uso: top <n> size|ratio [pag]\n");
         }
         else if (!strcmp(op, "save")) {
             char *nombre = strtok(NULL, " \n");
@@ -20,9 +20,45 @@ FileIndex* fileindex_create() {
     fi->capacity = 16;      // Capacidad inicial del array dinmico
     // Reserva memoria para el array de entradas de archivos (FileEntry)
     fi->entries = (FileEntry*)malloc(sizeof(FileEntry) * fi->capacity);
+    // Reserva el ndice secundario por nombre con la misma capacidad
+    fi->by_name = (int*)malloc(sizeof(int) * fi->capacity);
     return fi;
 }
 
+/**
+ * Calcula el primer rango de by_name cuyo nombre no es menor que key (cota inferior).
+ * Como by_name se mantiene ordenado en cada insercin, basta una bsqueda binaria.
+ *
+ * @param fi    Puntero al FileIndex.
+ * @param key   Nombre o prefijo a buscar.
+ * @return Rango (posicin dentro de by_name) entre 0 y fi->count.
+ */
+int fileindex_lower_bound(const FileIndex *fi, const char *key) {
+    int lo = 0, hi = fi->count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (strcmp(fi->entries[fi->by_name[mid]].name, key) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/**
+ * Busca un archivo por nombre exacto usando el ndice secundario.
+ *
+ * @param fi    Puntero al FileIndex.
+ * @param name  Nombre del archivo (sin ruta).
+ * @return Posicin de la entrada en fi->entries, o -1 si no existe.
+ */
+int fileindex_find(const FileIndex *fi, const char *name) {
+    int rank = fileindex_lower_bound(fi, name);
+    if (rank < fi->count && strcmp(fi->entries[fi->by_name[rank]].name, name) == 0)
+        return fi->by_name[rank];
+    return -1;
+}
+
 /**
  * Inserta un archivo comprimido en el ndice dinmico.
  * Si la capacidad actual del array se alcanza, se duplica (realloc) para admitir ms archivos.
@@ -39,6 +75,7 @@ void fileindex_insert(FileIndex *fi, const char *name, long size_original, int s
     if (fi->count >= fi->capacity) {
         fi->capacity *= 2;
         fi->entries = (FileEntry*)realloc(fi->entries, sizeof(FileEntry) * fi->capacity);
+        fi->by_name = (int*)realloc(fi->by_name, sizeof(int) * fi->capacity);
     }
     // Copia el nombre del archivo (protegido para no exceder el tamao de name)
     strncpy(fi->entries[fi->count].name, name, sizeof(fi->entries[fi->count].name)-1);
@@ -49,10 +86,89 @@ void fileindex_insert(FileIndex *fi, const char *name, long size_original, int s
     // Reserva memoria para los datos comprimidos y los copia desde el buffer
     fi->entries[fi->count].data = (unsigned char*)malloc(size_compressed);
     memcpy(fi->entries[fi->count].data, compressed_data, size_compressed);
+    // Inserta la nueva posicin en el ndice secundario manteniendo el orden por nombre
+    int rank = fileindex_lower_bound(fi, fi->entries[fi->count].name);
+    memmove(&fi->by_name[rank + 1], &fi->by_name[rank], sizeof(int) * (fi->count - rank));
+    fi->by_name[rank] = fi->count;
     // Incrementa el contador de archivos en el ndice
     fi->count++;
 }
 
+/**
+ * Elimina una entrada del ndice, liberando sus datos comprimidos.
+ * Las entradas posteriores se desplazan una posicin y el ndice secundario se ajusta
+ * para que siga apuntando a las mismas entradas.
+ *
+ * @param fi    Puntero al FileIndex.
+ * @param pos   Posicin de la entrada en fi->entries.
+ */
+void fileindex_remove(FileIndex *fi, int pos) {
+    if (pos < 0 || pos >= fi->count) return;
+    free(fi->entries[pos].data);
+    memmove(&fi->entries[pos], &fi->entries[pos + 1], sizeof(FileEntry) * (fi->count - pos - 1));
+    // Quita pos del ndice secundario y corrige las posiciones desplazadas
+    int out = 0;
+    for (int i = 0; i < fi->count; i++) {
+        int p = fi->by_name[i];
+        if (p == pos) continue;
+        fi->by_name[out++] = p > pos ? p - 1 : p;
+    }
+    fi->count--;
+}
+
+// Clave numrica de una entrada segn el criterio pedido (mayor es mejor)
+static double fileindex_key(const FileEntry *e, FileIndexKey key) {
+    if (key == FILEINDEX_BY_SIZE) return (double)e->size_original;
+    if (e->size_original <= 0) return 0.0;
+    return (double)(e->size_original - e->size_compressed) / (double)e->size_original;
+}
+
+// Restaura la propiedad de min-heap hacia abajo desde la raz i
+static void heap_sift_down(const FileIndex *fi, int *heap, int n, int i, FileIndexKey key) {
+    while (1) {
+        int l = 2 * i + 1, r = l + 1, m = i;
+        if (l < n && fileindex_key(&fi->entries[heap[l]], key) < fileindex_key(&fi->entries[heap[m]], key)) m = l;
+        if (r < n && fileindex_key(&fi->entries[heap[r]], key) < fileindex_key(&fi->entries[heap[m]], key)) m = r;
+        if (m == i) return;
+        int t = heap[i]; heap[i] = heap[m]; heap[m] = t;
+        i = m;
+    }
+}
+
+/**
+ * Selecciona las n entradas con mayor clave (tamao o ahorro) sin copiar ni ordenar el ndice.
+ * Usa un min-heap acotado de n posiciones: O(count log n) en vez de O(count log count).
+ *
+ * @param fi    Puntero al FileIndex.
+ * @param n     Cantidad de resultados deseados.
+ * @param key   Criterio de seleccin.
+ * @param out   Buffer de al menos n enteros donde se escriben las posiciones (mayor primero).
+ * @return Cantidad de posiciones escritas (min(n, fi->count)).
+ */
+int fileindex_top(const FileIndex *fi, int n, FileIndexKey key, int *out) {
+    if (n > fi->count) n = fi->count;
+    if (n <= 0) return 0;
+    int size = 0;
+    for (int i = 0; i < fi->count; i++) {
+        if (size < n) {
+            // Llena el heap y lo reconstruye al completarse
+            out[size++] = i;
+            if (size == n)
+                for (int j = n / 2 - 1; j >= 0; j--) heap_sift_down(fi, out, n, j, key);
+        } else if (fileindex_key(&fi->entries[i], key) > fileindex_key(&fi->entries[out[0]], key)) {
+            // Reemplaza el menor de los n mejores
+            out[0] = i;
+            heap_sift_down(fi, out, n, 0, key);
+        }
+    }
+    // Extrae del heap: el menor queda al final, as out termina en orden descendente
+    for (int end = n - 1; end > 0; end--) {
+        int t = out[0]; out[0] = out[end]; out[end] = t;
+        heap_sift_down(fi, out, end, 0, key);
+    }
+    return n;
+}
+
 /**
  * Libera toda la memoria reservada para el ndice de archivos, incluyendo:
  * - Los buffers de cada archivo comprimido
@@ -69,6 +185,7 @@ void fileindex_free(FileIndex *fi) {
     }
     // Libera el array de entradas
     free(fi->entries);
+    free(fi->by_name);
     // Libera la estructura principal
     free(fi);
 }
@@ -17,14 +17,34 @@ typedef struct {
     FileEntry *entries;           // Array dinmico de archivos
     int count;                    // Cantidad actual de archivos
     int capacity;                 // Capacidad mxima del array (crece automticamente)
+    int *by_name;                 // ndice secundario: posiciones de entries ordenadas por nombre
 } FileIndex;
 
+// Criterios de ordenamiento para consultas top-N
+typedef enum {
+    FILEINDEX_BY_SIZE,            // Mayor tamao original primero
+    FILEINDEX_BY_RATIO            // Mayor ahorro de compresin primero
+} FileIndexKey;
+
 // Crea el ndice de archivos con capacidad inicial
 FileIndex* fileindex_create();
 
 // Inserta un archivo en el ndice, reservando memoria y copiando datos
 void fileindex_insert(FileIndex *fi, const char *name, long size_original, int size_compressed, const unsigned char *compressed_data);
 
+// Busca un archivo por nombre exacto (bsqueda binaria). Devuelve su posicin en entries o -1
+int fileindex_find(const FileIndex *fi, const char *name);
+
+// Elimina la entrada en la posicin pos, liberando sus datos y actualizando el ndice secundario
+void fileindex_remove(FileIndex *fi, int pos);
+
+// Devuelve el primer rango de by_name cuyo nombre es >= prefix (cota inferior)
+int fileindex_lower_bound(const FileIndex *fi, const char *prefix);
+
+// Selecciona las n mayores entradas segn key sin ordenar el ndice completo.
+// Escribe en out (capacidad n) las posiciones en orden descendente y devuelve cuntas escribi
+int fileindex_top(const FileIndex *fi, int n, FileIndexKey key, int *out);
+
 // Libera toda la memoria asociada al ndice y los archivos
 void fileindex_free(FileIndex *fi);
 
@@ -1,5 +1,5 @@
 // laboratorio2_bmp_explicado.c
-// Programa didctico para cargar un BMP de 24 bits, convertirlo a grises o aplicar convolucin, y guardar el resultado.
+// Programa didctico para cargar un BMP (24 bits, con paleta, 16 o 32 bits), convertirlo a grises o aplicar convolucin, y guardar el resultado.
 // Cada parte est explicada de manera exhaustiva y detallada.
 // COMENTADO Y EXPLICADO EN EXTREMO DETALLE SEGN SOLICITUD
 
@@ -11,274 +11,56 @@
 #include <string.h>     // Para funciones de manipulacin de cadenas y memoria: memcpy
 #include <time.h>       // Para medir tiempo de ejecucin: clock, CLOCKS_PER_SEC
 
-// --- DEFINICIN DE ESTRUCTURAS PARA BMP ---
-// #pragma pack(push, 1) fuerza al compilador a no aadir padding entre los campos de las estructuras.
-// Esto es esencial porque el formato BMP requiere que los bytes estn alineados exactamente como estn definidos.
-
-// Estructura del encabezado de archivo BMP (14 bytes)
-#pragma pack(push, 1)
-typedef struct {
-    uint16_t bfType;      // Identificador de tipo de archivo. Debe ser 'BM' (0x4D42 en hexadecimal).
-    uint32_t bfSize;      // Tamao total del archivo en bytes, incluyendo todos los encabezados y los datos de pxeles.
-    uint16_t bfReserved1; // Campo reservado. Debe ser 0 segn la especificacin BMP.
-    uint16_t bfReserved2; // Segundo campo reservado. Tambin debe ser 0.
-    uint32_t bfOffBits;   // Offset (desplazamiento) en bytes desde el inicio del archivo hasta el comienzo de los datos de la imagen.
-} BITMAPFILEHEADER;
-
-// Estructura del encabezado de informacin BMP (BITMAPINFOHEADER, 40 bytes)
-typedef struct {
-    uint32_t biSize;          // Tamao de esta cabecera de informacin. Debe ser 40 para BITMAPINFOHEADER.
-    int32_t  biWidth;         // Ancho de la imagen en pxeles.
-    int32_t  biHeight;        // Alto de la imagen en pxeles. Si es positivo, la imagen se almacena de abajo hacia arriba (bottom-up).
-    uint16_t biPlanes;        // Nmero de planos. Siempre debe ser 1.
-    uint16_t biBitCount;      // Nmero de bits por pxel. Debe ser 24 para imgenes de 24 bits (este programa solo soporta 24 bpp).
-    uint32_t biCompression;   // Tipo de compresin. 0 (BI_RGB) significa sin compresin.
-    uint32_t biSizeImage;     // Tamao de los datos de la imagen en bytes. Puede ser 0 si biCompression es 0.
-    int32_t  biXPelsPerMeter; // Resolucin horizontal en pxeles por metro. Opcional, puede ser 0.
-    int32_t  biYPelsPerMeter; // Resolucin vertical en pxeles por metro. Opcional, puede ser 0.
-    uint32_t biClrUsed;       // Nmero de colores usados en la paleta. 0 indica todos.
-    uint32_t biClrImportant;  // Nmero de colores importantes. 0 indica todos.
-} BITMAPINFOHEADER;
-#pragma pack(pop) // Se vuelve a la alineacin por defecto de la plataforma
-
-// Estructura para representar un pxel en formato BMP 24 bits (BGR: Blue, Green, Red)
-typedef struct {
-    uint8_t b; // Canal azul (Blue), ocupa 1 byte
-    uint8_t g; // Canal verde (Green), ocupa 1 byte
-    uint8_t r; // Canal rojo (Red), ocupa 1 byte
-} BGR;
-
-// FUNCIN clampi
-// Funcin que limita un valor entero al rango [0, 255]. Es fundamental para evitar desbordamientos y valores invlidos en los canales de color.
-// Parmetro: v -> valor entero a limitar.
-// Retorno: valor limitado entre 0 y 255.
-uint8_t clampi(int v) {
-    if (v < 0) {
-        return 0; // Si es menor que 0, devuelve 0.
-    }
-    if (v > 255) {
-        return 255; // Si es mayor que 255, devuelve 255.
-    }
-    return (uint8_t)v; // Si est en el rango [0,255], lo devuelve tal cual, convertido a uint8_t.
-}
-
-// FUNCIN row_padding_24
-// Calcula cuntos bytes de relleno (padding) necesita cada fila de pxeles para que su tamao sea mltiplo de 4 bytes, segn la especificacin BMP.
-// Parmetro: width -> ancho de la imagen en pxeles.
-// Retorno: nmero de bytes de padding por fila.
-int row_padding_24(int width) {
-    int row_bytes = width * 3; // Cada pxel ocupa 3 bytes (B, G, R).
-    int resto = row_bytes % 4; // Calcula el resto al dividir row_bytes entre 4.
-    if (resto == 0) {
-        return 0; // Si ya es mltiplo de 4, no necesita padding.
-    } else {
-        return 4 - resto; // Si no, necesita 4 - resto bytes de padding.
-    }
-}
-
-// FUNCIN cargar_bmp24
-// Carga en memoria una imagen BMP de 24 bits, validando su formato y leyendo los datos de los pxeles.
-// Parmetros:
-//   path      -> ruta del archivo BMP a leer.
-//   out_w     -> puntero donde se almacenar el ancho de la imagen.
-//   out_h     -> puntero donde se almacenar el alto de la imagen.
-//   out_pixels-> puntero donde se almacenar el buffer de pxeles ledos (memoria dinmica).
-// Retorno: 1 si tuvo xito, 0 si hubo error.
-int load_bmp24(const char* path, int* out_w, int* out_h, BGR** out_pixels) {
-    FILE* f = fopen(path, "rb"); // Abre el archivo para lectura en modo binario.
-    if (f == NULL) {
-        printf("No se pudo abrir el archivo: %s\n", path);
-        return 0; // Error al abrir.
-    }
-
-    BITMAPFILEHEADER file_header; // Variable para almacenar el encabezado de archivo BMP.
-    BITMAPINFOHEADER info_header; // Variable para almacenar el encabezado de informacin BMP.
-
-    // Lee el encabezado de archivo. Debe leerse toda la estructura.
-    if (fread(&file_header, sizeof(file_header), 1, f) != 1) {
-        printf("No se pudo leer la cabecera del archivo.\n");
-        fclose(f);
+#include "bmp.h"      // Estructuras BMP, BGR, load_bmp24 y save_bmp24
+#include "filters.h"  // to_grayscale y convolve3x3_gray
+#include "parallel.h" // parallel_threads (motor de bandas paralelas)
+#include "convolve.h" // Motor de convolucin NxN (directa, separable, caja, FFT)
+#include "batch.h"    // Procesamiento de carpetas por lotes
+#include "chain.h"    // Cadenas de operaciones con etapas fusionadas
+#include "stats.h"    // Histogramas y estadsticas de la imagen
+#include "resize.h"   // Cambio de tamao con caja, bilineal o Lanczos
+#include "bench.h"    // Benchmark con imgenes sintticas
+#include "integral.h" // Tabla de sumas: media, desvo y umbral adaptativo de cualquier radio
+#include "edges.h"    // Bordes de Sobel fusionados: magnitud, direccin y supresin de no mximos
+#include "filemap.h"  // file_same, para no reemplazar la imagen proyectada
+
+// FUNCIN run_chain
+// Aplica una cadena de operaciones (ver chain.h) a una imagen ya proyectada y guarda el resultado.
+// Retorno: 1 si tuvo xito, 0 si la cadena no es vlida o hubo un error.
+int run_chain(const char* spec, const BgrView* src, const char* out_path) {
+    OpChain chain;
+    Frame out;
+    if (!chain_parse(spec, &chain)) return 0;
+    double inicio = wall_seconds();
+    int ok = chain_run(&chain, src, &out);
+    double segundos = wall_seconds() - inicio;
+    chain_free(&chain);
+    if (!ok) {
+        printf("Sin memoria para aplicar la cadena.\n");
         return 0;
     }
-    // Lee el encabezado de informacin.
-    if (fread(&info_header, sizeof(info_header), 1, f) != 1) {
-        printf("No se pudo leer la cabecera de informacin.\n");
-        fclose(f);
-        return 0;
-    }
-
-    // Validacin: verifica que el archivo es un BMP vlido de 24 bits sin compresin.
-    if (file_header.bfType != 0x4D42) { // 'BM' en hexadecimal es 0x4D42.
-        printf("El archivo no es un BMP vlido (no empieza con 'BM').\n");
-        fclose(f);
-        return 0;
-    }
-   
-    // Verifica que sea un bmp de maximo 24 bits
-    if (info_header.biBitCount != 24 || info_header.biCompression != 0) {
-        printf("Solo se soportan BMP de 24 bits sin compresin.\n");
-        fclose(f);
-        return 0;
-    }
-
-    // Obtiene el ancho y el alto de la imagen.
-    int width = info_header.biWidth; // Ancho en pxeles.
-    int height = info_header.biHeight > 0 ? info_header.biHeight : -info_header.biHeight; // El alto puede ser negativo.
-    int is_bottom_up = (info_header.biHeight > 0) ? 1 : 0; // Si es positivo, la imagen se almacena de abajo hacia arriba.
-
-    // Reserva memoria dinmica para almacenar todos los pxeles de la imagen.
-    BGR* pixels = (BGR*)malloc(width * height * sizeof(BGR));
-    if (pixels == NULL) {
-        printf("No hay suficiente memoria para cargar la imagen.\n");
-        fclose(f);
-        return 0;
-    }
-
-    // Posiciona el puntero del archivo al inicio de los datos de la imagen segn el offset bfOffBits.
-    fseek(f, file_header.bfOffBits, SEEK_SET);
-
-    // Calcula el padding necesario para cada fila.
-    int pad = row_padding_24(width);
-
-    // Bucle para leer cada fila de la imagen.
-    // Si es bottom-up, la primera fila leda es la ltima en memoria.
-    for (int y = 0; y < height; y++) {
-        int fila_destino = is_bottom_up ? (height - 1 - y) : y; // Calcula a qu fila de memoria corresponde la fila leda.
-        BGR* fila = pixels + fila_destino * width;              // Apunta al inicio de la fila en el buffer de pxeles.
-        if (fread(fila, sizeof(BGR), width, f) != (size_t)width) {
-            printf("Error leyendo los datos de la imagen.\n");
-            free(pixels);
-            fclose(f);
-            return 0;
-        }
-        fseek(f, pad, SEEK_CUR); // Salta el padding al final de la fila.
-    }
-
-    fclose(f); // Cierra el archivo.
-    *out_w = width;         // Devuelve el ancho.
-    *out_h = height;        // Devuelve el alto.
-    *out_pixels = pixels;   // Devuelve el buffer de pxeles.
-    return 1; // xito.
-}
-// FIN FUNCIN row_padding_24
-
-
-// FUNCIN save_bmp24
-// Guarda una imagen en memoria en formato BMP de 24 bits en disco.
-// Parmetros:
-//   path   -> ruta o nombre del archivo BMP de salida.
-//   width  -> ancho de la imagen en pxeles.
-//   height -> alto de la imagen en pxeles.
-//   pixels -> buffer con los pxeles a guardar.
-// Retorno: 1 si tuvo xito, 0 si hubo error.
-int save_bmp24(const char* path, int width, int height, const BGR* pixels) {
-    FILE* f = fopen(path, "wb"); // Abre el archivo para escritura en modo binario.
-    if (f == NULL) {
-        printf("No se pudo crear el archivo de salida: %s\n", path);
-        return 0;
-    }
-
-    int pad = row_padding_24(width); // Calcula el padding por fila.
-    uint32_t row_bytes = width * 3 + pad; // Nmero de bytes por fila (pxeles + padding).
-    uint32_t img_bytes = row_bytes * height; // Tamao total de los datos de imagen.
-
-    // Prepara los encabezados BMP para el archivo de salida.
-    BITMAPFILEHEADER file_header;
-    BITMAPINFOHEADER info_header;
-
-    // Completa los campos del encabezado de archivo BMP.
-    file_header.bfType = 0x4D42; // 'BM'
-    file_header.bfSize = sizeof(BITMAPFILEHEADER) + sizeof(BITMAPINFOHEADER) + img_bytes; // Tamao total del archivo.
-    file_header.bfReserved1 = 0; // Reservado, siempre 0.
-    file_header.bfReserved2 = 0; // Reservado, siempre 0.
-    file_header.bfOffBits = sizeof(BITMAPFILEHEADER) + sizeof(BITMAPINFOHEADER); // Offset donde empiezan los datos de la imagen.
-
-    // Completa los campos del encabezado de informacin BMP.
-    info_header.biSize = sizeof(BITMAPINFOHEADER); // Debe ser 40.
-    info_header.biWidth = width;                   // Ancho.
-    info_header.biHeight = -height;                // Negativo para top-down (la primera fila en memoria es la primera en archivo).
-    info_header.biPlanes = 1;                      // Siempre 1.
-    info_header.biBitCount = 24;                   // 24 bits por pxel.
-    info_header.biCompression = 0;                 // Sin compresin.
-    info_header.biSizeImage = img_bytes;           // Tamao de los datos de imagen.
-    info_header.biXPelsPerMeter = 0;               // Resolucin horizontal (opcional).
-    info_header.biYPelsPerMeter = 0;               // Resolucin vertical (opcional).
-    info_header.biClrUsed = 0;                     // N de colores usados, 0 para todos.
-    info_header.biClrImportant = 0;                // N de colores importantes, 0 para todos.
-
-    // Escribe los encabezados en el archivo de salida.
-    fwrite(&file_header, sizeof(file_header), 1, f);
-    fwrite(&info_header, sizeof(info_header), 1, f);
-
-    // Escribe cada fila de pxeles, aadiendo el padding al final de cada una.
-    uint8_t zeroes[3] = {0,0,0}; // Buffer de 3 bytes en cero para el padding (mximo posible).
-    for (int y = 0; y < height; y++) {
-        const BGR* fila = pixels + y * width;        // Apunta al inicio de la fila en el buffer.
-        fwrite(fila, sizeof(BGR), width, f);         // Escribe los pxeles.
-        fwrite(zeroes, 1, pad, f);                   // Escribe el padding necesario.
-    }
-
-    fclose(f); // Cierra el archivo de salida.
-    return 1;  // xito.
+    printf("Resultado: %dx%d %s, procesado en %.4f segundos\n", out.width, out.height,
+           out.is_gray ? "en grises" : "a color", segundos);
+    ok = frame_save(&out, out_path);
+    printf(ok ? "Guardado %s\n" : "No se pudo guardar %s\n", out_path);
+    frame_free(&out);
+    return ok;
 }
 
-// --- FUNCIN to_grayscale ---
-// Convierte una imagen de color a escala de grises, modificando el buffer recibido.
-// El valor de gris se calcula usando la luminancia perceptual del ojo humano.
-// Parmetros:
-//   pixels -> buffer de pxeles (modificado en sitio).
-//   width  -> ancho de la imagen en pxeles.
-//   height -> alto de la imagen en pxeles.
-void to_grayscale(BGR* pixels, int width, int height) {
-    for (int i = 0; i < width * height; i++) {
-        // Frmula de luminancia ponderada: 0.299*R + 0.587*G + 0.114*B, aproximada con enteros.
-        int gray = (int)(pixels[i].r * 299 + pixels[i].g * 587 + pixels[i].b * 114) / 1000;
-        uint8_t g = clampi(gray); // Limita el resultado a [0,255].
-        pixels[i].r = g; // Asigna el gris al canal rojo.
-        pixels[i].g = g; // Asigna el gris al canal verde.
-        pixels[i].b = g; // Asigna el gris al canal azul.
-    }
-}
-
-// --- FUNCIN convolve3x3_gray ---
-// Aplica una convolucin 3x3 sobre una imagen en escala de grises.
-// Parmetros:
-//   src     -> buffer de entrada (debe estar en escala de grises).
-//   dst     -> buffer de salida (donde se guardar el resultado).
-//   width   -> ancho de la imagen en pxeles.
-//   height  -> alto de la imagen en pxeles.
-//   k       -> kernel 3x3 de enteros (matriz de convolucin).
-//   divisor -> divisor para normalizar el resultado (suma de los valores del kernel, si es 0 se usa 1).
-//   offset  -> valor a sumar al resultado final (bias).
-void convolve3x3_gray(const BGR* src, BGR* dst, int width, int height, const int k[3][3], int divisor, int offset) {
-    if (divisor == 0) {
-        divisor = 1; // Para evitar divisin por cero.
-    }
-
-    // Recorre cada pxel de la imagen de salida.
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            int suma = 0; // Acumulador para el valor convolucionado del pxel actual.
-            // Recorre la vecindad 3x3 centrada en (x, y).
-            for (int ky = -1; ky <= 1; ky++) {
-                for (int kx = -1; kx <= 1; kx++) {
-                    int px = x + kx; // Coordenada x del vecino.
-                    int py = y + ky; // Coordenada y del vecino.
-                    // Verifica si el vecino est dentro de los lmites de la imagen.
-                    if (px >= 0 && px < width && py >= 0 && py < height) {
-                        int kernel_val = k[ky+1][kx+1]; // Valor correspondiente del kernel.
-                        const BGR* p = &src[py * width + px]; // Puntero al pxel vecino.
-                        suma += p->r * kernel_val; // Multiplica el valor de gris (r) por el kernel y suma.
-                    }
-                }
-            }
-            suma = suma / divisor + offset; // Normaliza y suma el offset.
-            uint8_t g = clampi(suma); // Limita a [0,255].
-            dst[y * width + x].r = g; // Asigna el resultado al canal rojo.
-            dst[y * width + x].g = g; // Asigna el resultado al canal verde.
-            dst[y * width + x].b = g; // Asigna el resultado al canal azul.
-        }
-    }
+// Archivos que escriben las opciones del men sobre la imagen cargada.
+static const char* const menu_outputs[] = {
+    "output_gray.bmp", "output_conv.bmp", "output_color.bmp", "output_chain.bmp",
+    "output_local.bmp", "output_resize.bmp", "output_edges.bmp", "output_edges_dir.bmp",
+};
+
+// FUNCIN keep_input_replaceable
+// Si la imagen cargada de path es tambin una salida (por ejemplo, volver a procesar
+// output_conv.bmp), pasa la proyeccin a una copia en memoria: en Windows no se puede reemplazar
+// un archivo mientras est proyectado. Retorno: 1 si se puede seguir, 0 si falta memoria.
+static int keep_input_replaceable(MappedBmp* img, const char* path, const char* const* outputs, int count) {
+    for (int i = 0; i < count; i++)
+        if (file_same(path, outputs[i])) return bmp_map_to_copy(img);
+    return 1;
 }
 
 // FUNCIN read_kernel 
@@ -307,54 +89,132 @@ void read_kernel(int k[3][3], int* divisor, int* offset) {
     }
 }
 
+// FUNCIN read_kernel_nxn
+// Solicita el tipo y tamao de un kernel NxN (gaussiano, caja o con pesos ingresados a mano) y el offset.
+// Parmetro: kern -> kernel a construir (liberar con conv_kernel_free).
+// Retorno: 1 si el kernel es vlido, 0 si no.
+int read_kernel_nxn(ConvKernel* kern) {
+    int tipo, n;
+    printf("Tipo de kernel (1 = gaussiano, 2 = caja, 3 = personalizado): ");
+    if (scanf("%d", &tipo) != 1) return 0;
+    printf("Lado del kernel (impar, de 1 a %d): ", CONV_MAX_SIZE);
+    if (scanf("%d", &n) != 1 || n < 1 || n > CONV_MAX_SIZE || n % 2 == 0) {
+        printf("Tamao invlido.\n");
+        return 0;
+    }
+    if (tipo == 1) {
+        double sigma;
+        printf("Sigma (0 = lado / 6): ");
+        if (scanf("%lf", &sigma) != 1 || !conv_kernel_gaussian(kern, n, sigma)) return 0;
+    } else if (tipo == 2) {
+        if (!conv_kernel_box(kern, n)) return 0;
+    } else if (tipo == 3) {
+        if (!conv_kernel_alloc(kern, n)) return 0;
+        printf("Ingrese los %d enteros del kernel, fila por fila:\n", n * n);
+        int suma = 0; // Divisor: suma de los pesos, como en read_kernel.
+        for (int i = 0; i < n * n; i++) {
+            if (scanf("%d", &kern->k[i]) != 1) { conv_kernel_free(kern); return 0; }
+            suma += kern->k[i];
+        }
+        kern->divisor = suma != 0 ? suma : 1;
+    } else {
+        printf("Tipo invlido.\n");
+        return 0;
+    }
+    printf("Ingrese offset/bias (por lo general 0, o 128 para bordes): ");
+    if (scanf("%d", &kern->offset) != 1) { conv_kernel_free(kern); return 0; }
+    return 1;
+}
+
 // --- FUNCIN print_menu ---
 // Imprime el men principal del programa en consola.
 void print_menu(void) {
     printf("\n--- Menu ---\n");
     printf("1) Convertir a escala de grises y guardar (output_gray.bmp)\n");
     printf("2) Convolucion 3x3 (pide kernel) y guardar (output_conv.bmp)\n");
+    printf("3) Escala de grises por streaming, para imagenes grandes (output_gray.bmp)\n");
+    printf("4) Convolucion 3x3 por streaming, para imagenes grandes (output_conv.bmp)\n");
+    printf("5) Convolucion NxN: gaussiano, caja o personalizado (output_conv.bmp)\n");
+    printf("6) Benchmark de estrategias de convolucion NxN\n");
+    printf("7) Convolucion 3x3 a color, por canal (output_color.bmp)\n");
+    printf("8) Procesar una carpeta por lotes con una cadena de operaciones\n");
+    printf("9) Aplicar una cadena de operaciones a la imagen (output_chain.bmp)\n");
+    printf("10) Benchmark de carga, grises, convolucion y guardado con imagenes sinteticas\n");
+    printf("11) Media, desvio o umbral adaptativo de cualquier radio (output_local.bmp)\n");
+    printf("12) Histograma y estadisticas de la imagen (minimo, maximo, media, Otsu)\n");
+    printf("13) Cambiar el tamano: caja, bilineal o Lanczos (output_resize.bmp)\n");
+    printf("14) Bordes de Sobel: magnitud y direccion del gradiente (output_edges.bmp)\n");
     printf("0) Salir\n");
     printf("Opcion: ");
 }
 
 // --- FUNCIN PRINCIPAL main ---
 // Controla el flujo principal del programa, mostrando el men, solicitando opciones y gestionando el procesamiento de imgenes.
-int main() {
+// Con "--batch carpeta_entrada cadena carpeta_salida [trabajadores]" procesa la carpeta sin men
+// (por ejemplo: LAB_2.exe --batch fotos gray,gauss7 salida), y con "--chain cadena entrada salida"
+// una sola imagen (la cadena puede ser @archivo, por ejemplo: LAB_2.exe --chain @bordes.txt a.bmp b.bmp).
+// "--bench [megapixeles]" corre el benchmark (es lo que ejecuta "make -f Makefile.win bench").
+int main(int argc, char* argv[]) {
+    if (argc >= 2 && strcmp(argv[1], "--bench") == 0)
+        return bench_run(argc >= 3 ? atoi(argv[2]) : 0, NULL) ? 0 : 1;
+    if (argc >= 5 && strcmp(argv[1], "--batch") == 0)
+        return batch_run(argv[2], argv[3], argv[4], argc >= 6 ? atoi(argv[5]) : 0) ? 0 : 1;
+    if (argc >= 5 && strcmp(argv[1], "--chain") == 0) {
+        MappedBmp in = {0};
+        if (!bmp_map(argv[3], &in)) {
+            printf("Fallo al cargar el BMP.\n");
+            return 1;
+        }
+        if (!keep_input_replaceable(&in, argv[3], (const char* const*)&argv[4], 1)) {
+            bmp_unmap(&in);
+            return 1;
+        }
+        int ok = run_chain(argv[2], &in.view, argv[4]);
+        bmp_unmap(&in);
+        return ok ? 0 : 1;
+    }
+
     char filename[512]; // Buffer para almacenar la ruta/nombre del archivo BMP a cargar.
     int w = 0, h = 0;   // Variables para almacenar el ancho y el alto de la imagen cargada.
-    BGR* img = NULL;    // Puntero al buffer de imagen cargada en memoria.
+    MappedBmp img = {0}; // Imagen proyectada en memoria (los filtros leen el archivo sin copiarlo).
     int opcion;         // Variable para almacenar la opcin seleccionada del men.
 
+    // Informa la ruta SIMD elegida para esta CPU y cuntos hilos usan los filtros.
+    printf("Kernels vectorizados: %s, hilos: %d\n", filters_simd_path(), parallel_threads());
+
     // Bucle principal del programa (se repite hasta que el usuario elija salir).
     do {
         print_menu(); // Muestra el men principal.
         if (scanf("%d", &opcion) != 1) break; // Lee la opcin del usuario.
 
-        // Si el usuario selecciona una opcin de procesamiento (1 o 2), solicita el archivo BMP.
-        if (opcion == 1 || opcion == 2) {
+        // Si el usuario selecciona una opcin que trabaja sobre la imagen cargada, solicita el archivo BMP.
+        if (opcion == 1 || opcion == 2 || opcion == 5 || opcion == 6 || opcion == 7 || opcion == 9 || opcion == 11 || opcion == 12 || opcion == 13 || opcion == 14) {
             printf("Ingrese la ruta o nombre del archivo BMP (ejemplo: C:\\\\imagenes\\\\foto.bmp): ");
             scanf("%511s", filename); // Lee la ruta del archivo BMP.
 
-            if (img) { // Si ya hay una imagen cargada, libera la memoria antes de cargar una nueva.
-                free(img);
-                img = NULL;
-            }
+            bmp_unmap(&img); // Si ya hay una imagen cargada, la libera antes de cargar una nueva.
 
-            if (!load_bmp24(filename, &w, &h, &img)) { // Carga la imagen BMP de 24 bits.
+            if (!bmp_map(filename, &img)) { // Proyecta la imagen BMP en memoria (los formatos que no son de 24 bits se convierten).
                 printf("Fallo al cargar el BMP.\n");
                 continue; // Si falla, vuelve a mostrar el men.
             }
+            int outputs = (int)(sizeof(menu_outputs) / sizeof(menu_outputs[0]));
+            if (!keep_input_replaceable(&img, filename, menu_outputs, outputs)) {
+                bmp_unmap(&img);
+                continue;
+            }
+            w = img.view.width;
+            h = img.view.height;
             printf("Imagen cargada: %dx%d\n", w, h); // Muestra dimensiones de la imagen cargada.
         }
 
         // Opcin 1: Convertir la imagen a escala de grises.
         if (opcion == 1) {
             clock_t inicio = clock(); // Marca el tiempo de inicio.
-            BGR* temp = (BGR*)malloc(w * h * sizeof(BGR)); // Reserva buffer temporal para procesar la imagen.
-            if (!temp) { printf("Sin memoria.\n"); break; }
-            memcpy(temp, img, w * h * sizeof(BGR)); // Copia la imagen original al buffer temporal.
-            to_grayscale(temp, w, h); // Convierte la imagen a escala de grises.
-            int ok = save_bmp24("output_gray.bmp", w, h, temp); // Guarda la imagen resultante.
+            GrayImage gray; // Imagen de grises planar: 1 byte por pxel en vez de 3.
+            if (!gray_image_alloc(&gray, w, h)) { printf("Sin memoria.\n"); break; }
+            to_grayscale_view(&img.view, &gray); // Convierte a grises leyendo directo del archivo proyectado.
+            int ok = save_bmp_gray("output_gray.bmp", &gray); // Guarda expandiendo a BGR fila por fila.
             clock_t fin = clock(); // Marca el tiempo de finalizacin.
             double segundos = (double)(fin - inicio) / CLOCKS_PER_SEC; // Calcula duracin.
             if (!ok) {
@@ -363,20 +223,15 @@ int main() {
                 printf("Guardado output_gray.bmp\n");
             }
             printf("Tiempo de ejecucin: %.4f segundos\n", segundos); // Muestra el tiempo de procesamiento.
-            free(temp); // Libera el buffer temporal.
+            gray_image_free(&gray); // Libera la imagen de grises.
         }
         // Opcin 2: Aplicar convolucin 3x3 a la imagen (previamente convertida a grises).
         else if (opcion == 2) {
             int k[3][3], divisor, offset; // Kernel 3x3, divisor y offset para la convolucin.
             read_kernel(k, &divisor, &offset); // Solicita el kernel y el offset al usuario.
             clock_t inicio = clock(); // Tiempo de inicio.
-            BGR* gray = (BGR*)malloc(w * h * sizeof(BGR)); // Buffer para imagen en grises.
-            BGR* out  = (BGR*)malloc(w * h * sizeof(BGR)); // Buffer para imagen resultante.
-            if (!gray || !out) { printf("Sin memoria.\n"); free(gray); free(out); break; }
-            memcpy(gray, img, w * h * sizeof(BGR)); // Copia la imagen original a gray.
-            to_grayscale(gray, w, h); // Convierte la imagen a grises.
-            convolve3x3_gray(gray, out, w, h, k, divisor, offset); // Aplica la convolucin.
-            int ok = save_bmp24("output_conv.bmp", w, h, out); // Guarda la imagen procesada.
+            // Grises, convolucin y guardado en una sola pasada por filas, sin imgenes intermedias.
+            int ok = gray_conv_view_to_bmp(&img.view, k, divisor, offset, "output_conv.bmp");
             clock_t fin = clock(); // Tiempo de fin.
             double segundos = (double)(fin - inicio) / CLOCKS_PER_SEC; // Duracin.
             if (!ok) {
@@ -385,8 +240,211 @@ int main() {
                 printf("Guardado output_conv.bmp\n");
             }
             printf("Tiempo de ejecucin: %.4f segundos\n", segundos);
-            free(gray); // Libera el buffer de grises.
-            free(out);  // Libera el buffer de salida.
+        }
+        // Opciones 3 y 4: igual que 1 y 2, pero leyendo el archivo por lotes de filas sin cargar la
+        // imagen completa, para imgenes ms grandes que la memoria disponible.
+        else if (opcion == 3 || opcion == 4) {
+            printf("Ingrese la ruta o nombre del archivo BMP (ejemplo: C:\\\\imagenes\\\\foto.bmp): ");
+            scanf("%511s", filename); // Lee la ruta del archivo BMP.
+            int k[3][3], divisor = 1, offset = 0;
+            if (opcion == 4) read_kernel(k, &divisor, &offset); // Solicita el kernel y el offset.
+            const char* salida = opcion == 3 ? "output_gray.bmp" : "output_conv.bmp";
+            clock_t inicio = clock(); // Tiempo de inicio.
+            int ok = opcion == 3 ? to_grayscale_file(filename, salida)
+                                 : gray_conv_file(filename, salida, k, divisor, offset);
+            clock_t fin = clock(); // Tiempo de fin.
+            double segundos = (double)(fin - inicio) / CLOCKS_PER_SEC; // Duracin.
+            if (!ok) {
+                printf("No se pudo generar %s\n", salida);
+            } else {
+                printf("Guardado %s\n", salida);
+            }
+            printf("Tiempo de ejecucin: %.4f segundos\n", segundos);
+        }
+        // Opcin 5: convolucin NxN con el motor general, que elige la estrategia segn el kernel.
+        else if (opcion == 5) {
+            ConvKernel kern;
+            if (!read_kernel_nxn(&kern)) {
+                printf("Kernel invlido.\n");
+                continue;
+            }
+            ConvStrategy estrategia = conv_choose(&kern);
+            printf("Estrategia: %s\n", conv_strategy_name(estrategia));
+            double inicio = wall_seconds(); // Tiempo de pared: la convolucin usa varios hilos.
+            GrayImage gray, out;
+            int ok_gray = gray_image_alloc(&gray, w, h);
+            int ok_out = gray_image_alloc(&out, w, h);
+            int ok = ok_gray && ok_out;
+            if (ok) {
+                to_grayscale_view(&img.view, &gray); // Convierte la imagen a grises.
+                ok = convolve_plane(&gray, &out, &kern, estrategia) && save_bmp_gray("output_conv.bmp", &out);
+            }
+            double segundos = wall_seconds() - inicio;
+            if (!ok) {
+                printf("No se pudo generar output_conv.bmp\n");
+            } else {
+                printf("Guardado output_conv.bmp\n");
+            }
+            printf("Tiempo de ejecucin: %.4f segundos\n", segundos);
+            gray_image_free(&gray);
+            gray_image_free(&out);
+            conv_kernel_free(&kern);
+        }
+        // Opcin 6: mide todas las estrategias NxN sobre la imagen en grises para ubicar los cruces.
+        else if (opcion == 6) {
+            GrayImage gray;
+            if (!gray_image_alloc(&gray, w, h)) { printf("Sin memoria.\n"); continue; }
+            to_grayscale_view(&img.view, &gray);
+            conv_benchmark(&gray);
+            gray_image_free(&gray);
+        }
+        // Opcin 7: convolucin 3x3 sobre los tres canales, sin convertir a grises.
+        else if (opcion == 7) {
+            int k[3][3], divisor, offset;
+            read_kernel(k, &divisor, &offset);
+            clock_t inicio = clock();
+            int ok = color_conv_view_to_bmp(&img.view, k, divisor, offset, "output_color.bmp");
+            clock_t fin = clock();
+            double segundos = (double)(fin - inicio) / CLOCKS_PER_SEC;
+            if (!ok) {
+                printf("No se pudo guardar output_color.bmp\n");
+            } else {
+                printf("Guardado output_color.bmp\n");
+            }
+            printf("Tiempo de ejecucin: %.4f segundos\n", segundos);
+        }
+        // Opcin 8: aplica una cadena de operaciones a todos los BMP de una carpeta.
+        else if (opcion == 8) {
+            char in_dir[512], out_dir[512], spec[512];
+            int workers;
+            printf("Carpeta de entrada: ");
+            if (scanf("%511s", in_dir) != 1) break;
+            printf("Operaciones separadas por comas (gray, invert, thresholdN, blur, sharpen, sobelx, sobely,\n");
+            printf("laplace, gaussN, boxN, resizeWxH[:filtro], resizeN%%[:filtro], meanR, stddevR, adaptiveR@c, equalize,\n");
+            printf("autocontrast[N], otsu, edges[:nms];\n");
+            printf("ej.: gray,gauss7,laplace@128) o @archivo: ");
+            if (scanf("%511s", spec) != 1) break;
+            printf("Carpeta de salida: ");
+            if (scanf("%511s", out_dir) != 1) break;
+            printf("Imagenes en paralelo (0 = automatico): ");
+            if (scanf("%d", &workers) != 1) break;
+            batch_run(in_dir, spec, out_dir, workers);
+        }
+        // Opcin 9: cadena de operaciones sobre la imagen cargada, con etapas fusionadas por bloques.
+        else if (opcion == 9) {
+            char spec[512];
+            printf("Operaciones separadas por comas (gray, invert, thresholdN, blur, sharpen, sobelx,\n");
+            printf("sobely, laplace, gaussN, boxN, resizeWxH[:filtro], resizeN%%[:filtro], meanR, stddevR, adaptiveR@c, equalize,\n");
+            printf("autocontrast[N], otsu, edges[:nms]) o @archivo: ");
+            if (scanf("%511s", spec) != 1) break;
+            run_chain(spec, &img.view, "output_chain.bmp");
+        }
+        // Opcin 10: benchmark con imgenes sintticas (se generan y borran en la carpeta actual).
+        else if (opcion == 10) {
+            int max_mp;
+            printf("Tamao mximo en megapxeles (1 a 128, 0 = todos): ");
+            if (scanf("%d", &max_mp) != 1) break;
+            bench_run(max_mp, NULL);
+        }
+        // Opcin 11: filtros locales sobre la tabla de sumas (integral.h): el costo por pxel no
+        // depende del radio.
+        else if (opcion == 11) {
+            int tipo, radio, c = 0;
+            printf("Tipo (1 = media, 2 = desvio estandar, 3 = umbral adaptativo): ");
+            if (scanf("%d", &tipo) != 1) break;
+            printf("Radio de la ventana (0 a %d): ", INTEGRAL_MAX_RADIUS);
+            if (scanf("%d", &radio) != 1) break;
+            if (tipo == 3) {
+                printf("Constante c (blanco si el pixel supera la media - c): ");
+                if (scanf("%d", &c) != 1) break;
+            }
+            if (tipo < 1 || tipo > 3 || radio < 0 || radio > INTEGRAL_MAX_RADIUS) {
+                printf("Parmetros invlidos.\n");
+                continue;
+            }
+            LocalOp op = tipo == 1 ? LOCAL_MEAN : tipo == 2 ? LOCAL_STDDEV : LOCAL_THRESHOLD;
+            double inicio = wall_seconds();
+            GrayImage gray, out;
+            int ok_gray = gray_image_alloc(&gray, w, h);
+            int ok_out = gray_image_alloc(&out, w, h);
+            int ok = ok_gray && ok_out;
+            if (ok) {
+                to_grayscale_view(&img.view, &gray);
+                ok = local_filter(&gray, &out, op, radio, c) && save_bmp_gray("output_local.bmp", &out);
+            }
+            double segundos = wall_seconds() - inicio;
+            if (!ok) {
+                printf("No se pudo generar output_local.bmp\n");
+            } else {
+                printf("Guardado output_local.bmp (%s, radio %d)\n", local_op_name(op), radio);
+            }
+            printf("Tiempo de ejecucin: %.4f segundos\n", segundos);
+            gray_image_free(&gray);
+            gray_image_free(&out);
+        }
+        // Opcin 12: histogramas por canal y de luminancia, con las estadsticas que salen de ellos
+        // (para ecualizar o binarizar con esos valores: equalize, autocontrast u otsu en una cadena).
+        else if (opcion == 12) {
+            ImageStats st;
+            double inicio = wall_seconds();
+            if (!stats_view(&img.view, &st)) { printf("Sin memoria.\n"); continue; }
+            double segundos = wall_seconds() - inicio;
+            stats_print(&st, 0);
+            printf("Tiempo de ejecucin: %.4f segundos\n", segundos);
+        }
+        // Opcin 13: redimensiona la imagen cargada con tablas de pesos (resize.h), por ejemplo para
+        // una vista previa que luego se procesa mucho ms rpido que la imagen completa.
+        else if (opcion == 13) {
+            int nw, nh, tipo;
+            printf("Nuevo ancho y alto (0 en uno de los dos para mantener la proporcion): ");
+            if (scanf("%d %d", &nw, &nh) != 2) break;
+            printf("Filtro (0 = vecino mas cercano, 1 = caja, 2 = bilineal, 3 = Lanczos): ");
+            if (scanf("%d", &tipo) != 1) break;
+            if (nw <= 0 && nh > 0) nw = (int)((int64_t)w * nh / h);
+            if (nh <= 0 && nw > 0) nh = (int)((int64_t)h * nw / w);
+            if (nw < 1) nw = 1;
+            if (nh < 1) nh = 1;
+            if (tipo < 0 || tipo > 3 || nw > 65535 || nh > 65535) {
+                printf("Parmetros invlidos.\n");
+                continue;
+            }
+            ResizeFilter filtro = (ResizeFilter)tipo;
+            double inicio = wall_seconds();
+            BGR* out = (BGR*)malloc((size_t)nw * nh * sizeof(BGR));
+            int ok = out && resize_view(&img.view, out, nw, nh, filtro);
+            double segundos = wall_seconds() - inicio;
+            if (ok) ok = save_bmp24("output_resize.bmp", nw, nh, out);
+            if (!ok) {
+                printf("No se pudo generar output_resize.bmp\n");
+            } else {
+                printf("Guardado output_resize.bmp (%dx%d, %s)\n", nw, nh, resize_filter_name(filtro));
+            }
+            printf("Tiempo de ejecucin: %.4f segundos\n", segundos);
+            free(out);
+        }
+        // Opcin 14: Sobel fusionado (edges.h): Gx, Gy, magnitud y direccin en una sola pasada que
+        // toma la luminancia de la imagen cargada al vuelo, en lugar de dos convoluciones 3x3
+        // que adems recortan la mitad negativa de cada derivada.
+        else if (opcion == 14) {
+            int nms, con_dir;
+            printf("Supresion de no maximos, bordes de un pixel de ancho (1 = si, 0 = no): ");
+            if (scanf("%d", &nms) != 1) break;
+            printf("Guardar tambien la direccion del gradiente en output_edges_dir.bmp (1 = si, 0 = no): ");
+            if (scanf("%d", &con_dir) != 1) break;
+            double inicio = wall_seconds();
+            GrayImage mag = { 0 }, dir = { 0 };
+            int ok = gray_image_alloc(&mag, w, h) && (!con_dir || gray_image_alloc(&dir, w, h));
+            if (ok) ok = sobel_edges_view(&img.view, &mag, con_dir ? &dir : NULL, nms != 0);
+            double segundos = wall_seconds() - inicio;
+            if (ok) ok = save_bmp_gray("output_edges.bmp", &mag) && (!con_dir || save_bmp_gray("output_edges_dir.bmp", &dir));
+            if (!ok) {
+                printf("No se pudo generar output_edges.bmp\n");
+            } else {
+                printf("Guardado output_edges.bmp%s\n", con_dir ? " y output_edges_dir.bmp" : "");
+            }
+            printf("Tiempo de ejecucin: %.4f segundos\n", segundos);
+            gray_image_free(&mag);
+            gray_image_free(&dir);
         }
         // Opcin 0: Salir del programa.
         else if (opcion == 0) {
@@ -398,12 +456,15 @@ int main() {
         }
     } while (opcion != 0); // El bucle termina si la opcin es 0 (salir).
 
-    if (img) free(img); // Libera la memoria de la imagen cargada si queda alguna.
+    bmp_unmap(&img); // Libera la imagen cargada si queda alguna.
     return 0; // Fin del programa.
 }
 
 /* --- Kernels de ejemplo para pruebas (copiar/pegar en consola) ---
 
+Sobel X y Sobel Y como convoluciones sueltas: cada una recorta a 0 los valores negativos. Para la
+magnitud completa del gradiente usar la opcin 14 o "edges" en una cadena.
+
 Sobel X (divisor 1):
 -1 0 1
 -2 0 2
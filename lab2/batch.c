@@ -0,0 +1,299 @@
+// batch.c
+// Lnea de montaje lectura -> filtrado -> escritura para carpetas de imgenes.
+
+#include "batch.h"
+#include "chain.h"
+#include "filters.h"
+#include "parallel.h"
+#include <stdio.h>      // Para printf, snprintf
+#include <stdlib.h>     // Para malloc, realloc, free, qsort
+#include <string.h>     // Para strcmp, strlen, strcpy
+#include <ctype.h>      // Para tolower
+#include <pthread.h>    // Para pthread_create, pthread_join, pthread_mutex_t, pthread_cond_t
+#include <dirent.h>     // Para opendir, readdir
+#include <sys/stat.h>   // Para mkdir
+
+#define BATCH_NAME_MAX 256
+#define BATCH_MAX_WORKERS 64
+
+// Una imagen en su paso por la lnea.
+typedef struct {
+    char name[BATCH_NAME_MAX];
+    Frame frame;
+    int ok;                    // 0 si alguna etapa fall (se informa al final de la lnea).
+    const char* error;
+    double t_read, t_filter, t_write;
+} BatchItem;
+
+// Cola acotada entre dos etapas: quien produce se bloquea cuando est llena, as la etapa ms
+// lenta marca el ritmo y no se acumulan imgenes decodificadas.
+typedef struct {
+    BatchItem** items;
+    int capacity, head, count;
+    int producers;             // Etapas que todava pueden agregar; con 0 la cola queda cerrada.
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty, not_full;
+} ItemQueue;
+
+static int queue_init(ItemQueue* q, int capacity, int producers) {
+    q->items = (BatchItem**)malloc(sizeof(BatchItem*) * capacity);
+    if (!q->items) return 0;
+    q->capacity = capacity;
+    q->head = q->count = 0;
+    q->producers = producers;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->not_empty, NULL);
+    pthread_cond_init(&q->not_full, NULL);
+    return 1;
+}
+
+static void queue_destroy(ItemQueue* q) {
+    free(q->items);
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->not_empty);
+    pthread_cond_destroy(&q->not_full);
+}
+
+static void queue_push(ItemQueue* q, BatchItem* it) {
+    pthread_mutex_lock(&q->lock);
+    while (q->count == q->capacity)
+        pthread_cond_wait(&q->not_full, &q->lock);
+    q->items[(q->head + q->count) % q->capacity] = it;
+    q->count++;
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+}
+
+// Devuelve NULL cuando la cola est vaca y ya no quedan productores.
+static BatchItem* queue_pop(ItemQueue* q) {
+    pthread_mutex_lock(&q->lock);
+    while (q->count == 0 && q->producers > 0)
+        pthread_cond_wait(&q->not_empty, &q->lock);
+    BatchItem* it = NULL;
+    if (q->count > 0) {
+        it = q->items[q->head];
+        q->head = (q->head + 1) % q->capacity;
+        q->count--;
+        pthread_cond_signal(&q->not_full);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return it;
+}
+
+static void queue_producer_done(ItemQueue* q) {
+    pthread_mutex_lock(&q->lock);
+    q->producers--;
+    if (q->producers == 0) pthread_cond_broadcast(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+}
+
+typedef struct {
+    const char* in_dir;
+    const char* out_dir;
+    char (*names)[BATCH_NAME_MAX];
+    int total;
+    OpChain chain;
+    ItemQueue to_filter, to_write;
+} BatchJob;
+
+// Etapa 1: decodifica los archivos en orden.
+static void* decode_stage(void* arg) {
+    BatchJob* job = (BatchJob*)arg;
+    for (int i = 0; i < job->total; i++) {
+        BatchItem* it = (BatchItem*)calloc(1, sizeof(BatchItem));
+        if (!it) { printf("Sin memoria para %s y las siguientes.\n", job->names[i]); break; }
+        strcpy(it->name, job->names[i]);
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/%s", job->in_dir, it->name);
+        double t0 = wall_seconds();
+        it->ok = load_bmp24(path, &it->frame.width, &it->frame.height, &it->frame.bgr);
+        it->t_read = wall_seconds() - t0;
+        if (!it->ok) it->error = "no se pudo leer";
+        queue_push(&job->to_filter, it);
+    }
+    queue_producer_done(&job->to_filter);
+    return NULL;
+}
+
+static void filter_item(BatchJob* job, BatchItem* it) {
+    if (!it->ok) return;
+    double t0 = wall_seconds();
+    it->ok = chain_apply(&job->chain, &it->frame);
+    it->t_filter = wall_seconds() - t0;
+    if (!it->ok) it->error = "sin memoria para filtrar";
+}
+
+// Etapa 2: cada trabajador aplica la cadena completa a una imagen.
+static void* filter_stage(void* arg) {
+    BatchJob* job = (BatchJob*)arg;
+    BatchItem* it;
+    while ((it = queue_pop(&job->to_filter)) != NULL) {
+        filter_item(job, it);
+        queue_push(&job->to_write, it);
+    }
+    queue_producer_done(&job->to_write);
+    return NULL;
+}
+
+typedef struct {
+    int done, failed;
+    double megapixels;
+} BatchStats;
+
+// Etapa 3: guarda el resultado, imprime su lnea y libera la imagen.
+static void write_item(BatchJob* job, BatchItem* it, BatchStats* stats) {
+    if (it->ok) {
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/%s", job->out_dir, it->name);
+        double t0 = wall_seconds();
+        it->ok = frame_save(&it->frame, path);
+        it->t_write = wall_seconds() - t0;
+        if (!it->ok) it->error = "no se pudo escribir";
+    }
+    if (it->ok) {
+        double mp = (double)it->frame.width * it->frame.height / 1e6;
+        double t = it->t_read + it->t_filter + it->t_write;
+        printf("  %-32s %6dx%-6d leer %7.1f ms  filtrar %7.1f ms  escribir %7.1f ms  %7.1f MP/s\n",
+               it->name, it->frame.width, it->frame.height, it->t_read * 1000, it->t_filter * 1000,
+               it->t_write * 1000, t > 0 ? mp / t : 0);
+        stats->megapixels += mp;
+        stats->done++;
+    } else {
+        printf("  %-32s ERROR: %s\n", it->name, it->error);
+        stats->failed++;
+    }
+    frame_free(&it->frame);
+    free(it);
+}
+
+static int has_bmp_extension(const char* name) {
+    size_t len = strlen(name);
+    if (len <= 4) return 0;
+    const char* ext = name + len - 4;
+    return ext[0] == '.' && tolower((unsigned char)ext[1]) == 'b'
+        && tolower((unsigned char)ext[2]) == 'm' && tolower((unsigned char)ext[3]) == 'p';
+}
+
+static int compare_names(const void* a, const void* b) {
+    return strcmp((const char*)a, (const char*)b);
+}
+
+// Lista los *.bmp de la carpeta ordenados por nombre. Devuelve la cantidad o -1 si no se pudo abrir.
+static int list_bmps(const char* dir_path, char (**out)[BATCH_NAME_MAX]) {
+    DIR* dir = opendir(dir_path);
+    if (!dir) {
+        printf("No se pudo abrir la carpeta: %s\n", dir_path);
+        return -1;
+    }
+    char (*names)[BATCH_NAME_MAX] = NULL;
+    int count = 0, capacity = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            continue;
+#ifdef _DIRENT_HAVE_D_TYPE
+        if (entry->d_type != DT_REG) continue;
+#endif
+        if (!has_bmp_extension(entry->d_name) || strlen(entry->d_name) >= BATCH_NAME_MAX)
+            continue;
+        if (count >= capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            char (*grown)[BATCH_NAME_MAX] = realloc(names, sizeof(*names) * capacity);
+            if (!grown) { printf("Sin memoria para la lista de archivos.\n"); break; }
+            names = grown;
+        }
+        strcpy(names[count++], entry->d_name);
+    }
+    closedir(dir);
+    qsort(names, count, sizeof(*names), compare_names);
+    *out = names;
+    return count;
+}
+
+int batch_run(const char* in_dir, const char* chain_spec, const char* out_dir, int workers) {
+    BatchJob job;
+    memset(&job, 0, sizeof(job));
+    job.in_dir = in_dir;
+    job.out_dir = out_dir;
+    if (!chain_parse(chain_spec, &job.chain)) return 0;
+
+    job.total = list_bmps(in_dir, &job.names);
+    if (job.total <= 0) {
+        if (job.total == 0) printf("No hay archivos .bmp en %s\n", in_dir);
+        chain_free(&job.chain);
+        free(job.names);
+        return 0;
+    }
+#ifdef _WIN32
+    mkdir(out_dir);
+#else
+    mkdir(out_dir, 0777);
+#endif
+
+    // Los filtros ya son paralelos por bandas: con varias imgenes a la vez se reparten los hilos
+    // entre ellas para no sobresuscribir la CPU. Con pocas CPU se filtra de a una imagen, pero la
+    // lectura y la escritura siguen solapadas con el filtrado.
+    int cpus = parallel_threads();
+    if (workers <= 0) workers = cpus >= 4 ? cpus / 2 : 1;
+    if (workers > BATCH_MAX_WORKERS) workers = BATCH_MAX_WORKERS;
+    if (workers > job.total) workers = job.total;
+    int inner = cpus / workers > 1 ? cpus / workers : 1;
+    filters_simd_level(); // Elige los kernels antes de arrancar los hilos.
+
+    // Capacidad de las colas = trabajadores: a lo sumo unas 3 * workers + 2 imgenes en memoria.
+    if (!queue_init(&job.to_filter, workers, 1) || !queue_init(&job.to_write, workers, workers)) {
+        printf("Sin memoria para las colas.\n");
+        free(job.to_filter.items);
+        chain_free(&job.chain);
+        free(job.names);
+        return 0;
+    }
+    parallel_set_threads(inner);
+    printf("Procesando %d imagenes con %d trabajador(es) de %d hilo(s)...\n", job.total, workers, inner);
+
+    double t_start = wall_seconds();
+    pthread_t decoder;
+    pthread_t filters[BATCH_MAX_WORKERS];
+    if (pthread_create(&decoder, NULL, decode_stage, &job) != 0) {
+        printf("No se pudo crear el hilo de lectura.\n");
+        parallel_set_threads(0);
+        queue_destroy(&job.to_filter);
+        queue_destroy(&job.to_write);
+        chain_free(&job.chain);
+        free(job.names);
+        return 0;
+    }
+    int started = 0;
+    for (int i = 0; i < workers; i++)
+        if (pthread_create(&filters[started], NULL, filter_stage, &job) == 0) started++;
+    // Los trabajadores que no arrancaron no van a cerrar su parte de la cola de escritura.
+    for (int i = started; i < workers; i++) queue_producer_done(&job.to_write);
+
+    // Etapa 3 en este hilo: escribe los resultados a medida que llegan. Si no arranc ningn
+    // trabajador, este hilo tambin filtra.
+    BatchStats stats = {0, 0, 0};
+    BatchItem* it;
+    if (started > 0) {
+        while ((it = queue_pop(&job.to_write)) != NULL) write_item(&job, it, &stats);
+    } else {
+        while ((it = queue_pop(&job.to_filter)) != NULL) {
+            filter_item(&job, it);
+            write_item(&job, it, &stats);
+        }
+    }
+
+    pthread_join(decoder, NULL);
+    for (int i = 0; i < started; i++) pthread_join(filters[i], NULL);
+    double elapsed = wall_seconds() - t_start;
+    parallel_set_threads(0);
+
+    printf("Listo: %d correctas, %d con error, %.1f MP en %.2f s (%.1f MP/s, %.1f imagenes/s)\n",
+           stats.done, stats.failed, stats.megapixels, elapsed,
+           elapsed > 0 ? stats.megapixels / elapsed : 0, elapsed > 0 ? stats.done / elapsed : 0);
+
+    queue_destroy(&job.to_filter);
+    queue_destroy(&job.to_write);
+    chain_free(&job.chain);
+    free(job.names);
+    return stats.failed == 0;
+}
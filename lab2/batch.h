@@ -0,0 +1,15 @@
+// batch.h
+// Procesamiento por lotes: aplica una cadena de operaciones (chain.h) a todos los BMP de una carpeta.
+// Trabaja como una lnea de montaje de tres etapas unidas por colas acotadas: un hilo lee y
+// decodifica, varios hilos filtran y un hilo codifica y escribe. As la lectura y escritura del
+// disco se solapan con el filtrado, y la cantidad de imgenes en memoria queda limitada.
+#ifndef BATCH_H
+#define BATCH_H
+
+// Procesa cada *.bmp de in_dir con la cadena chain_spec y guarda el resultado con el mismo nombre
+// en out_dir (se crea si no existe). workers es la cantidad de imgenes que se filtran a la vez
+// (<= 0: automtico); los hilos de cada filtro se reparten entre ellas.
+// Imprime una lnea por imagen y el rendimiento total. Devuelve 1 si todas se procesaron, 0 si no.
+int batch_run(const char* in_dir, const char* chain_spec, const char* out_dir, int workers);
+
+#endif
@@ -0,0 +1,320 @@
+// bench.c
+// Benchmark y verificacin de los filtros contra la implementacin original.
+
+#include "bench.h"
+#include "bmp.h"
+#include "filters.h"
+#include "parallel.h"
+#include <stdio.h>      // Para printf, snprintf, fopen, fread, remove
+#include <stdlib.h>     // Para malloc, free
+#include <string.h>     // Para memcpy, memcmp
+#include <math.h>       // Para sqrt
+
+static const int bench_sizes_mp[] = { 1, 4, 16, 64, 128 };
+#define BENCH_DEFAULT_MAX_MP 128
+#define BENCH_CHECK_ALL_KERNELS_MP 16 // Hasta este tamao se verifican todos los kernels de ejemplo.
+
+// --- IMPLEMENTACIN DE REFERENCIA ---
+// Las versiones originales, sin optimizar, contra las que se comparan las variantes rpidas.
+
+static int ref_load_bmp24(const char* path, int width, int height, BGR* pixels) {
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) return 0;
+    BITMAPFILEHEADER file_header;
+    BITMAPINFOHEADER info_header;
+    if (fread(&file_header, sizeof(file_header), 1, f) != 1 || fread(&info_header, sizeof(info_header), 1, f) != 1
+        || info_header.biWidth != width || (info_header.biHeight != height && info_header.biHeight != -height)) {
+        fclose(f);
+        return 0;
+    }
+    int is_bottom_up = info_header.biHeight > 0;
+    fseek(f, file_header.bfOffBits, SEEK_SET);
+    int pad = row_padding_24(width);
+    for (int y = 0; y < height; y++) {
+        int fila_destino = is_bottom_up ? (height - 1 - y) : y;
+        if (fread(pixels + (size_t)fila_destino * width, sizeof(BGR), width, f) != (size_t)width) {
+            fclose(f);
+            return 0;
+        }
+        fseek(f, pad, SEEK_CUR);
+    }
+    fclose(f);
+    return 1;
+}
+
+static void ref_to_grayscale(BGR* pixels, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        int gray = (int)(pixels[i].r * 299 + pixels[i].g * 587 + pixels[i].b * 114) / 1000;
+        uint8_t g = clampi(gray);
+        pixels[i].r = g;
+        pixels[i].g = g;
+        pixels[i].b = g;
+    }
+}
+
+static void ref_convolve3x3_gray(const BGR* src, BGR* dst, int width, int height, const int k[3][3], int divisor, int offset) {
+    if (divisor == 0) divisor = 1;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int suma = 0;
+            for (int ky = -1; ky <= 1; ky++) {
+                for (int kx = -1; kx <= 1; kx++) {
+                    int px = x + kx, py = y + ky;
+                    if (px >= 0 && px < width && py >= 0 && py < height)
+                        suma += src[(size_t)py * width + px].r * k[ky + 1][kx + 1];
+                }
+            }
+            uint8_t g = clampi(suma / divisor + offset);
+            dst[(size_t)y * width + x].r = g;
+            dst[(size_t)y * width + x].g = g;
+            dst[(size_t)y * width + x].b = g;
+        }
+    }
+}
+
+// --- UTILIDADES ---
+
+typedef struct {
+    const char* name;
+    int k[3][3];
+    int divisor, offset;
+} BenchKernel;
+
+// Los kernels de ejemplo de LAB2.c; el primero es el que se mide.
+static const BenchKernel bench_kernels[] = {
+    { "sharpen", { { 0, -1, 0 }, { -1, 5, -1 }, { 0, -1, 0 } }, 1, 0 },
+    { "blur", { { 1, 1, 1 }, { 1, 1, 1 }, { 1, 1, 1 } }, 9, 0 },
+    { "sobel x", { { -1, 0, 1 }, { -2, 0, 2 }, { -1, 0, 1 } }, 1, 0 },
+    { "laplace", { { -1, -1, -1 }, { -1, 8, -1 }, { -1, -1, -1 } }, 1, 128 },
+};
+
+// Imagen sinttica: degradados con ruido, para que la convolucin no vea zonas planas.
+static void bench_fill(BGR* p, int width, int height) {
+    uint32_t state = 12345;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++, p++) {
+            state = state * 1664525u + 1013904223u;
+            p->b = (uint8_t)((x * 255 / width) ^ (state >> 27));
+            p->g = (uint8_t)((y * 255 / height) + (state >> 29));
+            p->r = (uint8_t)((x + y) ^ (state >> 24));
+        }
+    }
+}
+
+// Imprime una fila de la tabla. bytes = bytes ledos + escritos por la operacin.
+static void bench_report(const char* name, double seconds, double megapixels, double bytes, const char* check) {
+    printf("  %-30s %9.1f ms %9.1f MP/s %7.2f GB/s  %s\n", name, seconds * 1000,
+           seconds > 0 ? megapixels / seconds : 0, seconds > 0 ? bytes / seconds / 1e9 : 0, check);
+}
+
+static const char* bench_check(int same, int* all_ok) {
+    if (!same) *all_ok = 0;
+    return same ? "OK" : "DIFIERE";
+}
+
+// Compara el canal r de una imagen BGR contigua con un plano de grises del mismo tamao.
+static int same_plane(const BGR* ref, const GrayImage* plane) {
+    for (int y = 0; y < plane->height; y++) {
+        const BGR* r = ref + (size_t)y * plane->width;
+        const uint8_t* p = gray_image_row(plane, y);
+        for (int x = 0; x < plane->width; x++)
+            if (r[x].r != p[x]) return 0;
+    }
+    return 1;
+}
+
+static const char* level_name(int level) {
+    return level == 2 ? "AVX2" : level == 1 ? "SSE2" : "escalar";
+}
+
+// --- BENCHMARK DE UN TAMAO ---
+
+typedef struct {
+    BGR *gen, *ref, *work, *ref_conv, *conv;
+    GrayImage plane_a, plane_b;
+} BenchBuffers;
+
+static void bench_buffers_free(BenchBuffers* b) {
+    free(b->gen);
+    free(b->ref);
+    free(b->work);
+    free(b->ref_conv);
+    free(b->conv);
+    gray_image_free(&b->plane_a);
+    gray_image_free(&b->plane_b);
+}
+
+// Mide y verifica todas las operaciones para una imagen de width x height (nominal_mp megapxeles,
+// que define las repeticiones). Devuelve 0 si no hay
+// memoria o no se pudo escribir el archivo; *all_ok queda en 0 si alguna variante difiere.
+static int bench_size(int nominal_mp, int width, int height, const char* path, int max_level, int* all_ok) {
+    const size_t n = (size_t)width * height;
+    const double mp = n / 1e6, bgr_bytes = 3.0 * n;
+    const double file_bytes = 54.0 + (double)(3 * (size_t)width + row_padding_24(width)) * height;
+    const int reps = nominal_mp <= 4 ? 5 : nominal_mp <= 16 ? 3 : 1;
+    BenchBuffers b;
+    memset(&b, 0, sizeof(b));
+    b.gen = (BGR*)malloc(n * sizeof(BGR));
+    b.ref = (BGR*)malloc(n * sizeof(BGR));
+    b.work = (BGR*)malloc(n * sizeof(BGR));
+    b.ref_conv = (BGR*)malloc(n * sizeof(BGR));
+    b.conv = (BGR*)malloc(n * sizeof(BGR));
+    if (!b.gen || !b.ref || !b.work || !b.ref_conv || !b.conv
+        || !gray_image_alloc(&b.plane_a, width, height) || !gray_image_alloc(&b.plane_b, width, height)) {
+        printf("  Sin memoria para %.0f MP, se omite.\n", mp);
+        bench_buffers_free(&b);
+        return 0;
+    }
+    printf("\n%dx%d (%.1f MP, archivo de %.1f MB, mejor de %d)\n", width, height, mp, file_bytes / 1e6, reps);
+    bench_fill(b.gen, width, height);
+
+    // Guardado: se verifica releyendo el archivo con el lector original.
+    double best = 1e30, t;
+    int ok = 1;
+    for (int r = 0; r < reps && ok; r++) {
+        t = wall_seconds();
+        ok = save_bmp24(path, width, height, b.gen);
+        t = wall_seconds() - t;
+        if (t < best) best = t;
+    }
+    if (!ok) {
+        printf("  No se pudo escribir %s\n", path);
+        bench_buffers_free(&b);
+        return 0;
+    }
+    int same = ref_load_bmp24(path, width, height, b.ref) && memcmp(b.ref, b.gen, n * sizeof(BGR)) == 0;
+    bench_report("save_bmp24", best, mp, bgr_bytes + file_bytes, bench_check(same, all_ok));
+
+    // Carga (el archivo recin escrito est en la cach del sistema: mide el parseo y la copia).
+    best = 1e30;
+    same = 1;
+    for (int r = 0; r < reps; r++) {
+        int w, h;
+        BGR* pixels = NULL;
+        t = wall_seconds();
+        ok = load_bmp24(path, &w, &h, &pixels);
+        t = wall_seconds() - t;
+        if (t < best) best = t;
+        same = same && ok && w == width && h == height && memcmp(pixels, b.gen, n * sizeof(BGR)) == 0;
+        free(pixels);
+    }
+    bench_report("load_bmp24", best, mp, file_bytes + bgr_bytes, bench_check(same, all_ok));
+
+    MappedBmp m = { 0 };
+    best = 1e30;
+    same = 0;
+    if (bmp_map(path, &m)) {
+        same = 1;
+        for (int y = 0; y < height && same; y++)
+            same = memcmp(bgr_view_row(&m.view, y), b.gen + (size_t)y * width, (size_t)width * sizeof(BGR)) == 0;
+    }
+
+    // Grises: la referencia y cada nivel SIMD disponible.
+    memcpy(b.ref, b.gen, n * sizeof(BGR));
+    t = wall_seconds();
+    ref_to_grayscale(b.ref, n);
+    bench_report("to_grayscale (referencia)", wall_seconds() - t, mp, 2 * bgr_bytes, "");
+    char name[64];
+    for (int level = 0; level <= max_level; level++) {
+        filters_set_simd_level(level);
+        best = 1e30;
+        for (int r = 0; r < reps; r++) {
+            memcpy(b.work, b.gen, n * sizeof(BGR));
+            t = wall_seconds();
+            to_grayscale(b.work, width, height);
+            t = wall_seconds() - t;
+            if (t < best) best = t;
+        }
+        snprintf(name, sizeof(name), "to_grayscale [%s]", level_name(level));
+        bench_report(name, best, mp, 2 * bgr_bytes, bench_check(memcmp(b.work, b.ref, n * sizeof(BGR)) == 0, all_ok));
+    }
+    if (m.view.data) {
+        best = 1e30;
+        for (int r = 0; r < reps; r++) {
+            t = wall_seconds();
+            to_grayscale_view(&m.view, &b.plane_a);
+            t = wall_seconds() - t;
+            if (t < best) best = t;
+        }
+        snprintf(name, sizeof(name), "to_grayscale_view [%s]", level_name(max_level));
+        bench_report(name, best, mp, bgr_bytes + n, bench_check(same && same_plane(b.ref, &b.plane_a), all_ok));
+    }
+    bmp_unmap(&m);
+
+    // Convolucin 3x3 sobre la imagen en grises de referencia.
+    int kernels = nominal_mp <= BENCH_CHECK_ALL_KERNELS_MP ? (int)(sizeof(bench_kernels) / sizeof(bench_kernels[0])) : 1;
+    for (int y = 0; y < height; y++) { // Entrada planar para convolve3x3_plane.
+        uint8_t* p = gray_image_row(&b.plane_b, y);
+        for (int x = 0; x < width; x++) p[x] = b.ref[(size_t)y * width + x].r;
+    }
+    for (int kk = 0; kk < kernels; kk++) {
+        const BenchKernel* bk = &bench_kernels[kk];
+        t = wall_seconds();
+        ref_convolve3x3_gray(b.ref, b.ref_conv, width, height, bk->k, bk->divisor, bk->offset);
+        t = wall_seconds() - t;
+        if (kk == 0) bench_report("convolve3x3_gray (referencia)", t, mp, 2 * bgr_bytes, "");
+        for (int level = 0; level <= max_level; level++) {
+            filters_set_simd_level(level);
+            best = 1e30;
+            int ran = 1; // Sin memoria la salida queda incompleta: cuenta como diferencia.
+            for (int r = 0; r < (kk == 0 ? reps : 1); r++) {
+                t = wall_seconds();
+                ran &= convolve3x3_gray(b.ref, b.conv, width, height, bk->k, bk->divisor, bk->offset);
+                t = wall_seconds() - t;
+                if (t < best) best = t;
+            }
+            same = ran && memcmp(b.conv, b.ref_conv, n * sizeof(BGR)) == 0;
+            if (kk == 0) {
+                snprintf(name, sizeof(name), "convolve3x3_gray [%s]", level_name(level));
+                bench_report(name, best, mp, 2 * bgr_bytes, bench_check(same, all_ok));
+            } else if (!same) {
+                printf("  convolve3x3_gray [%s] con %s: DIFIERE\n", level_name(level), bk->name);
+                *all_ok = 0;
+            }
+        }
+        best = 1e30;
+        int ran = 1;
+        for (int r = 0; r < (kk == 0 ? reps : 1); r++) {
+            t = wall_seconds();
+            ran &= convolve3x3_plane(&b.plane_b, &b.plane_a, bk->k, bk->divisor, bk->offset);
+            t = wall_seconds() - t;
+            if (t < best) best = t;
+        }
+        same = ran && same_plane(b.ref_conv, &b.plane_a);
+        if (kk == 0) {
+            snprintf(name, sizeof(name), "convolve3x3_plane [%s]", level_name(max_level));
+            bench_report(name, best, mp, 2.0 * n, bench_check(same, all_ok));
+        } else if (!same) {
+            printf("  convolve3x3_plane con %s: DIFIERE\n", bk->name);
+            *all_ok = 0;
+        }
+    }
+    if (kernels > 1) printf("  (convolucin verificada tambin con blur, sobel x y laplace)\n");
+
+    bench_buffers_free(&b);
+    return 1;
+}
+
+int bench_run(int max_mp, const char* dir) {
+    if (max_mp <= 0) max_mp = BENCH_DEFAULT_MAX_MP;
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/lab2_bench.bmp", dir ? dir : ".");
+    int max_level = filters_set_simd_level(2); // El mayor nivel que soporta la CPU.
+    printf("Benchmark: %d hilo(s), SIMD hasta %s. GB/s = (bytes leidos + escritos) / tiempo.\n",
+           parallel_threads(), level_name(max_level));
+
+    int all_ok = 1;
+    for (size_t i = 0; i < sizeof(bench_sizes_mp) / sizeof(bench_sizes_mp[0]); i++) {
+        int mp = bench_sizes_mp[i];
+        if (mp > max_mp) break;
+        // 4:3 con ancho impar, para que las filas del archivo lleven padding.
+        int width = (int)(1154.7 * sqrt((double)mp)) | 1;
+        int height = (int)((double)mp * 1e6 / width + 0.5);
+        if (!bench_size(mp, width, height, path, max_level, &all_ok)) break;
+    }
+    remove(path);
+    filters_set_simd_level(-1);
+    printf(all_ok ? "\nTodas las variantes coinciden con la referencia.\n"
+                  : "\nATENCION: alguna variante no coincide con la referencia.\n");
+    return all_ok;
+}
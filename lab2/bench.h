@@ -0,0 +1,14 @@
+// bench.h
+// Benchmark de los filtros con imgenes sintticas de 1 a ms de 100 megapxeles. Mide por separado
+// la carga, la conversin a grises, la convolucin y el guardado (sin mezclar E/S con clculo, a
+// diferencia de los tiempos del men) y verifica cada variante optimizada contra la implementacin
+// original.
+#ifndef BENCH_H
+#define BENCH_H
+
+// Genera las imgenes de prueba de hasta max_mp megapxeles (<= 0: hasta 128) en la carpeta dir
+// (NULL: la actual), imprime la tabla de tiempos, MP/s y GB/s, y las borra al terminar.
+// Devuelve 1 si todas las variantes coinciden con la referencia, 0 si alguna difiere o hubo un error.
+int bench_run(int max_mp, const char* dir);
+
+#endif
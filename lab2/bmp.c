@@ -0,0 +1,659 @@
+// bmp.c
+// Lectura y escritura de imgenes BMP, completas o por lotes de filas.
+
+#include "bmp.h"
+#include "pixfmt.h"
+#include "filemap.h"
+#include "parallel.h"
+#include <stdio.h>      // Para entrada y salida estndar: printf, fopen, fclose, fread, fwrite, fseek
+#include <stdlib.h>     // Para manejo de memoria dinmica: malloc, free
+#include <string.h>     // Para memset, memcpy
+#include <sys/types.h>  // Para off_t (fseeko)
+#ifdef _WIN32
+#include <malloc.h>     // Para _aligned_malloc, _aligned_free
+#endif
+
+// FUNCIN row_padding_24
+// Calcula cuntos bytes de relleno (padding) necesita cada fila de pxeles para que su tamao sea mltiplo de 4 bytes, segn la especificacin BMP.
+// Parmetro: width -> ancho de la imagen en pxeles.
+// Retorno: nmero de bytes de padding por fila.
+int row_padding_24(int width) {
+    int row_bytes = width * 3; // Cada pxel ocupa 3 bytes (B, G, R).
+    int resto = row_bytes % 4; // Calcula el resto al dividir row_bytes entre 4.
+    if (resto == 0) {
+        return 0; // Si ya es mltiplo de 4, no necesita padding.
+    } else {
+        return 4 - resto; // Si no, necesita 4 - resto bytes de padding.
+    }
+}
+
+// Posiciona el archivo en un offset de 64 bits (los BMP grandes superan los 2 GB que cubre fseek con long).
+static int bmp_seek(FILE* f, int64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(f, offset, SEEK_SET);
+#else
+    return fseeko(f, (off_t)offset, SEEK_SET);
+#endif
+}
+
+// Mximo de bytes que se leen entre la cabecera de informacin y los pxeles: la cabecera V5
+// (124 bytes) ms una paleta de 256 colores, con margen.
+#define BMP_EXTRA_MAX 2048
+
+// Valida que los encabezados describan un BMP soportado con dimensiones soportadas e interpreta su
+// formato de pxel en pf. extra son los bytes que siguen a los 40 de la cabecera de informacin.
+// Retorno: 1 si es vlido, 0 si no (con el motivo impreso en consola).
+static int bmp_check_headers(const BITMAPFILEHEADER* fh, const BITMAPINFOHEADER* ih,
+                             const uint8_t* extra, size_t extra_len, PixelFormat* pf) {
+    // Validacin: verifica que el archivo es un BMP vlido.
+    if (fh->bfType != 0x4D42) { // 'BM' en hexadecimal es 0x4D42.
+        printf("El archivo no es un BMP vlido (no empieza con 'BM').\n");
+        return 0;
+    }
+    if (ih->biSize < sizeof(BITMAPINFOHEADER)) {
+        printf("Cabecera BMP no soportada (%u bytes).\n", (unsigned)ih->biSize);
+        return 0;
+    }
+
+    // Dimensiones vlidas: ancho positivo, alto distinto de 0 (negativo = top-down) y filas que
+    // quepan en un int al medirlas en bytes, tanto en el archivo como en BGR.
+    if (ih->biWidth <= 0 || ih->biWidth > BMP_MAX_WIDTH ||
+        ih->biHeight == 0 || ih->biHeight == INT32_MIN) {
+        printf("Dimensiones de imagen no soportadas: %dx%d\n", (int)ih->biWidth, (int)ih->biHeight);
+        return 0;
+    }
+
+    // Profundidad de color y compresin (24 bits, paleta, 16 o 32 bits con o sin mscaras).
+    if (!pixfmt_init(pf, ih, extra, extra_len)) return 0;
+    if (pixfmt_row_bytes(pf, ih->biWidth) > INT32_MAX) {
+        printf("Dimensiones de imagen no soportadas: %dx%d\n", (int)ih->biWidth, (int)ih->biHeight);
+        return 0;
+    }
+    return 1;
+}
+
+// --- Lectura incremental ---
+
+// FUNCIN bmp_reader_open
+// Abre un BMP, valida sus encabezados y prepara el buffer de lotes de filas (y el de conversin
+// si el archivo no es de 24 bits).
+// Parmetros:
+//   r    -> lector a inicializar.
+//   path -> ruta del archivo BMP a leer.
+// Retorno: 1 si tuvo xito, 0 si hubo error.
+int bmp_reader_open(BmpReader* r, const char* path) {
+    memset(r, 0, sizeof(*r));
+    FILE* f = fopen(path, "rb"); // Abre el archivo para lectura en modo binario.
+    if (f == NULL) {
+        printf("No se pudo abrir el archivo: %s\n", path);
+        return 0; // Error al abrir.
+    }
+
+    BITMAPFILEHEADER file_header; // Variable para almacenar el encabezado de archivo BMP.
+    BITMAPINFOHEADER info_header; // Variable para almacenar el encabezado de informacin BMP.
+
+    // Lee el encabezado de archivo. Debe leerse toda la estructura.
+    if (fread(&file_header, sizeof(file_header), 1, f) != 1) {
+        printf("No se pudo leer la cabecera del archivo.\n");
+        fclose(f);
+        return 0;
+    }
+    // Lee el encabezado de informacin.
+    if (fread(&info_header, sizeof(info_header), 1, f) != 1) {
+        printf("No se pudo leer la cabecera de informacin.\n");
+        fclose(f);
+        return 0;
+    }
+
+    // Mscaras y paleta: entre los 40 bytes de la cabecera y el inicio de los pxeles.
+    uint8_t extra[BMP_EXTRA_MAX];
+    size_t extra_len = 0;
+    if (file_header.bfOffBits > sizeof(file_header) + sizeof(info_header)) {
+        size_t want = file_header.bfOffBits - sizeof(file_header) - sizeof(info_header);
+        extra_len = fread(extra, 1, want < sizeof(extra) ? want : sizeof(extra), f);
+    }
+    r->fmt = (PixelFormat*)malloc(sizeof(PixelFormat));
+    if (r->fmt == NULL) {
+        printf("No hay suficiente memoria para leer la imagen.\n");
+        fclose(f);
+        return 0;
+    }
+    if (!bmp_check_headers(&file_header, &info_header, extra, extra_len, r->fmt)) {
+        free(r->fmt);
+        r->fmt = NULL;
+        fclose(f);
+        return 0;
+    }
+
+    r->f = f;
+    r->width = info_header.biWidth; // Ancho en pxeles.
+    r->height = info_header.biHeight > 0 ? info_header.biHeight : -info_header.biHeight; // El alto puede ser negativo.
+    r->bottom_up = info_header.biHeight > 0; // Si es positivo, la imagen se almacena de abajo hacia arriba.
+    r->row_bytes = pixfmt_row_bytes(r->fmt, r->width); // Bytes por fila en el archivo.
+    r->data_offset = file_header.bfOffBits; // Inicio de los datos de la imagen.
+
+    // Lotes de BMP_BATCH_BYTES: pocas lecturas grandes en vez de una lectura y un fseek por fila.
+    size_t rows = BMP_BATCH_BYTES / r->row_bytes;
+    if (rows < 1) rows = 1;
+    if (rows > (size_t)r->height) rows = r->height;
+    r->buf_rows = (int)rows;
+    r->buf = (uint8_t*)malloc(rows * r->row_bytes);
+    if (r->fmt->kind != PIX_BGR24) r->row = (BGR*)malloc((size_t)r->width * sizeof(BGR));
+    if (r->buf == NULL || (r->fmt->kind != PIX_BGR24 && r->row == NULL)) {
+        printf("No hay suficiente memoria para leer la imagen.\n");
+        bmp_reader_close(r);
+        return 0;
+    }
+    return 1;
+}
+
+// Devuelve la siguiente fila tal como est en el archivo, de arriba hacia abajo, sin importar la
+// orientacin. Cuando se agota el lote actual lee el siguiente con un solo fread: en archivos
+// bottom-up el lote es el bloque contiguo que termina donde empez el anterior.
+// Retorno: puntero a la fila dentro del lote, o NULL si no quedan filas o hubo un error de lectura.
+static const uint8_t* bmp_reader_next_raw(BmpReader* r) {
+    if (r->f == NULL || r->next_row >= r->height) return NULL;
+    if (r->next_row >= r->buf_first + r->buf_count) {
+        int count = r->height - r->next_row;
+        if (count > r->buf_rows) count = r->buf_rows;
+        // Filas del archivo que contienen las filas lgicas [next_row, next_row + count).
+        int file_first = r->bottom_up ? r->height - r->next_row - count : r->next_row;
+        size_t bytes = (size_t)count * r->row_bytes;
+        if (bmp_seek(r->f, r->data_offset + (int64_t)file_first * (int64_t)r->row_bytes) != 0 ||
+            fread(r->buf, 1, bytes, r->f) != bytes) {
+            printf("Error leyendo los datos de la imagen.\n");
+            return NULL;
+        }
+        r->buf_first = r->next_row;
+        r->buf_count = count;
+        r->buf_file_first = file_first;
+    }
+    int file_row = r->bottom_up ? r->height - 1 - r->next_row : r->next_row;
+    r->next_row++;
+    return r->buf + (size_t)(file_row - r->buf_file_first) * r->row_bytes;
+}
+
+// FUNCIN bmp_reader_next_row
+// Devuelve la siguiente fila de la imagen en BGR, de arriba hacia abajo. Si el archivo es de 24
+// bits es un puntero al lote (sin copiar); si no, la fila convertida en el buffer del lector.
+// Retorno: puntero a width pxeles (vlido hasta la prxima llamada), o NULL si no quedan filas
+// o hubo un error de lectura.
+const BGR* bmp_reader_next_row(BmpReader* r) {
+    const uint8_t* raw = bmp_reader_next_raw(r);
+    if (raw == NULL || r->row == NULL) return (const BGR*)raw;
+    pixfmt_row_to_bgr(r->fmt, raw, r->row, (size_t)r->width);
+    return r->row;
+}
+
+// Copia hasta max_rows filas siguientes (sin padding) en dst. Devuelve cuntas copi, 0 al final
+// de la imagen o -1 si hubo un error de lectura.
+// Las filas se convierten directamente en dst, sin pasar por el buffer del lector.
+int bmp_reader_read_rows(BmpReader* r, BGR* dst, int max_rows) {
+    int n = 0;
+    while (n < max_rows && r->next_row < r->height) {
+        const uint8_t* raw = bmp_reader_next_raw(r);
+        if (raw == NULL) return -1;
+        pixfmt_row_to_bgr(r->fmt, raw, dst + (size_t)n * r->width, (size_t)r->width);
+        n++;
+    }
+    return n;
+}
+
+int bmp_reader_read_rows_bgra(BmpReader* r, BGRA* dst, int max_rows) {
+    int n = 0;
+    while (n < max_rows && r->next_row < r->height) {
+        const uint8_t* raw = bmp_reader_next_raw(r);
+        if (raw == NULL) return -1;
+        pixfmt_row_to_bgra(r->fmt, raw, dst + (size_t)n * r->width, (size_t)r->width);
+        n++;
+    }
+    return n;
+}
+
+void bmp_reader_close(BmpReader* r) {
+    if (r->f) fclose(r->f);
+    free(r->buf);
+    free(r->fmt);
+    free(r->row);
+    r->f = NULL;
+    r->buf = NULL;
+    r->fmt = NULL;
+    r->row = NULL;
+}
+
+// FUNCIN cargar_bmp24
+// Carga en memoria una imagen BMP como BGR de 24 bits, validando su formato y leyendo los datos de
+// los pxeles por lotes con el lector incremental (que convierte los otros formatos).
+// Parmetros:
+//   path      -> ruta del archivo BMP a leer.
+//   out_w     -> puntero donde se almacenar el ancho de la imagen.
+//   out_h     -> puntero donde se almacenar el alto de la imagen.
+//   out_pixels-> puntero donde se almacenar el buffer de pxeles ledos (memoria dinmica).
+// Retorno: 1 si tuvo xito, 0 si hubo error.
+int load_bmp24(const char* path, int* out_w, int* out_h, BGR** out_pixels) {
+    BmpReader r;
+    if (!bmp_reader_open(&r, path)) return 0;
+    int width = r.width, height = r.height;
+
+    // Reserva memoria dinmica para almacenar todos los pxeles de la imagen. El tamao se calcula
+    // en size_t y se verifica que no desborde.
+    if ((size_t)height > SIZE_MAX / sizeof(BGR) / (size_t)width) {
+        printf("No hay suficiente memoria para cargar la imagen.\n");
+        bmp_reader_close(&r);
+        return 0;
+    }
+    BGR* pixels = (BGR*)malloc((size_t)width * (size_t)height * sizeof(BGR));
+    if (pixels == NULL) {
+        printf("No hay suficiente memoria para cargar la imagen.\n");
+        bmp_reader_close(&r);
+        return 0;
+    }
+
+    // Lee todas las filas; el lector ya las entrega de arriba hacia abajo.
+    if (bmp_reader_read_rows(&r, pixels, height) != height) {
+        free(pixels);
+        bmp_reader_close(&r);
+        return 0;
+    }
+
+    bmp_reader_close(&r); // Cierra el archivo.
+    *out_w = width;         // Devuelve el ancho.
+    *out_h = height;        // Devuelve el alto.
+    *out_pixels = pixels;   // Devuelve el buffer de pxeles.
+    return 1; // xito.
+}
+// FIN FUNCIN load_bmp24
+
+// FUNCIN load_bmp32
+// Como load_bmp24, pero deja la imagen en formato BGRA (4 bytes por pxel).
+int load_bmp32(const char* path, int* out_w, int* out_h, BGRA** out_pixels) {
+    BmpReader r;
+    if (!bmp_reader_open(&r, path)) return 0;
+    int width = r.width, height = r.height;
+    if ((size_t)height > SIZE_MAX / sizeof(BGRA) / (size_t)width) {
+        printf("No hay suficiente memoria para cargar la imagen.\n");
+        bmp_reader_close(&r);
+        return 0;
+    }
+    BGRA* pixels = (BGRA*)malloc((size_t)width * (size_t)height * sizeof(BGRA));
+    if (pixels == NULL) {
+        printf("No hay suficiente memoria para cargar la imagen.\n");
+        bmp_reader_close(&r);
+        return 0;
+    }
+    if (bmp_reader_read_rows_bgra(&r, pixels, height) != height) {
+        free(pixels);
+        bmp_reader_close(&r);
+        return 0;
+    }
+    bmp_reader_close(&r);
+    *out_w = width;
+    *out_h = height;
+    *out_pixels = pixels;
+    return 1;
+}
+
+
+// --- Proyeccin en memoria ---
+
+// Conversin a BGR de las filas de un BMP proyectado que no es de 24 bits, por bandas.
+typedef struct {
+    const PixelFormat* fmt;
+    const uint8_t* top;   // Fila superior del archivo proyectado.
+    ptrdiff_t stride;     // Bytes hasta la fila siguiente (negativo si es bottom-up).
+    BGR* dst;
+    int width;
+} MapDecodeJob;
+
+static void map_decode_band(void* ctx, int y0, int y1) {
+    MapDecodeJob* job = (MapDecodeJob*)ctx;
+    for (int y = y0; y < y1; y++)
+        pixfmt_row_to_bgr(job->fmt, job->top + (ptrdiff_t)y * job->stride,
+                          job->dst + (size_t)y * job->width, (size_t)job->width);
+}
+
+// FUNCIN bmp_map
+// Proyecta un BMP de 24 bits en memoria y arma una vista de arriba hacia abajo sobre sus pxeles,
+// sin copiarlos: en un archivo bottom-up la vista empieza en la ltima fila del archivo y avanza
+// con stride negativo. Si el archivo est en otro formato, se convierte a una copia BGR leyendo
+// de la proyeccin y la proyeccin se libera enseguida.
+// Parmetros:
+//   path -> ruta del archivo BMP.
+//   m    -> imagen proyectada a inicializar.
+// Retorno: 1 si tuvo xito, 0 si hubo error.
+int bmp_map(const char* path, MappedBmp* m) {
+    memset(m, 0, sizeof(*m));
+    const void* base;
+    size_t size;
+    if (!file_map_readonly(path, &base, &size)) {
+        // Sin proyeccin (o archivo inaccesible): se carga una copia con la lectura normal, que
+        // adems informa el error si el archivo no existe o no es vlido.
+        int w, h;
+        if (!load_bmp24(path, &w, &h, &m->copy)) return 0;
+        m->view = bgr_view_packed(m->copy, w, h);
+        return 1;
+    }
+
+    BITMAPFILEHEADER file_header;
+    BITMAPINFOHEADER info_header;
+    if (size < sizeof(file_header) + sizeof(info_header)) {
+        printf("No se pudo leer la cabecera del archivo.\n");
+        file_unmap(base, size);
+        return 0;
+    }
+    memcpy(&file_header, base, sizeof(file_header)); // Copia para no depender de la alineacin.
+    memcpy(&info_header, (const uint8_t*)base + sizeof(file_header), sizeof(info_header));
+    size_t headers = sizeof(file_header) + sizeof(info_header);
+    size_t extra_end = file_header.bfOffBits < size ? file_header.bfOffBits : size;
+    PixelFormat fmt;
+    if (!bmp_check_headers(&file_header, &info_header, (const uint8_t*)base + headers,
+                           extra_end > headers ? extra_end - headers : 0, &fmt)) {
+        file_unmap(base, size);
+        return 0;
+    }
+
+    int width = info_header.biWidth;
+    int height = info_header.biHeight > 0 ? info_header.biHeight : -info_header.biHeight;
+    size_t row_bytes = pixfmt_row_bytes(&fmt, width);
+    // Todas las filas deben estar dentro del archivo.
+    if (file_header.bfOffBits > size || (size - file_header.bfOffBits) / row_bytes < (size_t)height) {
+        printf("Error leyendo los datos de la imagen.\n");
+        file_unmap(base, size);
+        return 0;
+    }
+
+    const uint8_t* pixels = (const uint8_t*)base + file_header.bfOffBits;
+    if (fmt.kind != PIX_BGR24) {
+        MapDecodeJob job;
+        job.fmt = &fmt;
+        job.top = info_header.biHeight > 0 ? pixels + (size_t)(height - 1) * row_bytes : pixels;
+        job.stride = info_header.biHeight > 0 ? -(ptrdiff_t)row_bytes : (ptrdiff_t)row_bytes;
+        job.width = width;
+        job.dst = (size_t)height <= SIZE_MAX / sizeof(BGR) / (size_t)width
+                ? (BGR*)malloc((size_t)width * (size_t)height * sizeof(BGR)) : NULL;
+        if (job.dst == NULL) {
+            printf("No hay suficiente memoria para cargar la imagen.\n");
+            file_unmap(base, size);
+            return 0;
+        }
+        parallel_rows(height, parallel_band_rows(height, row_bytes + (size_t)width * sizeof(BGR)),
+                      map_decode_band, &job);
+        file_unmap(base, size);
+        m->copy = job.dst;
+        m->view = bgr_view_packed(m->copy, width, height);
+        return 1;
+    }
+    m->base = base;
+    m->size = size;
+    m->view.width = width;
+    m->view.height = height;
+    if (info_header.biHeight > 0) {
+        // Bottom-up: la fila superior es la ltima del archivo.
+        m->view.data = pixels + (size_t)(height - 1) * row_bytes;
+        m->view.stride = -(ptrdiff_t)row_bytes;
+    } else {
+        m->view.data = pixels;
+        m->view.stride = (ptrdiff_t)row_bytes;
+    }
+    return 1;
+}
+
+int bmp_map_to_copy(MappedBmp* m) {
+    if (m->base == NULL) return 1; // Ya es una copia (o est vaca).
+    BgrView v = m->view;
+    BGR* copy = (BGR*)malloc((size_t)v.width * v.height * sizeof(BGR));
+    if (copy == NULL) {
+        printf("Sin memoria para copiar la imagen.\n");
+        return 0;
+    }
+    for (int y = 0; y < v.height; y++)
+        memcpy(copy + (size_t)y * v.width, bgr_view_row(&v, y), (size_t)v.width * sizeof(BGR));
+    file_unmap(m->base, m->size);
+    m->base = NULL;
+    m->size = 0;
+    m->copy = copy;
+    m->view = bgr_view_packed(copy, v.width, v.height);
+    return 1;
+}
+
+void bmp_unmap(MappedBmp* m) {
+    if (m->base) file_unmap(m->base, m->size);
+    free(m->copy);
+    memset(m, 0, sizeof(*m));
+}
+
+// Escribe los encabezados de un BMP top-down de width x height y bits (24 o 32) por pxel.
+// Compartida por save_bmp24, save_bmp32 y save_bmp_gray.
+static void write_bmp_headers(FILE* f, int width, int height, int bits) {
+    uint64_t row_bytes = bits == 32 ? (uint64_t)width * 4 // Bytes por fila (pxeles + padding).
+                                    : (uint64_t)width * 3 + row_padding_24(width);
+    uint64_t img_bytes = row_bytes * (uint64_t)height; // Tamao total de los datos de imagen.
+    uint64_t file_bytes = sizeof(BITMAPFILEHEADER) + sizeof(BITMAPINFOHEADER) + img_bytes;
+
+    // Prepara los encabezados BMP para el archivo de salida.
+    BITMAPFILEHEADER file_header;
+    BITMAPINFOHEADER info_header;
+
+    // Completa los campos del encabezado de archivo BMP.
+    file_header.bfType = 0x4D42; // 'BM'
+    file_header.bfSize = file_bytes <= UINT32_MAX ? (uint32_t)file_bytes : 0; // Tamao total del archivo (0 si no cabe en 32 bits).
+    file_header.bfReserved1 = 0; // Reservado, siempre 0.
+    file_header.bfReserved2 = 0; // Reservado, siempre 0.
+    file_header.bfOffBits = sizeof(BITMAPFILEHEADER) + sizeof(BITMAPINFOHEADER); // Offset donde empiezan los datos de la imagen.
+
+    // Completa los campos del encabezado de informacin BMP.
+    info_header.biSize = sizeof(BITMAPINFOHEADER); // Debe ser 40.
+    info_header.biWidth = width;                   // Ancho.
+    info_header.biHeight = -height;                // Negativo para top-down (la primera fila en memoria es la primera en archivo).
+    info_header.biPlanes = 1;                      // Siempre 1.
+    info_header.biBitCount = (uint16_t)bits;       // 24 o 32 bits por pxel.
+    info_header.biCompression = 0;                 // Sin compresin.
+    info_header.biSizeImage = img_bytes <= UINT32_MAX ? (uint32_t)img_bytes : 0; // Tamao de los datos (0 es vlido sin compresin).
+    info_header.biXPelsPerMeter = 0;               // Resolucin horizontal (opcional).
+    info_header.biYPelsPerMeter = 0;               // Resolucin vertical (opcional).
+    info_header.biClrUsed = 0;                     // N de colores usados, 0 para todos.
+    info_header.biClrImportant = 0;                // N de colores importantes, 0 para todos.
+
+    // Escribe los encabezados en el archivo de salida.
+    fwrite(&file_header, sizeof(file_header), 1, f);
+    fwrite(&info_header, sizeof(info_header), 1, f);
+}
+
+// FUNCIN save_bmp24
+// Guarda una imagen en memoria en formato BMP de 24 bits en disco.
+// Parmetros:
+//   path   -> ruta o nombre del archivo BMP de salida.
+//   width  -> ancho de la imagen en pxeles.
+//   height -> alto de la imagen en pxeles.
+//   pixels -> buffer con los pxeles a guardar.
+// Retorno: 1 si tuvo xito, 0 si hubo error.
+int save_bmp24(const char* path, int width, int height, const BGR* pixels) {
+    BmpWriter w;
+    if (!bmp_writer_open(&w, path, width, height)) return 0;
+    // El escritor junta las filas con su padding en lotes y escribe cada lote con un solo fwrite.
+    for (int y = 0; y < height; y++) {
+        if (!bmp_writer_row(&w, pixels + (size_t)y * width)) break;
+    }
+    int ok = bmp_writer_close(&w); // Cierra el archivo de salida.
+    if (!ok) printf("Error escribiendo %s\n", path);
+    return ok;
+}
+
+// FUNCIN save_bmp32
+// Guarda un buffer BGRA como BMP de 32 bits sin compresin (BI_RGB): las filas no llevan padding.
+int save_bmp32(const char* path, int width, int height, const BGRA* pixels) {
+    BmpWriter w;
+    if (!bmp_writer_open32(&w, path, width, height)) return 0;
+    for (int y = 0; y < height; y++) {
+        if (!bmp_writer_bgra_row(&w, pixels + (size_t)y * width)) break;
+    }
+    int ok = bmp_writer_close(&w);
+    if (!ok) printf("Error escribiendo %s\n", path);
+    return ok;
+}
+
+// --- Imgenes de grises planares ---
+
+void* image_alloc_aligned(size_t size) {
+    if (size == 0) size = 1;
+#ifdef _WIN32
+    return _aligned_malloc(size, IMAGE_ROW_ALIGN);
+#else
+    void* p = NULL;
+    return posix_memalign(&p, IMAGE_ROW_ALIGN, size) == 0 ? p : NULL;
+#endif
+}
+
+void image_free_aligned(void* p) {
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+int gray_image_alloc(GrayImage* img, int width, int height) {
+    img->width = width;
+    img->height = height;
+    img->stride = image_aligned_stride(width > 0 ? (size_t)width : 0); // Un byte por pxel, con relleno.
+    img->data = (uint8_t*)image_alloc_aligned((size_t)img->stride * (size_t)(height > 0 ? height : 0));
+    return img->data != NULL;
+}
+
+void gray_image_free(GrayImage* img) {
+    image_free_aligned(img->data);
+    img->data = NULL;
+    img->width = 0;
+    img->height = 0;
+    img->stride = 0;
+}
+
+// --- Escritura incremental ---
+
+static int bmp_writer_open_bits(BmpWriter* w, const char* path, int width, int height, int bits) {
+    memset(w, 0, sizeof(*w));
+    w->width = width;
+    w->height = height;
+    w->bits = bits;
+    w->row_bytes = bits == 32 ? (size_t)width * 4 : (size_t)width * 3 + row_padding_24(width);
+    size_t rows = BMP_BATCH_BYTES / w->row_bytes;
+    if (rows < 1) rows = 1;
+    if (height > 0 && rows > (size_t)height) rows = height;
+    w->buf_rows = (int)rows;
+    w->buf = (uint8_t*)calloc(rows, w->row_bytes); // El padding queda en cero para siempre.
+    // Se escribe en path.tmp y reemplaza a path al cerrar (file_replace): si algo falla, path
+    // conserva su contenido anterior en vez de quedar a medio escribir. En Windows el reemplazo
+    // falla mientras path siga proyectado o abierto: quien escriba sobre su propia entrada tiene
+    // que soltarla antes de cerrar (bmp_map_to_copy, bmp_reader_close).
+    size_t len = strlen(path);
+    w->path = (char*)malloc(len + 1);
+    w->tmp_path = (char*)malloc(len + 5);
+    if (w->buf == NULL || w->path == NULL || w->tmp_path == NULL) {
+        printf("Sin memoria para escribir %s\n", path);
+        free(w->buf); free(w->path); free(w->tmp_path);
+        memset(w, 0, sizeof(*w));
+        return 0;
+    }
+    memcpy(w->path, path, len + 1);
+    memcpy(w->tmp_path, path, len);
+    memcpy(w->tmp_path + len, ".tmp", 5);
+    w->f = fopen(w->tmp_path, "wb");
+    if (w->f == NULL) {
+        printf("No se pudo crear el archivo de salida: %s\n", path);
+        free(w->buf); free(w->path); free(w->tmp_path);
+        memset(w, 0, sizeof(*w));
+        return 0;
+    }
+    write_bmp_headers(w->f, width, height, bits);
+    return 1;
+}
+
+int bmp_writer_open(BmpWriter* w, const char* path, int width, int height) {
+    return bmp_writer_open_bits(w, path, width, height, 24);
+}
+
+int bmp_writer_open32(BmpWriter* w, const char* path, int width, int height) {
+    return bmp_writer_open_bits(w, path, width, height, 32);
+}
+
+// Escribe a disco las filas acumuladas en el lote con un solo fwrite.
+static int bmp_writer_flush(BmpWriter* w) {
+    size_t bytes = (size_t)w->buffered * w->row_bytes;
+    int ok = fwrite(w->buf, 1, bytes, w->f) == bytes;
+    w->rows_written += w->buffered;
+    w->buffered = 0;
+    if (!ok) w->failed = 1;
+    return ok;
+}
+
+// Devuelve la prxima fila libre del lote, o NULL si ya se entregaron todas, hubo un error o el
+// escritor no es de bits por pxel.
+static uint8_t* bmp_writer_slot(BmpWriter* w, int bits) {
+    if (w->f == NULL || w->failed || w->bits != bits || w->rows_written + w->buffered >= w->height) return NULL;
+    return w->buf + (size_t)w->buffered * w->row_bytes;
+}
+
+// Cuenta la fila recin llenada y vaca el lote si se complet.
+static int bmp_writer_commit(BmpWriter* w) {
+    w->buffered++;
+    if (w->buffered == w->buf_rows) return bmp_writer_flush(w);
+    return 1;
+}
+
+int bmp_writer_row(BmpWriter* w, const BGR* row) {
+    uint8_t* fila = bmp_writer_slot(w, 24);
+    if (fila == NULL) return 0;
+    memcpy(fila, row, (size_t)w->width * sizeof(BGR));
+    return bmp_writer_commit(w);
+}
+
+int bmp_writer_gray_row(BmpWriter* w, const uint8_t* gray) {
+    uint8_t* fila = bmp_writer_slot(w, 24);
+    if (fila == NULL) return 0;
+    for (int x = 0; x < w->width; x++) {
+        fila[3 * x] = gray[x];     // Azul.
+        fila[3 * x + 1] = gray[x]; // Verde.
+        fila[3 * x + 2] = gray[x]; // Rojo.
+    }
+    return bmp_writer_commit(w);
+}
+
+int bmp_writer_bgra_row(BmpWriter* w, const BGRA* row) {
+    uint8_t* fila = bmp_writer_slot(w, 32);
+    if (fila == NULL) return 0;
+    memcpy(fila, row, (size_t)w->width * sizeof(BGRA));
+    return bmp_writer_commit(w);
+}
+
+int bmp_writer_close(BmpWriter* w) {
+    if (w->f != NULL && w->buffered > 0) bmp_writer_flush(w);
+    int ok = w->f != NULL && !w->failed && w->rows_written == w->height;
+    if (w->f != NULL && fclose(w->f) != 0) ok = 0;
+    if (w->f != NULL) {
+        if (ok) ok = file_replace(w->tmp_path, w->path);
+        if (!ok) remove(w->tmp_path);
+    }
+    free(w->buf);
+    free(w->path);
+    free(w->tmp_path);
+    w->f = NULL;
+    w->buf = NULL;
+    w->path = NULL;
+    w->tmp_path = NULL;
+    return ok;
+}
+
+// FUNCIN save_bmp_gray
+// Guarda una imagen de grises planar como BMP de 24 bits. La expansin a BGR (r = g = b) se hace
+// fila por fila con el escritor incremental, as la imagen completa nunca existe en formato BGR.
+// Retorno: 1 si tuvo xito, 0 si hubo error.
+int save_bmp_gray(const char* path, const GrayImage* img) {
+    BmpWriter w;
+    if (!bmp_writer_open(&w, path, img->width, img->height)) return 0;
+    for (int y = 0; y < img->height; y++) {
+        if (!bmp_writer_gray_row(&w, gray_image_row(img, y))) break;
+    }
+    int ok = bmp_writer_close(&w);
+    if (!ok) printf("Error escribiendo %s\n", path);
+    return ok;
+}
@@ -0,0 +1,283 @@
+// bmp.h
+// Cabecera con las estructuras del formato BMP y las funciones de lectura/escritura de imgenes.
+// Se leen BMP de 24 bits, con paleta (1, 4 y 8 bits), de 16 y de 32 bits (ver pixfmt.h); internamente
+// las imgenes son BGR de 24 bits o BGRA de 32 bits.
+// Compartida por todos los mdulos del laboratorio (filtros, programa principal).
+#ifndef BMP_H
+#define BMP_H
+
+#include <stdint.h>     // Para tipos de datos de tamao fijo: uint8_t, uint16_t, uint32_t
+#include <stdio.h>      // Para FILE
+#include <stddef.h>     // Para size_t
+
+// --- DEFINICIN DE ESTRUCTURAS PARA BMP ---
+// #pragma pack(push, 1) fuerza al compilador a no aadir padding entre los campos de las estructuras.
+// Esto es esencial porque el formato BMP requiere que los bytes estn alineados exactamente como estn definidos.
+
+// Estructura del encabezado de archivo BMP (14 bytes)
+#pragma pack(push, 1)
+typedef struct {
+    uint16_t bfType;      // Identificador de tipo de archivo. Debe ser 'BM' (0x4D42 en hexadecimal).
+    uint32_t bfSize;      // Tamao total del archivo en bytes, incluyendo todos los encabezados y los datos de pxeles.
+    uint16_t bfReserved1; // Campo reservado. Debe ser 0 segn la especificacin BMP.
+    uint16_t bfReserved2; // Segundo campo reservado. Tambin debe ser 0.
+    uint32_t bfOffBits;   // Offset (desplazamiento) en bytes desde el inicio del archivo hasta el comienzo de los datos de la imagen.
+} BITMAPFILEHEADER;
+
+// Estructura del encabezado de informacin BMP (BITMAPINFOHEADER, 40 bytes)
+typedef struct {
+    uint32_t biSize;          // Tamao de esta cabecera de informacin. Debe ser 40 para BITMAPINFOHEADER.
+    int32_t  biWidth;         // Ancho de la imagen en pxeles.
+    int32_t  biHeight;        // Alto de la imagen en pxeles. Si es positivo, la imagen se almacena de abajo hacia arriba (bottom-up).
+    uint16_t biPlanes;        // Nmero de planos. Siempre debe ser 1.
+    uint16_t biBitCount;      // Nmero de bits por pxel: 1, 4, 8, 16, 24 o 32.
+    uint32_t biCompression;   // Tipo de compresin. 0 (BI_RGB) significa sin compresin; 3 (BI_BITFIELDS), con mscaras de color.
+    uint32_t biSizeImage;     // Tamao de los datos de la imagen en bytes. Puede ser 0 si biCompression es 0.
+    int32_t  biXPelsPerMeter; // Resolucin horizontal en pxeles por metro. Opcional, puede ser 0.
+    int32_t  biYPelsPerMeter; // Resolucin vertical en pxeles por metro. Opcional, puede ser 0.
+    uint32_t biClrUsed;       // Nmero de colores usados en la paleta. 0 indica todos.
+    uint32_t biClrImportant;  // Nmero de colores importantes. 0 indica todos.
+} BITMAPINFOHEADER;
+#pragma pack(pop) // Se vuelve a la alineacin por defecto de la plataforma
+
+// Estructura para representar un pxel en formato BMP 24 bits (BGR: Blue, Green, Red)
+typedef struct {
+    uint8_t b; // Canal azul (Blue), ocupa 1 byte
+    uint8_t g; // Canal verde (Green), ocupa 1 byte
+    uint8_t r; // Canal rojo (Red), ocupa 1 byte
+} BGR;
+
+// Pxel de 32 bits (B, G, R, alfa). Ocupa un byte ms que BGR, pero cada pxel queda alineado a 4
+// bytes y un registro SIMD contiene una cantidad entera de pxeles, sin reordenar bytes.
+typedef struct {
+    uint8_t b;
+    uint8_t g;
+    uint8_t r;
+    uint8_t a; // Alfa (255 = opaco).
+} BGRA;
+
+// Formato de pxel de un archivo BMP (definido en pixfmt.h).
+struct PixelFormat;
+
+// FUNCIN clampi
+// Funcin que limita un valor entero al rango [0, 255]. Es fundamental para evitar desbordamientos y valores invlidos en los canales de color.
+// Parmetro: v -> valor entero a limitar.
+// Retorno: valor limitado entre 0 y 255.
+static inline uint8_t clampi(int v) {
+    if (v < 0) {
+        return 0; // Si es menor que 0, devuelve 0.
+    }
+    if (v > 255) {
+        return 255; // Si es mayor que 255, devuelve 255.
+    }
+    return (uint8_t)v; // Si est en el rango [0,255], lo devuelve tal cual, convertido a uint8_t.
+}
+
+// Vista de solo lectura de una imagen BGR cuyas filas no tienen por qu ser contiguas: la fila y
+// empieza en data + y * stride. El stride (en bytes) puede incluir padding y ser negativo, por
+// ejemplo para recorrer de arriba hacia abajo un BMP bottom-up proyectado en memoria.
+typedef struct {
+    const uint8_t* data;  // Inicio de la fila superior.
+    ptrdiff_t stride;     // Bytes entre el inicio de una fila y el de la siguiente (hacia abajo).
+    int width;
+    int height;
+} BgrView;
+
+// Fila y de la vista.
+static inline const BGR* bgr_view_row(const BgrView* v, int y) {
+    return (const BGR*)(v->data + (ptrdiff_t)y * v->stride);
+}
+
+// Vista sobre un buffer BGR contiguo de width x height (el formato de load_bmp24).
+static inline BgrView bgr_view_packed(const BGR* pixels, int width, int height) {
+    BgrView v = { (const uint8_t*)pixels, (ptrdiff_t)width * (ptrdiff_t)sizeof(BGR), width, height };
+    return v;
+}
+
+// Regin de inters: el rectngulo de w x h pxeles con esquina superior izquierda en (x, y), sin
+// copiar nada (comparte los datos y el stride de v). Quien llama garantiza que cabe en v.
+static inline BgrView bgr_view_roi(const BgrView* v, int x, int y, int w, int h) {
+    BgrView r = { (const uint8_t*)(bgr_view_row(v, y) + x), v->stride, w, h };
+    return r;
+}
+
+// Alineacin en bytes del inicio de cada fila de las imgenes que reserva gray_image_alloc: una
+// lnea de cach y dos registros AVX2, as ninguna carga SIMD de una fila cruza dos lneas.
+#define IMAGE_ROW_ALIGN 64
+
+// Stride alineado para filas de row_bytes bytes: el prximo mltiplo de IMAGE_ROW_ALIGN.
+static inline ptrdiff_t image_aligned_stride(size_t row_bytes) {
+    return (ptrdiff_t)((row_bytes + IMAGE_ROW_ALIGN - 1) & ~(size_t)(IMAGE_ROW_ALIGN - 1));
+}
+
+// Imagen en escala de grises planar: un byte por pxel, de arriba hacia abajo. La fila y empieza en
+// data + y * stride; el stride (en bytes, de 64 bits) puede ser mayor que width por el relleno de
+// alineacin o porque la imagen es una regin de inters dentro de otra ms grande.
+// Ocupa un tercio de memoria que el mismo contenido guardado como BGR con r = g = b.
+typedef struct {
+    int width;         // Ancho en pxeles.
+    int height;        // Alto en pxeles.
+    uint8_t* data;     // Fila superior (reservada con gray_image_alloc o ajena).
+    ptrdiff_t stride;  // Bytes entre el inicio de una fila y el de la siguiente (>= width).
+} GrayImage;
+
+// Fila y de la imagen.
+static inline uint8_t* gray_image_row(const GrayImage* img, int y) {
+    return img->data + (ptrdiff_t)y * img->stride;
+}
+
+// Imagen sobre un buffer ajeno de width x height con filas contiguas (stride = width).
+static inline GrayImage gray_image_packed(uint8_t* data, int width, int height) {
+    GrayImage g = { width, height, data, (ptrdiff_t)width };
+    return g;
+}
+
+// Regin de inters de w x h pxeles desde (x, y), sin copiar: escribir en ella escribe en img.
+// No se libera con gray_image_free (los datos siguen siendo de img).
+static inline GrayImage gray_image_roi(const GrayImage* img, int x, int y, int w, int h) {
+    GrayImage r = { w, h, gray_image_row(img, y) + x, img->stride };
+    return r;
+}
+
+// 1 si las filas de la imagen son contiguas (se puede recorrer como un solo bloque de bytes).
+static inline int gray_image_is_packed(const GrayImage* img) {
+    return img->stride == (ptrdiff_t)img->width || img->height <= 1;
+}
+
+// Reserva una imagen de grises de width x height con cada fila alineada a IMAGE_ROW_ALIGN bytes
+// (stride = width redondeado hacia arriba). Devuelve 1 si tuvo xito, 0 si no hay memoria.
+int gray_image_alloc(GrayImage* img, int width, int height);
+
+// Libera la memoria de la imagen y la deja vaca.
+void gray_image_free(GrayImage* img);
+
+// Memoria alineada a IMAGE_ROW_ALIGN bytes; se libera con image_free_aligned (no con free).
+void* image_alloc_aligned(size_t size);
+void image_free_aligned(void* p);
+
+// Calcula los bytes de relleno por fila para un BMP de 24 bits.
+int row_padding_24(int width);
+
+// Tamao aproximado de cada lote de filas que se lee o escribe con un solo fread/fwrite.
+#define BMP_BATCH_BYTES (4u << 20)
+
+// Ancho mximo soportado: una fila en bytes (con padding) debe caber en un int.
+#define BMP_MAX_WIDTH ((INT32_MAX - 3) / 3)
+
+// Lector incremental de BMP: entrega las filas de arriba hacia abajo (sea el archivo bottom-up o
+// top-down) leyndolas en lotes grandes, con memoria acotada a un lote. Las filas que no son de 24
+// bits se convierten a BGR (o a BGRA) al entregarlas.
+typedef struct {
+    FILE* f;
+    int width;
+    int height;
+    int bottom_up;        // 1 si el archivo guarda la ltima fila primero.
+    size_t row_bytes;     // Bytes por fila en el archivo (pxeles + padding).
+    int64_t data_offset;  // bfOffBits: inicio de los datos de pxeles.
+    int next_row;         // Prxima fila lgica (0 = fila superior) a entregar.
+    uint8_t* buf;         // Lote de filas tal como estn en el archivo.
+    int buf_rows;         // Capacidad del lote en filas.
+    int buf_first;        // Primera fila lgica del lote cargado.
+    int buf_count;        // Filas cargadas en el lote.
+    int buf_file_first;   // Primera fila del archivo dentro del lote.
+    struct PixelFormat* fmt; // Formato de los pxeles del archivo.
+    BGR* row;             // Fila convertida a BGR (NULL si el archivo ya es de 24 bits).
+} BmpReader;
+
+// Abre y valida un BMP sin compresin (o con mscaras de color). Devuelve 1 si tuvo xito, 0 si hubo error.
+int bmp_reader_open(BmpReader* r, const char* path);
+
+// Siguiente fila (width pxeles) de arriba hacia abajo, vlida hasta la prxima llamada.
+// Devuelve NULL al terminar la imagen o si hubo un error de lectura.
+const BGR* bmp_reader_next_row(BmpReader* r);
+
+// Copia hasta max_rows filas siguientes en dst (width pxeles por fila, sin padding).
+// Devuelve las filas copiadas, 0 al final de la imagen o -1 si hubo un error.
+int bmp_reader_read_rows(BmpReader* r, BGR* dst, int max_rows);
+
+// Igual, pero convierte las filas a BGRA (a = 255 si el archivo no trae alfa).
+int bmp_reader_read_rows_bgra(BmpReader* r, BGRA* dst, int max_rows);
+
+// Cierra el archivo y libera el lote.
+void bmp_reader_close(BmpReader* r);
+
+// Carga un BMP en formato BGR (24 bits) cualquiera sea su formato en el archivo.
+// Devuelve 1 si tuvo xito, 0 si hubo error.
+int load_bmp24(const char* path, int* out_w, int* out_h, BGR** out_pixels);
+
+// Igual, pero en formato BGRA (32 bits por pxel).
+int load_bmp32(const char* path, int* out_w, int* out_h, BGRA** out_pixels);
+
+// BMP de 24 bits proyectado en memoria (mmap) para anlisis de solo lectura sin copiar pxeles.
+// view apunta directamente a los datos del archivo, usando bfOffBits, el stride con padding y la
+// orientacin. Si el sistema no permite proyectar el archivo, se carga con load_bmp24 y la vista
+// apunta a esa copia, as que el resto del programa no nota la diferencia. Los archivos en otros
+// formatos se convierten a una copia BGR desde la proyeccin (en bandas paralelas).
+typedef struct {
+    BgrView view;
+    const void* base;   // Inicio de la proyeccin (NULL si se us la copia).
+    size_t size;        // Tamao de la proyeccin en bytes.
+    BGR* copy;          // Copia en memoria cuando no se pudo proyectar.
+} MappedBmp;
+
+// Proyecta y valida un BMP. Devuelve 1 si tuvo xito, 0 si hubo error.
+int bmp_map(const char* path, MappedBmp* m);
+
+// Reemplaza la proyeccin por una copia en memoria y suelta el archivo, por ejemplo antes de
+// guardar un resultado con el mismo nombre (en Windows no se puede reemplazar un archivo proyectado).
+// Devuelve 1 si tuvo xito (o ya era una copia), 0 si falta memoria (m queda como estaba).
+int bmp_map_to_copy(MappedBmp* m);
+
+// Libera la proyeccin (o la copia).
+void bmp_unmap(MappedBmp* m);
+
+// Guarda un buffer BGR como BMP de 24 bits (top-down). Devuelve 1 si tuvo xito, 0 si hubo error.
+int save_bmp24(const char* path, int width, int height, const BGR* pixels);
+
+// Guarda un buffer BGRA como BMP de 32 bits sin compresin (top-down). El alfa se escribe en el 4
+// byte, pero BI_RGB lo define como reservado: al leer el archivo se toma a = 255. Devuelve 1 o 0.
+int save_bmp32(const char* path, int width, int height, const BGRA* pixels);
+
+// Guarda una imagen de grises planar como BMP de 24 bits, expandiendo cada fila a BGR al escribirla.
+int save_bmp_gray(const char* path, const GrayImage* img);
+
+// Escritor incremental de BMP de 24 o 32 bits top-down: las filas se entregan de arriba hacia abajo,
+// se acumulan con su padding en un lote y cada lote se escribe con un solo fwrite en un archivo
+// temporal que reemplaza al destino recin al cerrar. En Windows ese reemplazo falla si el destino
+// sigue proyectado o abierto para lectura.
+typedef struct {
+    FILE* f;
+    int width;
+    int height;
+    int bits;           // 24 (BGR) o 32 (BGRA).
+    int rows_written;   // Filas ya escritas a disco.
+    size_t row_bytes;   // Bytes por fila en el archivo (pxeles + padding).
+    uint8_t* buf;       // Lote de filas con padding.
+    int buf_rows;       // Capacidad del lote en filas.
+    int buffered;       // Filas acumuladas en el lote.
+    int failed;         // 1 si alguna escritura fall.
+    char* path;         // Archivo final.
+    char* tmp_path;     // path + ".tmp", donde se escribe hasta cerrar.
+} BmpWriter;
+
+// Crea el archivo y escribe los encabezados de un BMP de 24 bits. Devuelve 1 si tuvo xito, 0 si hubo error.
+int bmp_writer_open(BmpWriter* w, const char* path, int width, int height);
+
+// Igual, para un BMP de 32 bits (las filas se agregan con bmp_writer_bgra_row).
+int bmp_writer_open32(BmpWriter* w, const char* path, int width, int height);
+
+// Agrega la siguiente fila de width pxeles BGR. Devuelve 1 o 0.
+int bmp_writer_row(BmpWriter* w, const BGR* row);
+
+// Agrega la siguiente fila a partir de width bytes de grises (r = g = b). Devuelve 1 o 0.
+int bmp_writer_gray_row(BmpWriter* w, const uint8_t* gray);
+
+// Agrega la siguiente fila de width pxeles BGRA a un escritor de 32 bits. Devuelve 1 o 0.
+int bmp_writer_bgra_row(BmpWriter* w, const BGRA* row);
+
+// Cierra el archivo temporal y reemplaza con l al destino. Devuelve 1 si se escribieron todas las
+// filas y se pudo reemplazar el destino, 0 si no (en ese caso el temporal se borra y el destino
+// queda como estaba).
+int bmp_writer_close(BmpWriter* w);
+
+#endif
@@ -0,0 +1,682 @@
+// chain.c
+// Interpretacin y ejecucin de cadenas de operaciones.
+
+#include "chain.h"
+#include "edges.h"
+#include "filters.h"
+#include "parallel.h"
+#include "stats.h"
+#include <stdio.h>      // Para printf, fopen, fread
+#include <stdlib.h>     // Para malloc, free, strtol
+#include <string.h>     // Para strcmp, strchr, strcspn, memcpy
+
+// Kernels 3x3 con nombre: los mismos ejemplos que trae LAB2.c.
+typedef struct {
+    const char* name;
+    int k[9];
+} NamedKernel;
+
+static const NamedKernel named_kernels[] = {
+    { "blur",    {  1,  1,  1,  1,  1,  1,  1,  1,  1 } },
+    { "sharpen", {  0, -1,  0, -1,  5, -1,  0, -1,  0 } },
+    { "sobelx",  { -1,  0,  1, -2,  0,  2, -1,  0,  1 } },
+    { "sobely",  { -1, -2, -1,  0,  0,  0,  1,  2,  1 } },
+    { "laplace", { -1, -1, -1, -1,  8, -1, -1, -1, -1 } },
+};
+
+// Lee un nmero entero que ocupa todo el texto. Devuelve 1 si es vlido.
+static int parse_int(const char* text, int* value) {
+    char* end;
+    long v = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || v < -1000000 || v > 1000000) return 0;
+    *value = (int)v;
+    return 1;
+}
+
+// Interpreta una operacin de len caracteres. Devuelve 1 si es vlida.
+static int parse_op(const char* tok, size_t len, ChainOp* op) {
+    char name[32];
+    if (len == 0 || len >= sizeof(name)) return 0;
+    memcpy(name, tok, len);
+    name[len] = '\0';
+
+    int offset = 0;
+    char* at = strchr(name, '@');
+    if (at) {
+        if (!parse_int(at + 1, &offset)) return 0;
+        *at = '\0';
+    }
+
+    if (strcmp(name, "gray") == 0 || strcmp(name, "invert") == 0) {
+        op->type = name[0] == 'g' ? OP_GRAY : OP_INVERT;
+        return at == NULL;
+    }
+    if (strncmp(name, "threshold", 9) == 0) {
+        op->type = OP_THRESHOLD;
+        return at == NULL && parse_int(name + 9, &op->value) && op->value >= 0 && op->value <= 256;
+    }
+    if (strncmp(name, "resize", 6) == 0) {
+        op->type = OP_RESIZE;
+        char* end;
+        long a = strtol(name + 6, &end, 10);
+        if (at || end == name + 6 || a < 1 || a > BMP_MAX_WIDTH) return 0;
+        char* colon = strchr(end, ':'); // Filtro opcional al final.
+        if (colon) {
+            if (!resize_filter_parse(colon + 1, &op->filter)) return 0;
+            *colon = '\0';
+        }
+        if (end[0] == '%' && end[1] == '\0') {
+            op->value = (int)a;
+            return 1;
+        }
+        if (end[0] != 'x') return 0;
+        op->width = (int)a;
+        return parse_int(end + 1, &op->height) && op->height >= 1;
+    }
+    if (strcmp(name, "equalize") == 0 || strcmp(name, "otsu") == 0) {
+        op->type = name[0] == 'e' ? OP_EQUALIZE : OP_OTSU;
+        return at == NULL;
+    }
+    if (strncmp(name, "autocontrast", 12) == 0) {
+        op->type = OP_AUTOCONTRAST;
+        if (name[12] == '\0') return at == NULL; // Sin recorte: el mnimo y el mximo exactos.
+        return at == NULL && parse_int(name + 12, &op->value) && op->value >= 0 && op->value <= 49;
+    }
+    if (strcmp(name, "edges") == 0 || strcmp(name, "edges:nms") == 0) {
+        op->type = OP_EDGES;
+        op->value = name[5] == ':';
+        return at == NULL;
+    }
+    static const struct { const char* name; LocalOp op; } locals[] = {
+        { "mean", LOCAL_MEAN }, { "stddev", LOCAL_STDDEV }, { "adaptive", LOCAL_THRESHOLD },
+    };
+    for (size_t i = 0; i < sizeof(locals) / sizeof(locals[0]); i++) {
+        size_t n = strlen(locals[i].name);
+        if (strncmp(name, locals[i].name, n) != 0) continue;
+        op->type = OP_LOCAL;
+        op->local = locals[i].op;
+        op->c = offset;
+        return (at == NULL || op->local == LOCAL_THRESHOLD) && parse_int(name + n, &op->value)
+            && op->value >= 0 && op->value <= INTEGRAL_MAX_RADIUS;
+    }
+    op->type = OP_CONV;
+    for (size_t i = 0; i < sizeof(named_kernels) / sizeof(named_kernels[0]); i++) {
+        if (strcmp(name, named_kernels[i].name) != 0) continue;
+        if (!conv_kernel_alloc(&op->kern, 3)) return 0;
+        int suma = 0; // Divisor: suma de los pesos, como en read_kernel.
+        for (int j = 0; j < 9; j++) {
+            op->kern.k[j] = named_kernels[i].k[j];
+            suma += op->kern.k[j];
+        }
+        op->kern.divisor = suma != 0 ? suma : 1;
+        op->kern.offset = offset;
+        return 1;
+    }
+    int n;
+    if (strncmp(name, "gauss", 5) == 0 || strncmp(name, "box", 3) == 0) {
+        if (!parse_int(name + (name[0] == 'g' ? 5 : 3), &n)) return 0;
+        int ok = name[0] == 'g' ? conv_kernel_gaussian(&op->kern, n, 0) : conv_kernel_box(&op->kern, n);
+        op->kern.offset = offset;
+        return ok;
+    }
+    return 0;
+}
+
+// Lee el archivo de una cadena; los comentarios ('#' hasta el fin de lnea) se reemplazan por
+// espacios. Devuelve el texto (liberar con free) o NULL.
+static char* read_chain_file(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        printf("No se pudo abrir el archivo de la cadena: %s\n", path);
+        return NULL;
+    }
+    char* text = (char*)malloc(4096);
+    size_t len = text ? fread(text, 1, 4095, f) : 0;
+    fclose(f);
+    if (!text) return NULL;
+    text[len] = '\0';
+    int comment = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (text[i] == '#') comment = 1;
+        else if (text[i] == '\n') comment = 0;
+        if (comment) text[i] = ' ';
+    }
+    return text;
+}
+
+int chain_parse(const char* spec, OpChain* chain) {
+    static const char separators[] = ", \t\r\n";
+    chain->count = 0;
+    char* text = NULL;
+    if (spec[0] == '@') {
+        text = read_chain_file(spec + 1);
+        if (!text) return 0;
+        spec = text;
+    }
+    const char* p = spec;
+    int ok = 1;
+    while (ok && *(p += strspn(p, separators))) {
+        size_t len = strcspn(p, separators);
+        if (chain->count == CHAIN_MAX_OPS) {
+            printf("La cadena tiene ms de %d operaciones.\n", CHAIN_MAX_OPS);
+            ok = 0;
+            break;
+        }
+        ChainOp* op = &chain->ops[chain->count];
+        memset(op, 0, sizeof(*op));
+        if (!parse_op(p, len, op)) {
+            printf("Operacin invlida: %.*s\n", (int)len, p);
+            conv_kernel_free(&op->kern);
+            ok = 0;
+            break;
+        }
+        chain->count++;
+        p += len;
+    }
+    free(text);
+    if (!ok) {
+        chain_free(chain);
+        return 0;
+    }
+    if (chain->count == 0) {
+        printf("La cadena de operaciones est vaca.\n");
+        return 0;
+    }
+    return 1;
+}
+
+void chain_free(OpChain* chain) {
+    for (int i = 0; i < chain->count; i++)
+        if (chain->ops[i].type == OP_CONV) conv_kernel_free(&chain->ops[i].kern);
+    chain->count = 0;
+}
+
+// --- Frames ---
+
+void frame_free(Frame* frame) {
+    free(frame->bgr);
+    frame->bgr = NULL;
+    gray_image_free(&frame->gray);
+}
+
+int frame_save(const Frame* frame, const char* path) {
+    if (frame->is_gray) return save_bmp_gray(path, &frame->gray);
+    return save_bmp24(path, frame->width, frame->height, frame->bgr);
+}
+
+// --- PLAN DE EJECUCIN ---
+// La cadena se agrupa en etapas. Las operaciones pxel a pxel seguidas (gray, threshold, invert)
+// forman una sola etapa: los umbrales e inversiones se componen en una tabla de 256 valores antes
+// de la conversin a grises (por canal) y otra despus. Las convoluciones, los filtros locales y
+// los bordes (que leen vecinos) y los cambios de tamao son etapas propias. Los cambios de tamao con filtro
+// usan las tablas de pesos de resize.h y leen las filas de entrada que cubre su ventana vertical.
+
+typedef enum { ST_POINT, ST_CONV, ST_LOCAL, ST_EDGES, ST_RESIZE } StageKind;
+
+typedef struct {
+    StageKind kind;
+    int in_gray, out_gray;       // Formato de las filas de entrada y de salida.
+    int in_w, in_h, out_w, out_h;
+    // ST_POINT: tabla antes de pasar a grises (o la nica), conversin y tabla posterior.
+    int has_pre, to_gray, has_post;
+    uint8_t pre[256], post[256];
+    // ST_CONV, ST_LOCAL y ST_EDGES
+    const ConvKernel* kern;
+    int radius;
+    LocalOp local;
+    int c;
+    int nms;
+    // ST_RESIZE: columna de origen de cada columna de salida (vecino ms cercano) o tablas de pesos.
+    int* xmap;
+    ResizeFilter filter;
+    ResizeAxis hx, vy;
+} Stage;
+
+typedef struct {
+    int count;
+    Stage stages[CHAIN_MAX_OPS];
+} ChainPlan;
+
+static void lut_compose(uint8_t lut[256], const ChainOp* op) {
+    for (int i = 0; i < 256; i++)
+        lut[i] = op->type == OP_INVERT ? (uint8_t)(255 - lut[i]) : (lut[i] >= op->value ? 255 : 0);
+}
+
+// Fila de origen (o columna) del vecino ms cercano: muestrea en el centro de cada pxel de salida.
+static int resize_src(int y, int in_n, int out_n) {
+    return (int)(((2 * (int64_t)y + 1) * in_n) / (2 * (int64_t)out_n));
+}
+
+static void plan_free(ChainPlan* plan) {
+    for (int i = 0; i < plan->count; i++) {
+        free(plan->stages[i].xmap);
+        resize_axis_free(&plan->stages[i].hx);
+        resize_axis_free(&plan->stages[i].vy);
+    }
+    plan->count = 0;
+}
+
+// Agrupa las operaciones [i0, i1) de la cadena, que no incluyen operaciones globales, para una
+// entrada de width x height a color o en grises.
+static int plan_build(const OpChain* chain, int i0, int i1, int width, int height, int gray, ChainPlan* plan) {
+    plan->count = 0;
+    for (int i = i0; i < i1; i++) {
+        const ChainOp* op = &chain->ops[i];
+        Stage* st = plan->count > 0 ? &plan->stages[plan->count - 1] : NULL;
+        int pointwise = op->type == OP_GRAY || op->type == OP_THRESHOLD || op->type == OP_INVERT;
+        if (op->type == OP_GRAY && gray) continue; // Ya est en grises.
+        if (!pointwise || !st || st->kind != ST_POINT) {
+            st = &plan->stages[plan->count++];
+            memset(st, 0, sizeof(*st));
+            st->in_gray = gray;
+            st->in_w = width;
+            st->in_h = height;
+            if (pointwise) {
+                st->kind = ST_POINT;
+                for (int v = 0; v < 256; v++) st->pre[v] = st->post[v] = (uint8_t)v;
+            }
+        }
+        if (op->type == OP_GRAY) {
+            st->to_gray = 1;
+            gray = 1;
+        } else if (pointwise) {
+            if (st->to_gray) {
+                lut_compose(st->post, op);
+                st->has_post = 1;
+            } else {
+                lut_compose(st->pre, op);
+                st->has_pre = 1;
+            }
+        } else if (op->type == OP_CONV) {
+            st->kind = ST_CONV;
+            st->kern = &op->kern;
+            st->radius = op->kern.size / 2;
+        } else if (op->type == OP_LOCAL) {
+            st->kind = ST_LOCAL;
+            st->local = op->local;
+            st->radius = op->value;
+            st->c = op->c;
+        } else if (op->type == OP_EDGES) {
+            st->kind = ST_EDGES; // La salida es siempre en grises, sea cual sea la entrada.
+            st->nms = op->value;
+            st->radius = 1 + op->value;
+            gray = 1;
+        } else {
+            st->kind = ST_RESIZE;
+            if (op->width > 0) {
+                width = op->width;
+                height = op->height;
+            } else {
+                int64_t w = (int64_t)width * op->value / 100, h = (int64_t)height * op->value / 100;
+                if (w > BMP_MAX_WIDTH || h > INT32_MAX) { plan_free(plan); return 0; }
+                width = w > 0 ? (int)w : 1;
+                height = h > 0 ? (int)h : 1;
+            }
+            st->filter = op->filter;
+            if (op->filter != RESIZE_NEAREST) {
+                if (!resize_axis_init(&st->hx, st->in_w, width, op->filter)
+                    || !resize_axis_init(&st->vy, st->in_h, height, op->filter)) { plan_free(plan); return 0; }
+                // Solo para el tamao de los bloques: media ventana vertical, en filas de salida.
+                st->radius = (int)((double)(st->vy.taps / 2) * height / st->in_h) + 1;
+            } else {
+                st->xmap = (int*)malloc(sizeof(int) * (size_t)width);
+                if (!st->xmap) { plan_free(plan); return 0; }
+                for (int x = 0; x < width; x++) st->xmap[x] = resize_src(x, st->in_w, width);
+            }
+        }
+        st->out_gray = gray;
+        st->out_w = width;
+        st->out_h = height;
+    }
+    return 1;
+}
+
+// --- EJECUCIN POR BLOQUES ---
+// Para producir las filas [y0, y1) del resultado se calcula, de la ltima etapa a la primera, qu
+// filas de su entrada necesita cada una (una convolucin de radio r necesita r filas ms arriba y
+// abajo) y luego se ejecutan en orden sobre buffers del tamao del bloque. Las filas de ms se
+// recalculan en los bloques vecinos, a cambio de que todo el bloque quede en cach y los bloques
+// sean independientes (se reparten entre los hilos con parallel_rows).
+
+// Filas [y0, y1) de una imagen intermedia: la fila y empieza en data + (y - y0) * stride. Los
+// buffers de las etapas tienen cada fila alineada a IMAGE_ROW_ALIGN (el origen, el stride que traiga).
+typedef struct {
+    uint8_t* data;
+    ptrdiff_t stride;
+    int y0, y1;
+} RowBuf;
+
+static uint8_t* rowbuf_row(const RowBuf* b, int y) {
+    return b->data + (ptrdiff_t)(y - b->y0) * b->stride;
+}
+
+// Filas de entrada que necesita la etapa para producir [y0, y1).
+static void stage_input_rows(const Stage* st, int y0, int y1, int* in0, int* in1) {
+    if (st->kind == ST_RESIZE && st->filter != RESIZE_NEAREST) {
+        resize_axis_span(&st->vy, y0, y1, in0, in1);
+        return;
+    }
+    if (st->kind == ST_RESIZE) {
+        *in0 = resize_src(y0, st->in_h, st->out_h);
+        *in1 = resize_src(y1 - 1, st->in_h, st->out_h) + 1;
+        return;
+    }
+    *in0 = y0 - st->radius > 0 ? y0 - st->radius : 0;
+    *in1 = y1 + st->radius < st->in_h ? y1 + st->radius : st->in_h;
+}
+
+static void lut_row(const uint8_t* lut, const uint8_t* src, uint8_t* dst, size_t n) {
+    for (size_t i = 0; i < n; i++) dst[i] = lut[src[i]];
+}
+
+// Filtra las filas [r0, r1) de un plano con la convolucin, el filtro local o los bordes de la etapa.
+static int plane_rows(const Stage* st, const GrayImage* s, GrayImage* d, int r0, int r1) {
+    if (st->kind == ST_EDGES) return sobel_edges_rows(s, d, NULL, st->nms, r0, r1);
+    if (st->kind == ST_LOCAL) return local_filter_rows(s, d, st->local, st->radius, st->c, r0, r1);
+    return convolve_plane_rows(s, d, st->kern, CONV_AUTO, r0, r1);
+}
+
+// Ejecuta una etapa: lee las filas [in0, in1) de in y escribe [y0, y1) en out, que ya tiene el
+// buffer reservado (para la convolucin, con lugar para [in0, in1)).
+static int stage_run(const Stage* st, const RowBuf* in, int in0, int in1, RowBuf* out, int y0, int y1) {
+    const size_t in_bpp = st->in_gray ? 1 : sizeof(BGR), out_bpp = st->out_gray ? 1 : sizeof(BGR);
+    const int w = st->in_w;
+    if (st->kind == ST_POINT) {
+        out->y0 = y0;
+        out->y1 = y1;
+        if (!st->to_gray) {
+            for (int y = y0; y < y1; y++) lut_row(st->pre, rowbuf_row(in, y), rowbuf_row(out, y), (size_t)w * in_bpp);
+            return 1;
+        }
+        BgrView v = { rowbuf_row(in, y0), in->stride, w, y1 - y0 };
+        uint8_t* tmp = NULL;
+        if (st->has_pre) {
+            tmp = (uint8_t*)malloc((size_t)w * sizeof(BGR) * (y1 - y0));
+            if (!tmp) return 0;
+            for (int y = y0; y < y1; y++)
+                lut_row(st->pre, rowbuf_row(in, y), tmp + (size_t)(y - y0) * w * sizeof(BGR), (size_t)w * sizeof(BGR));
+            v = bgr_view_packed((const BGR*)tmp, w, y1 - y0);
+        }
+        GrayImage g = { w, y1 - y0, out->data, out->stride };
+        to_grayscale_view(&v, &g);
+        free(tmp);
+        for (int y = y0; st->has_post && y < y1; y++) lut_row(st->post, rowbuf_row(out, y), rowbuf_row(out, y), (size_t)w);
+        return 1;
+    }
+    if (st->kind == ST_RESIZE) {
+        out->y0 = y0;
+        out->y1 = y1;
+        if (st->filter != RESIZE_NEAREST)
+            return resize_rows(&st->hx, &st->vy, (int)in_bpp, rowbuf_row(in, in0), in->stride, in0,
+                               rowbuf_row(out, y0), out->stride, y0, y1);
+        for (int y = y0; y < y1; y++) {
+            const uint8_t* s = rowbuf_row(in, resize_src(y, st->in_h, st->out_h));
+            uint8_t* d = rowbuf_row(out, y);
+            if (out_bpp == 1) {
+                for (int x = 0; x < st->out_w; x++) d[x] = s[st->xmap[x]];
+            } else {
+                for (int x = 0; x < st->out_w; x++) memcpy(d + 3 * x, s + 3 * (size_t)st->xmap[x], 3);
+            }
+        }
+        return 1;
+    }
+    // ST_CONV, ST_LOCAL y ST_EDGES: las filas [in0, in1) se tratan como una imagen aparte de la que
+    // solo se calculan [y0, y1). Los bordes del bloque quedan a r filas o ms, salvo que sean bordes
+    // de la imagen.
+    const int h = in1 - in0, r0 = y0 - in0, r1 = y1 - in0;
+    out->y0 = in0;
+    out->y1 = in1;
+    if (st->in_gray) {
+        GrayImage s = { w, h, rowbuf_row(in, in0), in->stride }, d = { w, h, out->data, out->stride };
+        return plane_rows(st, &s, &d, r0, r1);
+    }
+    BgrView v = { rowbuf_row(in, in0), in->stride, w, h };
+    if (st->kind == ST_EDGES) {
+        // La luminancia de cada banda se calcula dentro del detector, sin un plano de grises aparte.
+        GrayImage d = { w, h, out->data, out->stride };
+        return sobel_edges_view_rows(&v, &d, NULL, st->nms, r0, r1);
+    }
+    if (st->kind == ST_CONV && st->kern->size == 3) {
+        // Ruta 3x3 a color vectorizada.
+        int k3[3][3];
+        for (int i = 0; i < 9; i++) k3[i / 3][i % 3] = st->kern->k[i];
+        return convolve3x3_color_rows(&v, (BGR*)out->data, out->stride, k3, st->kern->divisor, st->kern->offset, r0, r1);
+    }
+    // NxN o filtro local a color: cada canal se separa en un plano, se filtra y se vuelve a intercalar.
+    GrayImage s = { 0 }, d = { 0 };
+    if (!gray_image_alloc(&s, w, h) || !gray_image_alloc(&d, w, h)) {
+        gray_image_free(&s);
+        gray_image_free(&d);
+        return 0;
+    }
+    int ok = 1;
+    for (int c = 0; c < 3 && ok; c++) {
+        for (int y = 0; y < h; y++) {
+            const uint8_t* row = (const uint8_t*)bgr_view_row(&v, y) + c;
+            uint8_t* p = gray_image_row(&s, y);
+            for (int x = 0; x < w; x++) p[x] = row[3 * x];
+        }
+        ok = plane_rows(st, &s, &d, r0, r1);
+        for (int y = r0; ok && y < r1; y++) {
+            const uint8_t* p = gray_image_row(&d, y);
+            uint8_t* o = out->data + (ptrdiff_t)y * out->stride + c;
+            for (int x = 0; x < w; x++) o[3 * x] = p[x];
+        }
+    }
+    gray_image_free(&s);
+    gray_image_free(&d);
+    return ok;
+}
+
+typedef struct {
+    const ChainPlan* plan;
+    BgrView src;
+    Frame* out;
+    int ok;
+} ChainJob;
+
+static void chain_band(void* ctx, int y0, int y1) {
+    ChainJob* job = (ChainJob*)ctx;
+    const ChainPlan* plan = job->plan;
+    int lo[CHAIN_MAX_OPS + 1], hi[CHAIN_MAX_OPS + 1];
+    lo[plan->count] = y0;
+    hi[plan->count] = y1;
+    for (int i = plan->count - 1; i >= 0; i--)
+        stage_input_rows(&plan->stages[i], lo[i + 1], hi[i + 1], &lo[i], &hi[i]);
+
+    RowBuf bufs[CHAIN_MAX_OPS + 1];
+    memset(bufs, 0, sizeof(bufs));
+    bufs[0].data = (uint8_t*)bgr_view_row(&job->src, lo[0]); // El origen se lee sin copiar.
+    bufs[0].stride = job->src.stride;
+    bufs[0].y0 = lo[0];
+    int ok = 1;
+    for (int i = 0; i < plan->count && ok; i++) {
+        const Stage* st = &plan->stages[i];
+        size_t bpp = st->out_gray ? 1 : sizeof(BGR);
+        int padded = st->kind == ST_CONV || st->kind == ST_LOCAL || st->kind == ST_EDGES;
+        int rows = padded ? hi[i] - lo[i] : hi[i + 1] - lo[i + 1];
+        bufs[i + 1].stride = image_aligned_stride((size_t)st->out_w * bpp);
+        bufs[i + 1].data = (uint8_t*)image_alloc_aligned((size_t)bufs[i + 1].stride * rows);
+        ok = bufs[i + 1].data && stage_run(st, &bufs[i], lo[i], hi[i], &bufs[i + 1], lo[i + 1], hi[i + 1]);
+    }
+    if (ok) {
+        const RowBuf* last = &bufs[plan->count];
+        Frame* f = job->out;
+        size_t row_bytes = (size_t)f->width * (f->is_gray ? 1 : sizeof(BGR));
+        uint8_t* dst = f->is_gray ? f->gray.data : (uint8_t*)f->bgr;
+        ptrdiff_t stride = f->is_gray ? f->gray.stride : (ptrdiff_t)row_bytes;
+        for (int y = y0; y < y1; y++) memcpy(dst + (ptrdiff_t)y * stride, rowbuf_row(last, y), row_bytes);
+    } else {
+        job->ok = 0;
+    }
+    for (int i = 1; i <= plan->count; i++) image_free_aligned(bufs[i].data);
+}
+
+// Ejecuta por bloques las operaciones [i0, i1) (sin globales) sobre src, que puede ser en grises
+// (un byte por pxel, con el ancho en pxeles y el stride en bytes como una vista a color).
+static int run_segment(const OpChain* chain, int i0, int i1, const BgrView* src, int src_gray, Frame* out) {
+    memset(out, 0, sizeof(*out));
+    ChainPlan plan;
+    if (!plan_build(chain, i0, i1, src->width, src->height, src_gray, &plan)) return 0;
+    if (plan.count == 0) {
+        // Solo "gray" sobre una entrada que ya es de grises: el resultado es una copia.
+        if (!gray_image_alloc(&out->gray, src->width, src->height)) return 0;
+        out->is_gray = 1;
+        out->width = src->width;
+        out->height = src->height;
+        for (int y = 0; y < src->height; y++)
+            memcpy(gray_image_row(&out->gray, y), bgr_view_row(src, y), (size_t)src->width);
+        return 1;
+    }
+    const Stage* last = &plan.stages[plan.count - 1];
+    out->width = last->out_w;
+    out->height = last->out_h;
+    out->is_gray = last->out_gray;
+    int ok = out->is_gray ? gray_image_alloc(&out->gray, out->width, out->height)
+                          : (out->bgr = (BGR*)malloc((size_t)out->width * out->height * sizeof(BGR))) != NULL;
+    if (!ok) {
+        plan_free(&plan);
+        return 0;
+    }
+
+    ChainJob job = { &plan, *src, out, 1 };
+    if (plan.count == 1) {
+        // Una sola etapa: sin bloques, el filtro reparte la imagen entera entre los hilos.
+        chain_band(&job, 0, out->height);
+    } else {
+        // Bloques del tamao de la cach para los buffers de todas las etapas, pero bastante ms
+        // altos que las filas extra que necesitan las convoluciones.
+        size_t row_bytes = (size_t)src->width * sizeof(BGR);
+        int halo = 0;
+        for (int i = 0; i < plan.count; i++) {
+            const Stage* st = &plan.stages[i];
+            row_bytes += (size_t)st->out_w * (st->out_gray ? 1 : sizeof(BGR));
+            halo += st->radius;
+        }
+        int band = parallel_band_rows(out->height, row_bytes);
+        if (band < 16 * halo) band = 16 * halo;
+        parallel_rows(out->height, band, chain_band, &job);
+    }
+    plan_free(&plan);
+    if (!job.ok) frame_free(out);
+    return job.ok;
+}
+
+// --- OPERACIONES GLOBALES ---
+// equalize, autocontrast y otsu necesitan el histograma de toda su entrada antes de escribir la
+// primera fila, as que no entran en los bloques: se miden las estadsticas de la imagen que llega
+// (stats_view o stats_gray, en paralelo), se arma una tabla por canal y se aplica en otra pasada.
+
+static int is_global(const ChainOp* op) {
+    return op->type == OP_EQUALIZE || op->type == OP_AUTOCONTRAST || op->type == OP_OTSU;
+}
+
+typedef struct {
+    BgrView src;
+    int channels;           // 1 (grises) o 3 (B, G, R intercalados).
+    uint8_t lut[3][256];
+    uint8_t* dst;
+    ptrdiff_t dst_stride;
+} LutJob;
+
+static void lut_band(void* ctx, int y0, int y1) {
+    LutJob* job = (LutJob*)ctx;
+    const size_t n = (size_t)job->src.width * job->channels;
+    for (int y = y0; y < y1; y++) {
+        const uint8_t* s = (const uint8_t*)bgr_view_row(&job->src, y);
+        uint8_t* d = job->dst + (ptrdiff_t)y * job->dst_stride;
+        if (job->channels == 1) {
+            lut_row(job->lut[0], s, d, n);
+            continue;
+        }
+        for (size_t i = 0; i < n; i += 3) {
+            d[i] = job->lut[0][s[i]];
+            d[i + 1] = job->lut[1][s[i + 1]];
+            d[i + 2] = job->lut[2][s[i + 2]];
+        }
+    }
+}
+
+// Aplica la operacin global op a src (a color o en grises, como en run_segment).
+static int run_global(const ChainOp* op, const BgrView* src, int src_gray, Frame* out) {
+    memset(out, 0, sizeof(*out));
+    ImageStats st;
+    GrayImage g = { src->width, src->height, (uint8_t*)src->data, src->stride };
+    if (!(src_gray ? stats_gray(&g, &st) : stats_view(src, &st))) return 0;
+
+    LutJob job;
+    job.src = *src;
+    job.channels = src_gray ? 1 : 3;
+    uint64_t all[256]; // Para autocontrast a color: los tres canales juntos, as no cambia el tono.
+    for (int v = 0; v < 256; v++) all[v] = st.hist[STAT_B][v] + st.hist[STAT_G][v] + st.hist[STAT_R][v];
+    for (int c = 0; c < job.channels; c++) {
+        const uint64_t* hist = src_gray ? st.hist[STAT_LUMA] : st.hist[c];
+        if (op->type == OP_EQUALIZE) {
+            stats_equalize_lut(hist, job.lut[c]);
+        } else if (op->type == OP_AUTOCONTRAST) {
+            stats_autocontrast_lut(src_gray ? hist : all, op->value, job.lut[c]);
+        } else {
+            int t = stats_otsu(hist);
+            for (int v = 0; v < 256; v++) job.lut[c][v] = v >= t ? 255 : 0;
+        }
+    }
+
+    out->width = src->width;
+    out->height = src->height;
+    out->is_gray = src_gray;
+    int ok = src_gray ? gray_image_alloc(&out->gray, out->width, out->height)
+                      : (out->bgr = (BGR*)malloc((size_t)out->width * out->height * sizeof(BGR))) != NULL;
+    if (!ok) return 0;
+    job.dst = src_gray ? out->gray.data : (uint8_t*)out->bgr;
+    job.dst_stride = src_gray ? out->gray.stride : (ptrdiff_t)out->width * (ptrdiff_t)sizeof(BGR);
+    size_t row_bytes = (size_t)src->width * job.channels * 2;
+    parallel_rows(src->height, parallel_band_rows(src->height, row_bytes), lut_band, &job);
+    return 1;
+}
+
+// Vista sobre un frame (en grises, con un byte por pxel).
+static BgrView frame_view(const Frame* f) {
+    if (f->is_gray) {
+        BgrView v = { f->gray.data, f->gray.stride, f->width, f->height };
+        return v;
+    }
+    return bgr_view_packed(f->bgr, f->width, f->height);
+}
+
+// La cadena se ejecuta por tramos separados por las operaciones globales: cada tramo lee el
+// resultado del anterior (el primero, src) y solo se guarda el ltimo resultado.
+int chain_run(const OpChain* chain, const BgrView* src, Frame* out) {
+    Frame cur;  // Resultado hasta ahora (vaco mientras se lee src).
+    memset(&cur, 0, sizeof(cur));
+    BgrView view = *src;
+    int gray = 0, i0 = 0, ok = 1;
+    for (int i = 0; i <= chain->count && ok; i++) {
+        if (i < chain->count && !is_global(&chain->ops[i])) continue;
+        for (int step = 0; step < 2 && ok; step++) {
+            // Paso 0: el tramo [i0, i) si no est vaco. Paso 1: la operacin global i.
+            if (step == 0 ? i == i0 : i == chain->count) continue;
+            Frame next;
+            ok = step == 0 ? run_segment(chain, i0, i, &view, gray, &next)
+                           : run_global(&chain->ops[i], &view, gray, &next);
+            frame_free(&cur);
+            if (!ok) break;
+            cur = next;
+            view = frame_view(&cur);
+            gray = cur.is_gray;
+        }
+        i0 = i + 1;
+    }
+    if (!ok) return 0;
+    *out = cur;
+    return 1;
+}
+
+int chain_apply(const OpChain* chain, Frame* frame) {
+    if (frame->is_gray) return 0; // Las cadenas parten de una imagen a color.
+    BgrView v = bgr_view_packed(frame->bgr, frame->width, frame->height);
+    Frame out;
+    if (!chain_run(chain, &v, &out)) return 0;
+    frame_free(frame);
+    *frame = out;
+    return 1;
+}
@@ -0,0 +1,80 @@
+// chain.h
+// Cadenas de operaciones sobre una imagen, descritas como texto ("gray,gauss7,threshold128") o
+// ledas de un archivo. Las usan la opcin de cadena del men, --chain y el procesamiento por lotes.
+// Al ejecutarla, las operaciones pxel a pxel consecutivas se fusionan en una sola pasada (una
+// tabla de 256 valores) y la imagen se recorre en bloques de filas que pasan por toda la cadena
+// mientras siguen en cach: los resultados intermedios nunca ocupan una imagen completa.
+// Las operaciones que dependen del histograma de toda su entrada (equalize, autocontrast, otsu)
+// cortan la cadena: lo anterior se ejecuta entero, se miden sus estadsticas y se sigue con una tabla.
+#ifndef CHAIN_H
+#define CHAIN_H
+
+#include "bmp.h"
+#include "convolve.h"
+#include "integral.h"
+#include "resize.h"
+
+#define CHAIN_MAX_OPS 16
+
+typedef enum {
+    OP_GRAY,         // Color -> grises.
+    OP_THRESHOLD,    // value: 255 si el nivel es >= value, 0 si no (por canal si es a color).
+    OP_INVERT,       // 255 - nivel.
+    OP_CONV,         // Convolucin (3x3 de ejemplo, gaussiano o caja); a color si todava no hay gris.
+    OP_RESIZE,       // A width x height, o a value % si width es 0, con el filtro filter.
+    OP_LOCAL,        // Media, desvo o umbral adaptativo con ventana de radio value (por canal si es a color).
+    OP_EQUALIZE,     // Ecualizacin del histograma (por canal si es a color).
+    OP_AUTOCONTRAST, // Estira el rango de niveles a [0, 255] recortando value % en cada extremo.
+    OP_OTSU,         // Umbral de Otsu calculado sobre la imagen (por canal si es a color).
+    OP_EDGES         // Magnitud del gradiente de Sobel (siempre en grises); value 1: con supresin de no mximos.
+} OpType;
+
+typedef struct {
+    OpType type;
+    ConvKernel kern;     // Solo OP_CONV.
+    int value;           // Umbral de OP_THRESHOLD, porcentaje de OP_RESIZE o de OP_AUTOCONTRAST, radio de OP_LOCAL o nms de OP_EDGES.
+    int width, height;   // Tamao de OP_RESIZE.
+    LocalOp local;       // Solo OP_LOCAL.
+    int c;               // Constante del umbral adaptativo (media - c).
+    ResizeFilter filter; // Filtro de OP_RESIZE (vecino ms cercano si no se indica).
+} ChainOp;
+
+typedef struct {
+    int count;
+    ChainOp ops[CHAIN_MAX_OPS];
+} OpChain;
+
+// Imagen resultado de una cadena: a color (BGR contiguo) o en grises (planar).
+typedef struct {
+    int is_gray;
+    BGR* bgr;          // Si !is_gray: width * height pxeles (propios).
+    GrayImage gray;    // Si is_gray.
+    int width, height;
+} Frame;
+
+// Interpreta una cadena de operaciones separadas por comas o espacios. Cada operacin es un nombre
+// (gray, invert, thresholdN, blur, sharpen, sobelx, sobely, laplace, gaussN, boxN, resizeWxH,
+// resizeN%, con ":box", ":bilinear" o ":lanczos" al final para elegir el filtro, meanR, stddevR, adaptiveR, con R el radio de la ventana, equalize, autocontrast,
+// autocontrastN, con N el porcentaje de pxeles que se recorta en cada extremo, otsu, y edges o
+// edges:nms para la magnitud del gradiente sin o con supresin de no mximos) y las
+// convoluciones aceptan un offset "@valor", por ejemplo "gray,laplace@128"; en adaptiveR@c es la
+// constante que se resta a la media.
+// Si spec empieza con '@', el resto es la ruta de un archivo con la cadena (admite saltos de
+// lnea y comentarios con '#'). Devuelve 1 si es vlida; si no, imprime el motivo y devuelve 0.
+int chain_parse(const char* spec, OpChain* chain);
+
+void chain_free(OpChain* chain);
+
+// Ejecuta la cadena sobre src (cualquier stride/orientacin, por ejemplo un BMP proyectado) y deja
+// el resultado en out, que se reserva aqu. Devuelve 1 o 0 (memoria).
+int chain_run(const OpChain* chain, const BgrView* src, Frame* out);
+
+// Aplica la cadena a frame, reemplazando su contenido por el resultado. Devuelve 1 o 0 (memoria).
+int chain_apply(const OpChain* chain, Frame* frame);
+
+// Guarda el frame como BMP de 24 bits (los grises se expanden a r = g = b).
+int frame_save(const Frame* frame, const char* path);
+
+void frame_free(Frame* frame);
+
+#endif
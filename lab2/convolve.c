@@ -0,0 +1,677 @@
+// convolve.c
+// Motor de convolucin NxN: estrategias directa, separable, caja y FFT, y su benchmark.
+
+#include "convolve.h"
+#include "filters.h"
+#include "parallel.h"
+#include <stdio.h>      // Para printf
+#include <stdlib.h>     // Para malloc, calloc, free, rand
+#include <string.h>     // Para memset, memcpy
+#include <math.h>       // Para exp, cos, sin
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CONVOLVE_X86 1
+#include <immintrin.h>  // Intrnsecos SSE2/AVX2 (habilitados por funcin con __attribute__((target)))
+#endif
+
+// Cruces medidos con conv_benchmark sobre 4 MP (AVX2): a partir de este lado un kernel no
+// separable es ms rpido por FFT que directo (la directa crece con size^2, la FFT casi no).
+#define CONV_FFT_MIN_SIZE 21
+// Lado a partir del cual incluso un kernel separable (costo 2 * size por pxel) pierde con la FFT.
+#define CONV_FFT_MIN_SIZE_SEPARABLE 191
+
+// --- KERNELS ---
+
+int conv_kernel_alloc(ConvKernel* kern, int size) {
+    kern->size = size;
+    kern->divisor = 1;
+    kern->offset = 0;
+    kern->k = NULL;
+    if (size < 1 || size > CONV_MAX_SIZE || size % 2 == 0) return 0;
+    kern->k = (int*)calloc((size_t)size * size, sizeof(int));
+    return kern->k != NULL;
+}
+
+void conv_kernel_free(ConvKernel* kern) {
+    free(kern->k);
+    kern->k = NULL;
+    kern->size = 0;
+}
+
+int conv_kernel_box(ConvKernel* kern, int size) {
+    if (!conv_kernel_alloc(kern, size)) return 0;
+    for (int i = 0; i < size * size; i++) kern->k[i] = 1;
+    kern->divisor = size * size;
+    return 1;
+}
+
+int conv_kernel_gaussian(ConvKernel* kern, int size, double sigma) {
+    if (!conv_kernel_alloc(kern, size)) return 0;
+    if (sigma <= 0) sigma = size / 6.0;
+    int r = size / 2;
+    // Gaussiano 1D escalado para que sus pesos sumen alrededor de 1024: as la suma 2D
+    // (hasta 255 * 1024^2) entra cmoda en 32 bits y los pesos chicos no se pierden al redondear.
+    double sum = 0;
+    for (int i = -r; i <= r; i++) sum += exp(-(double)(i * i) / (2 * sigma * sigma));
+    int g[CONV_MAX_SIZE];
+    int total = 0;
+    for (int i = -r; i <= r; i++) {
+        g[i + r] = (int)(1024.0 * exp(-(double)(i * i) / (2 * sigma * sigma)) / sum + 0.5);
+        total += g[i + r];
+    }
+    if (g[r] == 0) g[r] = 1, total = 1; // sigma diminuto: queda la identidad.
+    for (int i = 0; i < size; i++)
+        for (int j = 0; j < size; j++)
+            kern->k[i * size + j] = g[i] * g[j];
+    kern->divisor = total * total;
+    return 1;
+}
+
+// Detecta si k = col * row (rango 1) con enteros. Devuelve 1 y llena col/row si es separable.
+// Generaliza a NxN la deteccin de filters.c.
+static int kernel_is_separable(const ConvKernel* kern, int* col, int* row) {
+    const int n = kern->size;
+    const int* k = kern->k;
+    int i0 = -1, j0 = -1;
+    for (int i = 0; i < n && i0 < 0; i++)
+        for (int j = 0; j < n; j++)
+            if (k[i * n + j] != 0) { i0 = i; j0 = j; break; }
+    if (i0 < 0) return 0; // Kernel nulo.
+
+    // La fila base es la primera fila no nula dividida por el mcd de sus elementos.
+    int g = 0;
+    for (int j = 0; j < n; j++) {
+        int a = k[i0 * n + j] < 0 ? -k[i0 * n + j] : k[i0 * n + j];
+        while (a) { int t = g % a; g = a; a = t; }
+    }
+    for (int j = 0; j < n; j++) row[j] = k[i0 * n + j] / g;
+    for (int i = 0; i < n; i++) {
+        if (k[i * n + j0] % row[j0] != 0) return 0;
+        col[i] = k[i * n + j0] / row[j0];
+        for (int j = 0; j < n; j++)
+            if (k[i * n + j] != col[i] * row[j]) return 0;
+    }
+    return 1;
+}
+
+// Devuelve 1 si todos los pesos son iguales y no nulos (filtro de caja escalado).
+static int kernel_is_box(const ConvKernel* kern) {
+    const int cnt = kern->size * kern->size;
+    if (kern->k[0] == 0) return 0;
+    for (int i = 1; i < cnt; i++)
+        if (kern->k[i] != kern->k[0]) return 0;
+    return 1;
+}
+
+// Suma de |pesos|: 255 veces este valor acota cualquier suma de la convolucin.
+static long long kernel_abs_sum(const ConvKernel* kern) {
+    long long s = 0;
+    for (int i = 0; i < kern->size * kern->size; i++)
+        s += kern->k[i] < 0 ? -(long long)kern->k[i] : kern->k[i];
+    return s;
+}
+
+int conv_supports(const ConvKernel* kern, ConvStrategy s) {
+    if (!kern->k || kern->size < 1 || kern->size > CONV_MAX_SIZE || kern->size % 2 == 0) return 0;
+    if (255 * kernel_abs_sum(kern) > 0x7FFFFFFF) return 0; // Las sumas deben caber en 32 bits.
+    int tmp_col[CONV_MAX_SIZE], tmp_row[CONV_MAX_SIZE];
+    switch (s) {
+    case CONV_SEPARABLE: return kernel_is_separable(kern, tmp_col, tmp_row);
+    case CONV_BOX: return kernel_is_box(kern);
+    default: return 1;
+    }
+}
+
+ConvStrategy conv_choose(const ConvKernel* kern) {
+    if (kern->size == 3) return CONV_DIRECT; // La ruta 3x3 de filters.c ya est afinada.
+    if (conv_supports(kern, CONV_BOX)) return CONV_BOX;
+    if (conv_supports(kern, CONV_SEPARABLE))
+        return kern->size >= CONV_FFT_MIN_SIZE_SEPARABLE ? CONV_FFT : CONV_SEPARABLE;
+    return kern->size >= CONV_FFT_MIN_SIZE ? CONV_FFT : CONV_DIRECT;
+}
+
+const char* conv_strategy_name(ConvStrategy s) {
+    switch (s) {
+    case CONV_DIRECT: return "directa";
+    case CONV_SEPARABLE: return "separable";
+    case CONV_BOX: return "caja";
+    case CONV_FFT: return "FFT";
+    default: return "automtica";
+    }
+}
+
+// --- PRIMITIVAS DE FILA ---
+// Todas las estrategias espaciales se arman con dos operaciones sobre filas enteras:
+// acc[x] += w * src[x] (con src de 8 o de 32 bits) y la normalizacin final a 8 bits.
+
+static void axpy_u8_scalar(int32_t* acc, const uint8_t* src, int n, int w) {
+    for (int x = 0; x < n; x++) acc[x] += w * src[x];
+}
+
+static void axpy_i32_scalar(int32_t* acc, const int32_t* src, int n, int w) {
+    for (int x = 0; x < n; x++) acc[x] += w * src[x];
+}
+
+// Normalizacin con la divisin entera original (trunca hacia cero).
+static void finish_scalar(const int32_t* acc, uint8_t* out, int n, int divisor, int offset) {
+    for (int x = 0; x < n; x++) out[x] = clampi(acc[x] / divisor + offset);
+}
+
+#ifdef CONVOLVE_X86
+// Producto de 32 bits (parte baja) con SSE2, que no tiene _mm_mullo_epi32.
+__attribute__((target("sse2")))
+static inline __m128i mullo32_sse2(__m128i a, __m128i b) {
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+__attribute__((target("sse2")))
+static void axpy_u8_sse2(int32_t* acc, const uint8_t* src, int n, int w) {
+    const __m128i wv = _mm_set1_epi32(w);
+    const __m128i z = _mm_setzero_si128();
+    int x = 0;
+    for (; x + 8 <= n; x += 8) {
+        __m128i v = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(src + x)), z);
+        __m128i lo = mullo32_sse2(_mm_unpacklo_epi16(v, z), wv);
+        __m128i hi = mullo32_sse2(_mm_unpackhi_epi16(v, z), wv);
+        _mm_storeu_si128((__m128i*)(acc + x), _mm_add_epi32(_mm_loadu_si128((const __m128i*)(acc + x)), lo));
+        _mm_storeu_si128((__m128i*)(acc + x + 4), _mm_add_epi32(_mm_loadu_si128((const __m128i*)(acc + x + 4)), hi));
+    }
+    axpy_u8_scalar(acc + x, src + x, n - x, w);
+}
+
+__attribute__((target("sse2")))
+static void axpy_i32_sse2(int32_t* acc, const int32_t* src, int n, int w) {
+    const __m128i wv = _mm_set1_epi32(w);
+    int x = 0;
+    for (; x + 4 <= n; x += 4) {
+        __m128i p = mullo32_sse2(_mm_loadu_si128((const __m128i*)(src + x)), wv);
+        _mm_storeu_si128((__m128i*)(acc + x), _mm_add_epi32(_mm_loadu_si128((const __m128i*)(acc + x)), p));
+    }
+    axpy_i32_scalar(acc + x, src + x, n - x, w);
+}
+
+__attribute__((target("avx2")))
+static void axpy_u8_avx2(int32_t* acc, const uint8_t* src, int n, int w) {
+    const __m256i wv = _mm256_set1_epi32(w);
+    int x = 0;
+    for (; x + 8 <= n; x += 8) {
+        __m256i v = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(src + x)));
+        __m256i a = _mm256_loadu_si256((const __m256i*)(acc + x));
+        _mm256_storeu_si256((__m256i*)(acc + x), _mm256_add_epi32(a, _mm256_mullo_epi32(v, wv)));
+    }
+    axpy_u8_scalar(acc + x, src + x, n - x, w);
+}
+
+__attribute__((target("avx2")))
+static void axpy_i32_avx2(int32_t* acc, const int32_t* src, int n, int w) {
+    const __m256i wv = _mm256_set1_epi32(w);
+    int x = 0;
+    for (; x + 8 <= n; x += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(src + x));
+        __m256i a = _mm256_loadu_si256((const __m256i*)(acc + x));
+        _mm256_storeu_si256((__m256i*)(acc + x), _mm256_add_epi32(a, _mm256_mullo_epi32(v, wv)));
+    }
+    axpy_i32_scalar(acc + x, src + x, n - x, w);
+}
+
+// Normalizacin de 8 sumas: la divisin en float es exacta al truncar mientras |suma| < 2^24
+// (mismo argumento que conv_finish_sse2 en filters.c); la saturacin de packus equivale a clampi.
+__attribute__((target("sse2")))
+static void finish_sse2(const int32_t* acc, uint8_t* out, int n, int divisor, int offset) {
+    const __m128 dv = _mm_set1_ps((float)divisor);
+    const __m128i off = _mm_set1_epi32(offset);
+    int x = 0;
+    for (; x + 8 <= n; x += 8) {
+        __m128i lo = _mm_loadu_si128((const __m128i*)(acc + x));
+        __m128i hi = _mm_loadu_si128((const __m128i*)(acc + x + 4));
+        if (divisor != 1) {
+            lo = _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(lo), dv));
+            hi = _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(hi), dv));
+        }
+        __m128i p = _mm_packs_epi32(_mm_add_epi32(lo, off), _mm_add_epi32(hi, off));
+        _mm_storel_epi64((__m128i*)(out + x), _mm_packus_epi16(p, p));
+    }
+    finish_scalar(acc + x, out + x, n - x, divisor, offset);
+}
+#endif
+
+typedef void (*AxpyU8Fn)(int32_t* acc, const uint8_t* src, int n, int w);
+typedef void (*AxpyI32Fn)(int32_t* acc, const int32_t* src, int n, int w);
+typedef void (*FinishFn)(const int32_t* acc, uint8_t* out, int n, int divisor, int offset);
+
+// Datos compartidos por las bandas de una convolucin NxN.
+typedef struct {
+    const GrayImage* src;
+    GrayImage* dst;
+    const ConvKernel* kern;
+    int divisor;
+    int* col;           // Separable: factores vertical y horizontal.
+    int* row;
+    AxpyU8Fn axpy_u8;
+    AxpyI32Fn axpy_i32;
+    FinishFn finish;
+    // FFT
+    int tile;           // Lado del bloque (potencia de 2).
+    int log_tile;
+    int step;           // Salida vlida por bloque: tile - size + 1.
+    int y0, y1;         // Filas de salida pedidas.
+    double* kre;        // Espectro del kernel (tile * tile).
+    double* kim;
+    double* cos_t;      // Tablas de giro para tile / 2 frecuencias.
+    double* sin_t;
+    int failed;         // Se pone en 1 si una banda no pudo reservar memoria (sus filas quedan sin escribir).
+} NxNJob;
+
+// Acumula en acc (width enteros) la fila src ponderada por w y desplazada dx columnas:
+// acc[x] += w * src[x + dx] solo donde x + dx cae dentro de la imagen (los vecinos de afuera no suman).
+static void axpy_shifted_u8(const NxNJob* job, int32_t* acc, const uint8_t* src, int width, int dx, int w) {
+    int xa = dx < 0 ? -dx : 0;
+    int xb = dx > 0 ? width - dx : width;
+    if (w != 0 && xa < xb) job->axpy_u8(acc + xa, src + xa + dx, xb - xa, w);
+}
+
+// --- ESTRATEGIA DIRECTA ---
+// Por cada fila de salida acumula las size * size filas desplazadas del kernel. Cada paso es un
+// recorrido lineal vectorizado, sin verificar lmites pxel por pxel.
+static void direct_band(void* ctx, int y0, int y1) {
+    NxNJob* job = (NxNJob*)ctx;
+    const int width = job->src->width, height = job->src->height;
+    const int n = job->kern->size, r = n / 2;
+    int32_t* acc = (int32_t*)malloc(sizeof(int32_t) * width);
+    if (!acc) { job->failed = 1; return; } // Solo se escribe 1: no hace falta sincronizar entre bandas.
+    for (int y = y0; y < y1; y++) {
+        memset(acc, 0, sizeof(int32_t) * width);
+        for (int i = 0; i < n; i++) {
+            int sy = y + i - r;
+            if (sy < 0 || sy >= height) continue;
+            const uint8_t* srow = gray_image_row(job->src, sy);
+            for (int j = 0; j < n; j++)
+                axpy_shifted_u8(job, acc, srow, width, j - r, job->kern->k[i * n + j]);
+        }
+        job->finish(acc, gray_image_row(job->dst, y), width, job->divisor, job->kern->offset);
+    }
+    free(acc);
+}
+
+// --- ESTRATEGIA SEPARABLE ---
+// Pasada horizontal de cada fila (size productos) en un anillo de size filas de 32 bits y pasada
+// vertical sobre el anillo: 2 * size productos por pxel en vez de size^2.
+static void separable_band(void* ctx, int y0, int y1) {
+    NxNJob* job = (NxNJob*)ctx;
+    const int width = job->src->width, height = job->src->height;
+    const int n = job->kern->size, r = n / 2;
+    int32_t* ring = (int32_t*)malloc(sizeof(int32_t) * (size_t)n * width);
+    int32_t* acc = (int32_t*)malloc(sizeof(int32_t) * width);
+    if (!ring || !acc) { job->failed = 1; free(ring); free(acc); return; }
+
+    int next = y0 - r > 0 ? y0 - r : 0; // Prxima fila de entrada a pasar por la horizontal.
+    for (int y = y0; y < y1; y++) {
+        int last = y + r < height - 1 ? y + r : height - 1;
+        for (; next <= last; next++) {
+            int32_t* h = ring + (size_t)(next % n) * width;
+            const uint8_t* srow = gray_image_row(job->src, next);
+            memset(h, 0, sizeof(int32_t) * width);
+            for (int j = 0; j < n; j++)
+                axpy_shifted_u8(job, h, srow, width, j - r, job->row[j]);
+        }
+        memset(acc, 0, sizeof(int32_t) * width);
+        for (int i = 0; i < n; i++) {
+            int sy = y + i - r;
+            if (sy < 0 || sy >= height || job->col[i] == 0) continue;
+            job->axpy_i32(acc, ring + (size_t)(sy % n) * width, width, job->col[i]);
+        }
+        job->finish(acc, gray_image_row(job->dst, y), width, job->divisor, job->kern->offset);
+    }
+    free(ring);
+    free(acc);
+}
+
+// --- ESTRATEGIA CAJA ---
+// Sumas corridas: colsum[x] guarda la suma de la columna x dentro de la ventana vertical, y la
+// ventana horizontal se desliza sumando la columna que entra y restando la que sale. El costo por
+// pxel es constante sin importar el tamao del kernel.
+static void box_band(void* ctx, int y0, int y1) {
+    NxNJob* job = (NxNJob*)ctx;
+    const int width = job->src->width, height = job->src->height;
+    const int r = job->kern->size / 2;
+    const int c = job->kern->k[0];
+    int32_t* colsum = (int32_t*)calloc(width, sizeof(int32_t));
+    int32_t* acc = (int32_t*)malloc(sizeof(int32_t) * width);
+    if (!colsum || !acc) { job->failed = 1; free(colsum); free(acc); return; }
+
+    // Ventana vertical inicial: filas [y0 - r, y0 + r] dentro de la imagen.
+    for (int sy = y0 - r; sy <= y0 + r; sy++) {
+        if (sy < 0 || sy >= height) continue;
+        const uint8_t* srow = gray_image_row(job->src, sy);
+        for (int x = 0; x < width; x++) colsum[x] += srow[x];
+    }
+    for (int y = y0; y < y1; y++) {
+        int32_t s = 0;
+        for (int x = 0; x <= r && x < width; x++) s += colsum[x];
+        for (int x = 0; x < width; x++) {
+            acc[x] = c * s;
+            if (x + r + 1 < width) s += colsum[x + r + 1];
+            if (x - r >= 0) s -= colsum[x - r];
+        }
+        job->finish(acc, gray_image_row(job->dst, y), width, job->divisor, job->kern->offset);
+        // Desliza la ventana vertical una fila hacia abajo.
+        if (y + 1 < y1) {
+            int add = y + r + 1, sub = y - r;
+            if (add < height) {
+                const uint8_t* srow = gray_image_row(job->src, add);
+                for (int x = 0; x < width; x++) colsum[x] += srow[x];
+            }
+            if (sub >= 0) {
+                const uint8_t* srow = gray_image_row(job->src, sub);
+                for (int x = 0; x < width; x++) colsum[x] -= srow[x];
+            }
+        }
+    }
+    free(colsum);
+    free(acc);
+}
+
+// --- ESTRATEGIA FFT ---
+// Overlap-save por bloques de tile x tile: cada bloque de entrada (con size - 1 filas y columnas
+// de solapamiento, en cero fuera de la imagen) se transforma, se multiplica por el espectro del
+// kernel y se antitransforma; la parte sin aliasing circular es la salida. Como la imagen y el
+// kernel son reales, dos bloques vecinos viajan juntos en una FFT compleja (uno en la parte real
+// y otro en la imaginaria). La suma sale en doble precisin y se redondea al entero exacto.
+
+// FFT compleja radix-2 en sitio sobre n = 2^logn puntos separados por stride.
+// inverse = 1 usa los giros conjugados (sin escalar).
+static void fft1d(double* re, double* im, int logn, size_t stride, const double* cos_t, const double* sin_t,
+                  int tile, int inverse) {
+    const int n = 1 << logn;
+    // Permutacin por inversin de bits.
+    for (int i = 1, j = 0; i < n; i++) {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) {
+            double t = re[i * stride]; re[i * stride] = re[j * stride]; re[j * stride] = t;
+            t = im[i * stride]; im[i * stride] = im[j * stride]; im[j * stride] = t;
+        }
+    }
+    for (int len = 2; len <= n; len <<= 1) {
+        int half = len >> 1;
+        int tstep = tile / len; // Las tablas tienen tile / 2 giros.
+        for (int i = 0; i < n; i += len) {
+            for (int k = 0; k < half; k++) {
+                double wr = cos_t[k * tstep];
+                double wi = inverse ? sin_t[k * tstep] : -sin_t[k * tstep];
+                size_t a = (size_t)(i + k) * stride, b = (size_t)(i + k + half) * stride;
+                double xr = re[b] * wr - im[b] * wi;
+                double xi = re[b] * wi + im[b] * wr;
+                re[b] = re[a] - xr; im[b] = im[a] - xi;
+                re[a] += xr;        im[a] += xi;
+            }
+        }
+    }
+}
+
+// Traspone en sitio una matriz cuadrada de t x t.
+static void transpose_square(double* m, int t) {
+    for (int i = 0; i < t; i++)
+        for (int j = i + 1; j < t; j++) {
+            double tmp = m[(size_t)i * t + j];
+            m[(size_t)i * t + j] = m[(size_t)j * t + i];
+            m[(size_t)j * t + i] = tmp;
+        }
+}
+
+// FFT 2D de un bloque tile x tile: filas, trasposicin y filas otra vez, para no recorrer las
+// columnas con saltos de tile elementos. El resultado queda traspuesto; como el espectro del
+// kernel se calcula igual y la transformada inversa vuelve a trasponer, no hace falta deshacerlo.
+static void fft2d(const NxNJob* job, double* re, double* im, int inverse) {
+    const int t = job->tile;
+    for (int pass = 0; pass < 2; pass++) {
+        for (int y = 0; y < t; y++)
+            fft1d(re + (size_t)y * t, im + (size_t)y * t, job->log_tile, 1, job->cos_t, job->sin_t, t, inverse);
+        if (pass == 0) {
+            transpose_square(re, t);
+            transpose_square(im, t);
+        }
+    }
+}
+
+// Copia al bloque el recorte de la imagen que empieza en (top, left), con ceros fuera de ella.
+static void fft_load_tile(const GrayImage* img, double* dst, int tile, int top, int left) {
+    for (int p = 0; p < tile; p++) {
+        double* d = dst + (size_t)p * tile;
+        int sy = top + p;
+        if (sy < 0 || sy >= img->height) { memset(d, 0, sizeof(double) * tile); continue; }
+        const uint8_t* srow = gray_image_row(img, sy);
+        for (int q = 0; q < tile; q++) {
+            int sx = left + q;
+            d[q] = (sx >= 0 && sx < img->width) ? srow[sx] : 0.0;
+        }
+    }
+}
+
+// Procesa las filas de bloques [t0, t1).
+static void fft_band(void* ctx, int t0, int t1) {
+    NxNJob* job = (NxNJob*)ctx;
+    const int tile = job->tile, step = job->step, n = job->kern->size, r = n / 2;
+    const int width = job->src->width;
+    const double scale = 1.0 / ((double)tile * tile);
+    double* re = (double*)malloc(sizeof(double) * tile * tile);
+    double* im = (double*)malloc(sizeof(double) * tile * tile);
+    int32_t* acc = (int32_t*)malloc(sizeof(int32_t) * 2 * step);
+    if (!re || !im || !acc) { job->failed = 1; free(re); free(im); free(acc); return; }
+
+    for (int tr = t0; tr < t1; tr++) {
+        int ty = job->y0 + tr * step;                  // Primera fila de salida del bloque.
+        int rows = job->y1 - ty < step ? job->y1 - ty : step;
+        for (int tx = 0; tx < width; tx += 2 * step) { // Dos bloques por FFT.
+            fft_load_tile(job->src, re, tile, ty - r, tx - r);
+            fft_load_tile(job->src, im, tile, ty - r, tx + step - r);
+            fft2d(job, re, im, 0);
+            for (size_t i = 0; i < (size_t)tile * tile; i++) {
+                double a = re[i], b = im[i];
+                re[i] = a * job->kre[i] - b * job->kim[i];
+                im[i] = a * job->kim[i] + b * job->kre[i];
+            }
+            fft2d(job, re, im, 1);
+            // Salida vlida: filas y columnas [n - 1, tile) del bloque.
+            int cols = width - tx < 2 * step ? width - tx : 2 * step;
+            for (int p = 0; p < rows; p++) {
+                const double* pr = re + (size_t)(p + n - 1) * tile + (n - 1);
+                const double* pi = im + (size_t)(p + n - 1) * tile + (n - 1);
+                for (int q = 0; q < cols; q++) {
+                    double v = (q < step ? pr[q] : pi[q - step]) * scale;
+                    acc[q] = v >= 0 ? (int32_t)(v + 0.5) : -(int32_t)(-v + 0.5);
+                }
+                job->finish(acc, gray_image_row(job->dst, ty + p) + tx, cols, job->divisor, job->kern->offset);
+            }
+        }
+    }
+    free(re);
+    free(im);
+    free(acc);
+}
+
+// Prepara tablas y espectro del kernel y reparte las filas de bloques entre los hilos.
+static int convolve_fft(NxNJob* job) {
+    const int n = job->kern->size;
+    // Bloques de unas 4 veces el kernel: ms grandes desperdician menos solapamiento pero cada FFT
+    // cuesta ms por pxel; 64 es el mnimo razonable.
+    int tile = 64, log_tile = 6;
+    while (tile < 4 * (n - 1)) { tile <<= 1; log_tile++; }
+    job->tile = tile;
+    job->log_tile = log_tile;
+    job->step = tile - n + 1;
+    size_t area = (size_t)tile * tile;
+    job->kre = (double*)calloc(area, sizeof(double));
+    job->kim = (double*)calloc(area, sizeof(double));
+    job->cos_t = (double*)malloc(sizeof(double) * (tile / 2));
+    job->sin_t = (double*)malloc(sizeof(double) * (tile / 2));
+    int ok = job->kre && job->kim && job->cos_t && job->sin_t;
+    if (ok) {
+        const double pi = 3.14159265358979323846;
+        for (int i = 0; i < tile / 2; i++) {
+            job->cos_t[i] = cos(2 * pi * i / tile);
+            job->sin_t[i] = sin(2 * pi * i / tile);
+        }
+        // El kernel va invertido: la convolucin circular con l equivale a la correlacin que
+        // calculan las otras estrategias.
+        for (int i = 0; i < n; i++)
+            for (int j = 0; j < n; j++)
+                job->kre[(size_t)i * tile + j] = job->kern->k[(n - 1 - i) * n + (n - 1 - j)];
+        fft2d(job, job->kre, job->kim, 0);
+        int tile_rows = (job->y1 - job->y0 + job->step - 1) / job->step;
+        parallel_rows(tile_rows, 1, fft_band, job);
+    }
+    free(job->kre);
+    free(job->kim);
+    free(job->cos_t);
+    free(job->sin_t);
+    return ok && !job->failed;
+}
+
+// --- FUNCIN convolve_plane ---
+// Aplica el kernel con la estrategia pedida (o la elegida por conv_choose). Las estrategias
+// espaciales trabajan en bandas de filas paralelas; la FFT en filas de bloques paralelas.
+int convolve_plane(const GrayImage* src, GrayImage* dst, const ConvKernel* kern, ConvStrategy s) {
+    return convolve_plane_rows(src, dst, kern, s, 0, src->height);
+}
+
+int convolve_plane_rows(const GrayImage* src, GrayImage* dst, const ConvKernel* kern, ConvStrategy s, int y0, int y1) {
+    if (s == CONV_AUTO) s = conv_choose(kern);
+    if (!conv_supports(kern, s)) return 0;
+    const int width = src->width;
+    if (width <= 0 || y1 <= y0) return 1;
+    const int divisor = kern->divisor == 0 ? 1 : kern->divisor; // Para evitar divisin por cero.
+
+    if (s == CONV_DIRECT && kern->size == 3) {
+        // Reutiliza la convolucin 3x3 de filters.c (interior SSE2 de 16 bits, deteccin separable).
+        int k3[3][3];
+        for (int i = 0; i < 9; i++) k3[i / 3][i % 3] = kern->k[i];
+        return convolve3x3_plane_rows(src, dst, k3, divisor, kern->offset, y0, y1);
+    }
+
+    NxNJob job;
+    memset(&job, 0, sizeof(job));
+    job.src = src;
+    job.dst = dst;
+    job.kern = kern;
+    job.divisor = divisor;
+    job.axpy_u8 = axpy_u8_scalar;
+    job.axpy_i32 = axpy_i32_scalar;
+    job.finish = finish_scalar;
+#ifdef CONVOLVE_X86
+    int level = filters_simd_level();
+    if (level >= 2) {
+        job.axpy_u8 = axpy_u8_avx2;
+        job.axpy_i32 = axpy_i32_avx2;
+    } else if (level >= 1) {
+        job.axpy_u8 = axpy_u8_sse2;
+        job.axpy_i32 = axpy_i32_sse2;
+    }
+    if (level >= 1 && 255 * kernel_abs_sum(kern) < (1 << 24)) job.finish = finish_sse2;
+#endif
+
+    int col[CONV_MAX_SIZE], row[CONV_MAX_SIZE];
+    int band = parallel_band_rows(y1 - y0, (size_t)width * 4);
+    switch (s) {
+    case CONV_DIRECT:
+        parallel_rows_range(y0, y1, band, direct_band, &job);
+        return !job.failed;
+    case CONV_SEPARABLE:
+        kernel_is_separable(kern, col, row);
+        job.col = col;
+        job.row = row;
+        parallel_rows_range(y0, y1, band, separable_band, &job);
+        return !job.failed;
+    case CONV_BOX:
+        parallel_rows_range(y0, y1, band, box_band, &job);
+        return !job.failed;
+    case CONV_FFT:
+        job.y0 = y0;
+        job.y1 = y1;
+        return convolve_fft(&job);
+    default:
+        return 0;
+    }
+}
+
+// --- BENCHMARK ---
+
+// Tiempo de pared (ms) de una convolucin; -1 si la estrategia no aplica.
+static double bench_one(const GrayImage* img, GrayImage* out, const ConvKernel* kern, ConvStrategy s) {
+    if (!conv_supports(kern, s)) return -1;
+    double t0 = wall_seconds();
+    if (!convolve_plane(img, out, kern, s)) return -1;
+    return (wall_seconds() - t0) * 1000.0;
+}
+
+// Pxeles distintos entre dos imgenes del mismo tamao (sin mirar el relleno de las filas).
+static long count_diffs(const GrayImage* a, const GrayImage* b) {
+    long diffs = 0;
+    for (int y = 0; y < a->height; y++) {
+        const uint8_t* pa = gray_image_row(a, y);
+        const uint8_t* pb = gray_image_row(b, y);
+        for (int x = 0; x < a->width; x++) diffs += pa[x] != pb[x];
+    }
+    return diffs;
+}
+
+static void print_ms(double ms) {
+    if (ms < 0) printf("%11s", "-");
+    else printf("%11.1f", ms);
+}
+
+// FUNCIN conv_benchmark
+// Para cada tamao de kernel mide: directa y FFT con un kernel no separable (pesos aleatorios),
+// separable y FFT con un gaussiano, y caja con sumas corridas. La directa se omite en tamaos
+// donde tardara demasiado. Adems compara pxel a pxel FFT y separable contra la directa.
+void conv_benchmark(const GrayImage* img) {
+    static const int sizes[] = { 3, 5, 7, 9, 11, 15, 17, 19, 21, 31, 45, 63, 95, 127, 159, 191, 255 };
+    const int count = sizeof(sizes) / sizeof(sizes[0]);
+    GrayImage a = { 0 }, b = { 0 };
+    if (!gray_image_alloc(&a, img->width, img->height) || !gray_image_alloc(&b, img->width, img->height)) {
+        printf("Sin memoria para el benchmark.\n");
+        gray_image_free(&a);
+        gray_image_free(&b);
+        return;
+    }
+    printf("Imagen %dx%d, %d hilos, SIMD %s. Tiempos en ms.\n", img->width, img->height,
+           parallel_threads(), filters_simd_path());
+    printf("%5s %11s %11s %11s %11s %11s  %-10s %-10s %s\n", "lado", "directa", "FFT", "separable",
+           "FFT gauss", "caja", "auto", "auto gauss", "difs");
+    srand(12345);
+    for (int t = 0; t < count; t++) {
+        int n = sizes[t];
+        ConvKernel rnd, gauss, box;
+        if (!conv_kernel_alloc(&rnd, n) || !conv_kernel_gaussian(&gauss, n, 0) || !conv_kernel_box(&box, n)) {
+            conv_kernel_free(&rnd); conv_kernel_free(&gauss); conv_kernel_free(&box);
+            break;
+        }
+        // Pesos aleatorios chicos: el kernel no es separable y las sumas caben en 32 bits.
+        int sum = 0;
+        for (int i = 0; i < n * n; i++) { rnd.k[i] = rand() % 7 - 2; sum += rnd.k[i]; }
+        rnd.divisor = sum != 0 ? sum : 1;
+
+        double direct = n <= 63 ? bench_one(img, &a, &rnd, CONV_DIRECT) : -1;
+        double fft = bench_one(img, &b, &rnd, CONV_FFT);
+        long diffs = 0;
+        if (direct >= 0 && fft >= 0) diffs += count_diffs(&a, &b);
+        double sep = bench_one(img, &a, &gauss, CONV_SEPARABLE);
+        double fftg = bench_one(img, &b, &gauss, CONV_FFT);
+        if (sep >= 0 && fftg >= 0) diffs += count_diffs(&a, &b);
+        double boxt = bench_one(img, &a, &box, CONV_BOX);
+
+        printf("%5d", n);
+        print_ms(direct); print_ms(fft); print_ms(sep); print_ms(fftg); print_ms(boxt);
+        printf("  %-10s %-10s %ld\n", conv_strategy_name(conv_choose(&rnd)),
+               conv_strategy_name(conv_choose(&gauss)), diffs);
+        conv_kernel_free(&rnd);
+        conv_kernel_free(&gauss);
+        conv_kernel_free(&box);
+    }
+    gray_image_free(&a);
+    gray_image_free(&b);
+}
@@ -0,0 +1,60 @@
+// convolve.h
+// Motor de convolucin NxN general sobre imgenes de grises planares. Elige la estrategia segn
+// el kernel: directa vectorizada para kernels chicos, dos pasadas 1D para kernels separables,
+// sumas corridas (O(1) por pxel) para filtros de caja y FFT por bloques para kernels muy grandes.
+// Todas dan el mismo resultado que la convolucin directa: clampi(suma / divisor + offset), con
+// los vecinos fuera de la imagen ignorados (como en convolve3x3_gray).
+#ifndef CONVOLVE_H
+#define CONVOLVE_H
+
+#include "bmp.h"
+
+#define CONV_MAX_SIZE 255 // Lado mximo del kernel.
+
+// Kernel cuadrado de lado impar con pesos enteros.
+typedef struct {
+    int size;      // Lado del kernel (impar, entre 1 y CONV_MAX_SIZE).
+    int* k;        // size * size pesos, fila por fila.
+    int divisor;   // El resultado es clampi(suma / divisor + offset); 0 se trata como 1.
+    int offset;
+} ConvKernel;
+
+typedef enum {
+    CONV_AUTO,       // Elige segn el kernel (conv_choose).
+    CONV_DIRECT,     // Suma directa de size * size productos, vectorizada.
+    CONV_SEPARABLE,  // Pasada horizontal + vertical (solo kernels de rango 1).
+    CONV_BOX,        // Sumas corridas (solo kernels con todos los pesos iguales).
+    CONV_FFT         // Producto en frecuencia por bloques (overlap-save).
+} ConvStrategy;
+
+// Reserva un kernel de size x size en cero (divisor 1, offset 0). Devuelve 1 o 0.
+int conv_kernel_alloc(ConvKernel* kern, int size);
+void conv_kernel_free(ConvKernel* kern);
+
+// Filtro de caja de size x size (todos los pesos 1, divisor size * size).
+int conv_kernel_box(ConvKernel* kern, int size);
+
+// Gaussiano de size x size con desvo sigma (sigma <= 0 usa size / 6). Los pesos son el producto
+// exterior de un gaussiano 1D entero, as que el kernel es separable; divisor = suma de pesos.
+int conv_kernel_gaussian(ConvKernel* kern, int size, double sigma);
+
+// Estrategia ms rpida para el kernel segn los cruces medidos con conv_benchmark.
+ConvStrategy conv_choose(const ConvKernel* kern);
+
+// Indica si la estrategia se puede aplicar al kernel (separable y caja dependen de los pesos).
+int conv_supports(const ConvKernel* kern, ConvStrategy s);
+
+const char* conv_strategy_name(ConvStrategy s);
+
+// Convoluciona src en dst (mismo tamao, ya reservada) con la estrategia pedida.
+// Devuelve 1 si tuvo xito, 0 si el kernel no es vlido, la estrategia no aplica o falta memoria.
+int convolve_plane(const GrayImage* src, GrayImage* dst, const ConvKernel* kern, ConvStrategy s);
+
+// Igual, pero solo escribe las filas [y0, y1) de dst (las dems filas de src se leen como vecinas).
+int convolve_plane_rows(const GrayImage* src, GrayImage* dst, const ConvKernel* kern, ConvStrategy s, int y0, int y1);
+
+// Mide cada estrategia con kernels de distintos tamaos sobre img e imprime la tabla de tiempos,
+// para ubicar los puntos de cruce. Tambin verifica que FFT y separable coincidan con la directa.
+void conv_benchmark(const GrayImage* img);
+
+#endif
@@ -0,0 +1,529 @@
+// edges.c
+// Sobel fusionado por filas: pasada vertical y horizontal, magnitud, direccin y supresin de no
+// mximos, con kernels escalar, SSE2 y AVX2.
+
+#include "edges.h"
+#include "filters.h"    // Para filters_simd_level, to_grayscale_view
+#include "parallel.h"
+#include <stdlib.h>     // Para malloc, free
+#include <math.h>       // Para sqrtf
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define EDGES_X86 1
+#include <immintrin.h>  // Intrnsecos SSE2/AVX2 (habilitados por funcin con __attribute__((target)))
+#endif
+
+// --- SOBEL SEPARABLE ---
+// Gx = [1 2 1]^T * [-1 0 1] y Gy = [-1 0 1]^T * [1 2 1]: por cada fila se suman primero las tres
+// filas de entrada en columna, S = a + 2b + c y D = c - a (la pasada vertical), y despus
+// Gx[x] = S[x + 1] - S[x - 1] y Gy[x] = D[x - 1] + 2 D[x] + D[x + 1] (la horizontal). S, D, Gx y
+// Gy caben en 16 bits con signo (|Gx|, |Gy| <= 1020), as que un registro AVX2 lleva 16 pxeles.
+// S y D se guardan con una columna extra a cada lado que repite la del borde.
+
+// Magnitud de 8 bits a partir de Gx^2 + Gy^2 (< 2^24, exacto en float). Como sqrt en float se
+// redondea correctamente y por 0.25 es exacto, el resultado es round(sqrt(sq) / 4) en cualquier
+// ruta: la distancia de una raz no entera al entero ms cercano es mucho mayor que el error.
+static inline uint8_t mag_from_sq(int32_t sq) {
+    int m = (int)(sqrtf((float)sq) * 0.25f + 0.5f);
+    return (uint8_t)(m > 255 ? 255 : m);
+}
+
+static void vert_scalar(const uint8_t* a, const uint8_t* b, const uint8_t* c, int16_t* s, int16_t* d, int n) {
+    for (int x = 0; x < n; x++) {
+        s[x] = (int16_t)(a[x] + 2 * b[x] + c[x]);
+        d[x] = (int16_t)(c[x] - a[x]);
+    }
+}
+
+// Gx y Gy de la columna x (s y d con las columnas x - 1 y x + 1 vlidas).
+#define SOBEL_GX(s, x) ((s)[(x) + 1] - (s)[(x) - 1])
+#define SOBEL_GY(d, x) ((d)[(x) - 1] + 2 * (d)[x] + (d)[(x) + 1])
+
+static void mag_scalar(const int16_t* s, const int16_t* d, uint8_t* mag, int n) {
+    for (int x = 0; x < n; x++) {
+        int gx = SOBEL_GX(s, x), gy = SOBEL_GY(d, x);
+        mag[x] = mag_from_sq(gx * gx + gy * gy);
+    }
+}
+
+static void grad_scalar(const int16_t* s, const int16_t* d, int16_t* gx, int16_t* gy, int32_t* sq, int n) {
+    for (int x = 0; x < n; x++) {
+        gx[x] = (int16_t)SOBEL_GX(s, x);
+        gy[x] = (int16_t)SOBEL_GY(d, x);
+        sq[x] = gx[x] * gx[x] + gy[x] * gy[x];
+    }
+}
+
+#ifdef EDGES_X86
+__attribute__((target("sse2")))
+static void vert_sse2(const uint8_t* a, const uint8_t* b, const uint8_t* c, int16_t* s, int16_t* d, int n) {
+    const __m128i zero = _mm_setzero_si128();
+    int x = 0;
+    for (; x + 8 <= n; x += 8) {
+        __m128i va = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(a + x)), zero);
+        __m128i vb = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(b + x)), zero);
+        __m128i vc = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(c + x)), zero);
+        _mm_storeu_si128((__m128i*)(s + x), _mm_add_epi16(_mm_add_epi16(va, vc), _mm_add_epi16(vb, vb)));
+        _mm_storeu_si128((__m128i*)(d + x), _mm_sub_epi16(vc, va));
+    }
+    vert_scalar(a + x, b + x, c + x, s + x, d + x, n - x);
+}
+
+// Gx y Gy de 8 columnas desde x.
+__attribute__((target("sse2")))
+static inline void grad8_sse2(const int16_t* s, const int16_t* d, int x, __m128i* gx, __m128i* gy) {
+    *gx = _mm_sub_epi16(_mm_loadu_si128((const __m128i*)(s + x + 1)), _mm_loadu_si128((const __m128i*)(s + x - 1)));
+    __m128i dc = _mm_loadu_si128((const __m128i*)(d + x));
+    *gy = _mm_add_epi16(_mm_add_epi16(_mm_loadu_si128((const __m128i*)(d + x - 1)),
+                                      _mm_loadu_si128((const __m128i*)(d + x + 1))), _mm_add_epi16(dc, dc));
+}
+
+// Magnitud de 4 columnas a partir de Gx^2 + Gy^2: sqrt, por 0.25, ms 0.5 y truncado, igual que
+// mag_from_sq (la saturacin a 255 la hace el packus final).
+__attribute__((target("sse2")))
+static inline __m128i magsq4_sse2(__m128i sq) {
+    __m128 f = _mm_sqrt_ps(_mm_cvtepi32_ps(sq));
+    return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(f, _mm_set1_ps(0.25f)), _mm_set1_ps(0.5f)));
+}
+
+// Gx^2 + Gy^2 de 4 columnas: con Gx y Gy intercalados a pares, madd multiplica y suma cada par.
+__attribute__((target("sse2")))
+static inline __m128i mag4_sse2(__m128i pairs) {
+    return magsq4_sse2(_mm_madd_epi16(pairs, pairs));
+}
+
+__attribute__((target("sse2")))
+static void mag_sse2(const int16_t* s, const int16_t* d, uint8_t* mag, int n) {
+    int x = 0;
+    for (; x + 8 <= n; x += 8) {
+        __m128i gx, gy;
+        grad8_sse2(s, d, x, &gx, &gy);
+        __m128i q = _mm_packs_epi32(mag4_sse2(_mm_unpacklo_epi16(gx, gy)), mag4_sse2(_mm_unpackhi_epi16(gx, gy)));
+        _mm_storel_epi64((__m128i*)(mag + x), _mm_packus_epi16(q, q)); // packus satura a 255.
+    }
+    mag_scalar(s + x, d + x, mag + x, n - x);
+}
+
+__attribute__((target("sse2")))
+static void grad_sse2(const int16_t* s, const int16_t* d, int16_t* gx, int16_t* gy, int32_t* sq, int n) {
+    int x = 0;
+    for (; x + 8 <= n; x += 8) {
+        __m128i vx, vy;
+        grad8_sse2(s, d, x, &vx, &vy);
+        _mm_storeu_si128((__m128i*)(gx + x), vx);
+        _mm_storeu_si128((__m128i*)(gy + x), vy);
+        __m128i lo = _mm_unpacklo_epi16(vx, vy), hi = _mm_unpackhi_epi16(vx, vy);
+        _mm_storeu_si128((__m128i*)(sq + x), _mm_madd_epi16(lo, lo));
+        _mm_storeu_si128((__m128i*)(sq + x + 4), _mm_madd_epi16(hi, hi));
+    }
+    grad_scalar(s + x, d + x, gx + x, gy + x, sq + x, n - x);
+}
+
+// Versiones AVX2 con 16 columnas por iteracin. Los unpack y packs trabajan por carril de 128
+// bits: unpacklo toma las columnas 0-3 y 8-11 y unpackhi las 4-7 y 12-15, y packs las vuelve a
+// ordenar; el ltimo packus repite cada mitad y se junta con permute4x64, como en resize.c.
+__attribute__((target("avx2")))
+static void vert_avx2(const uint8_t* a, const uint8_t* b, const uint8_t* c, int16_t* s, int16_t* d, int n) {
+    int x = 0;
+    for (; x + 16 <= n; x += 16) {
+        __m256i va = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(a + x)));
+        __m256i vb = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(b + x)));
+        __m256i vc = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(c + x)));
+        _mm256_storeu_si256((__m256i*)(s + x), _mm256_add_epi16(_mm256_add_epi16(va, vc), _mm256_add_epi16(vb, vb)));
+        _mm256_storeu_si256((__m256i*)(d + x), _mm256_sub_epi16(vc, va));
+    }
+    vert_sse2(a + x, b + x, c + x, s + x, d + x, n - x);
+}
+
+__attribute__((target("avx2")))
+static inline void grad16_avx2(const int16_t* s, const int16_t* d, int x, __m256i* gx, __m256i* gy) {
+    *gx = _mm256_sub_epi16(_mm256_loadu_si256((const __m256i*)(s + x + 1)),
+                           _mm256_loadu_si256((const __m256i*)(s + x - 1)));
+    __m256i dc = _mm256_loadu_si256((const __m256i*)(d + x));
+    *gy = _mm256_add_epi16(_mm256_add_epi16(_mm256_loadu_si256((const __m256i*)(d + x - 1)),
+                                            _mm256_loadu_si256((const __m256i*)(d + x + 1))),
+                           _mm256_add_epi16(dc, dc));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i magsq8_avx2(__m256i sq) {
+    __m256 f = _mm256_sqrt_ps(_mm256_cvtepi32_ps(sq));
+    return _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(f, _mm256_set1_ps(0.25f)), _mm256_set1_ps(0.5f)));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i mag8_avx2(__m256i pairs) {
+    return magsq8_avx2(_mm256_madd_epi16(pairs, pairs));
+}
+
+__attribute__((target("avx2")))
+static void mag_avx2(const int16_t* s, const int16_t* d, uint8_t* mag, int n) {
+    int x = 0;
+    for (; x + 16 <= n; x += 16) {
+        __m256i gx, gy;
+        grad16_avx2(s, d, x, &gx, &gy);
+        __m256i q = _mm256_packs_epi32(mag8_avx2(_mm256_unpacklo_epi16(gx, gy)),
+                                       mag8_avx2(_mm256_unpackhi_epi16(gx, gy)));
+        q = _mm256_permute4x64_epi64(_mm256_packus_epi16(q, q), 0x08);
+        _mm_storeu_si128((__m128i*)(mag + x), _mm256_castsi256_si128(q));
+    }
+    mag_sse2(s + x, d + x, mag + x, n - x);
+}
+
+__attribute__((target("avx2")))
+static void grad_avx2(const int16_t* s, const int16_t* d, int16_t* gx, int16_t* gy, int32_t* sq, int n) {
+    int x = 0;
+    for (; x + 16 <= n; x += 16) {
+        __m256i vx, vy;
+        grad16_avx2(s, d, x, &vx, &vy);
+        _mm256_storeu_si256((__m256i*)(gx + x), vx);
+        _mm256_storeu_si256((__m256i*)(gy + x), vy);
+        __m256i lo = _mm256_unpacklo_epi16(vx, vy), hi = _mm256_unpackhi_epi16(vx, vy);
+        lo = _mm256_madd_epi16(lo, lo); // Columnas 0-3 y 8-11.
+        hi = _mm256_madd_epi16(hi, hi); // Columnas 4-7 y 12-15.
+        _mm256_storeu_si256((__m256i*)(sq + x), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i*)(sq + x + 8), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    grad_sse2(s + x, d + x, gx + x, gy + x, sq + x, n - x);
+}
+#endif
+
+typedef void (*VertFn)(const uint8_t*, const uint8_t*, const uint8_t*, int16_t*, int16_t*, int);
+typedef void (*MagFn)(const int16_t*, const int16_t*, uint8_t*, int);
+typedef void (*GradFn)(const int16_t*, const int16_t*, int16_t*, int16_t*, int32_t*, int);
+
+// --- DIRECCIN Y SUPRESIN DE NO MXIMOS ---
+// Direccin: el ngulo de (|Gx|, |Gy|) dentro del cuadrante sale de r = mn / mx (una divisin,
+// redondeada igual en todas las rutas) contando cuntos de los 32 cortes de cada octante supera;
+// despus se refleja segn el octante y los signos. Da el ngulo redondeado a pasos de 360 / 256
+// grados sin atan2, con el mismo resultado en la ruta escalar y en las vectorizadas.
+// NMS: el sector del gradiente sale de comparar |Gy| con |Gx| * tan(22.5) y con
+// |Gx| * tan(67.5) = |Gx| * (tan(22.5) + 2), en enteros de 32 bits; los vecinos se comparan
+// por Gx^2 + Gy^2, sin raz. Las filas de magnitud tienen un 0 antes y despus, y fuera de la
+// imagen se usa una fila de ceros, as ningn vecino necesita verificar lmites.
+
+// tan((j + 0.5) * 45 / 32 grados) en float: los cortes entre pasos de un octante.
+static const float dir_cuts[32] = {
+    0.0122724622f, 0.0368321799f, 0.0614363514f, 0.0861148536f, 0.110897914f, 0.135816276f, 0.160901368f, 0.186185405f,
+    0.211701617f, 0.237484455f, 0.263569653f, 0.289994627f, 0.316798538f, 0.344022602f, 0.37171042f, 0.399908185f,
+    0.428665102f, 0.458033681f, 0.48807022f, 0.518835247f, 0.550394058f, 0.582817376f, 0.61618191f, 0.650571346f,
+    0.686077058f, 0.722799242f, 0.760848165f, 0.800345421f, 0.841425896f, 0.884239197f, 0.928952456f, 0.975752652f,
+};
+
+// tan(22.5) en punto fijo de 15 bits.
+#define TAN22_Q15 13573
+
+static uint8_t dir_byte(int gx, int gy) {
+    int ax = gx < 0 ? -gx : gx, ay = gy < 0 ? -gy : gy;
+    if (ax == 0 && ay == 0) return 0;
+    float r = ay > ax ? (float)ax / (float)ay : (float)ay / (float)ax;
+    int t = 0;
+    for (int j = 0; j < 32; j++) t += r >= dir_cuts[j];
+    int k = ay > ax ? 64 - t : t;   // ngulo en el primer cuadrante: 0 a 64.
+    if (gx < 0) k = 128 - k;
+    if (gy < 0) k = 256 - k;
+    return (uint8_t)(k & 255);
+}
+
+// Fila y de la salida a partir de Gx y Gy de la fila y y de la magnitud al cuadrado de las filas
+// y - 1, y, y + 1 (con las columnas -1 y n en 0). Sin nms no se miran los vecinos.
+static void finish_scalar(const int16_t* gx, const int16_t* gy, const int32_t* up, const int32_t* mid,
+                          const int32_t* down, int n, int nms, uint8_t* mag, uint8_t* dir) {
+    for (int x = 0; x < n; x++) {
+        if (dir) dir[x] = dir_byte(gx[x], gy[x]);
+        int32_t m = mid[x];
+        if (nms) {
+            int ax = gx[x] < 0 ? -gx[x] : gx[x], ay = gy[x] < 0 ? -gy[x] : gy[x];
+            int32_t tg22 = ax * TAN22_Q15, yy = ay << 15;
+            int32_t a, b; // Vecinos a ambos lados en la direccin del gradiente.
+            if (yy < tg22) {                            // Casi horizontal: izquierda y derecha.
+                a = mid[x - 1];
+                b = mid[x + 1];
+            } else if (yy > tg22 + (ax << 16)) {        // Casi vertical: arriba y abajo.
+                a = up[x];
+                b = down[x];
+            } else {                                    // Diagonal: segn si los signos coinciden.
+                int s = (gx[x] ^ gy[x]) < 0 ? -1 : 1;
+                a = up[x - s];
+                b = down[x + s];
+            }
+            if (!(m > a && m >= b)) m = 0;
+        }
+        mag[x] = mag_from_sq(m);
+    }
+}
+
+#ifdef EDGES_X86
+// Seleccin por mscara sin blendv (SSE2): mask ? a : b.
+__attribute__((target("sse2")))
+static inline __m128i select_sse2(__m128i mask, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// Direccin de 4 columnas (Gx y Gy en 32 bits, ax y ay sus valores absolutos).
+__attribute__((target("sse2")))
+static inline __m128i dir4_sse2(__m128i gx, __m128i gy, __m128i ax, __m128i ay) {
+    __m128i steep = _mm_cmpgt_epi32(ay, ax);
+    __m128 lo = _mm_cvtepi32_ps(select_sse2(steep, ax, ay));
+    __m128 hi = _mm_cvtepi32_ps(select_sse2(steep, ay, ax));
+    __m128 r = _mm_div_ps(lo, hi); // 0 / 0 da NaN, que no supera ningn corte: Gx = Gy = 0 queda en 0.
+    __m128i t = _mm_setzero_si128();
+    for (int j = 0; j < 32; j++)
+        t = _mm_sub_epi32(t, _mm_castps_si128(_mm_cmpge_ps(r, _mm_set1_ps(dir_cuts[j]))));
+    __m128i k = select_sse2(steep, _mm_sub_epi32(_mm_set1_epi32(64), t), t);
+    k = select_sse2(_mm_srai_epi32(gx, 31), _mm_sub_epi32(_mm_set1_epi32(128), k), k);
+    k = select_sse2(_mm_srai_epi32(gy, 31), _mm_sub_epi32(_mm_set1_epi32(256), k), k);
+    return _mm_and_si128(k, _mm_set1_epi32(255));
+}
+
+// Magnitud al cuadrado de 4 columnas desde x despus de la supresin de no mximos.
+__attribute__((target("sse2")))
+static inline __m128i nms4_sse2(__m128i gx, __m128i gy, __m128i ax, __m128i ay, const int32_t* up,
+                                const int32_t* mid, const int32_t* down) {
+    // ax < 2^15: madd con (tan, 0) multiplica en 32 bits sin mullo_epi32.
+    __m128i tg22 = _mm_madd_epi16(ax, _mm_set1_epi32(TAN22_Q15));
+    __m128i yy = _mm_slli_epi32(ay, 15);
+    __m128i horiz = _mm_cmpgt_epi32(tg22, yy);
+    __m128i vert = _mm_cmpgt_epi32(yy, _mm_add_epi32(tg22, _mm_slli_epi32(ax, 16)));
+    __m128i neg = _mm_srai_epi32(_mm_xor_si128(gx, gy), 31); // Signos distintos: s = -1.
+    __m128i da = select_sse2(neg, _mm_loadu_si128((const __m128i*)(up + 1)), _mm_loadu_si128((const __m128i*)(up - 1)));
+    __m128i db = select_sse2(neg, _mm_loadu_si128((const __m128i*)(down - 1)), _mm_loadu_si128((const __m128i*)(down + 1)));
+    __m128i a = select_sse2(horiz, _mm_loadu_si128((const __m128i*)(mid - 1)),
+                            select_sse2(vert, _mm_loadu_si128((const __m128i*)up), da));
+    __m128i b = select_sse2(horiz, _mm_loadu_si128((const __m128i*)(mid + 1)),
+                            select_sse2(vert, _mm_loadu_si128((const __m128i*)down), db));
+    __m128i m = _mm_loadu_si128((const __m128i*)mid);
+    __m128i keep = _mm_andnot_si128(_mm_cmpgt_epi32(b, m), _mm_cmpgt_epi32(m, a));
+    return _mm_and_si128(m, keep);
+}
+
+// Extiende a 32 bits con signo y calcula el valor absoluto ((v ^ s) - s, sin abs_epi32).
+__attribute__((target("sse2")))
+static inline void widen4_sse2(__m128i v16, int high, __m128i* v, __m128i* av) {
+    *v = _mm_srai_epi32(high ? _mm_unpackhi_epi16(v16, v16) : _mm_unpacklo_epi16(v16, v16), 16);
+    __m128i sign = _mm_srai_epi32(*v, 31);
+    *av = _mm_sub_epi32(_mm_xor_si128(*v, sign), sign);
+}
+
+__attribute__((target("sse2")))
+static void finish_sse2(const int16_t* gx, const int16_t* gy, const int32_t* up, const int32_t* mid,
+                        const int32_t* down, int n, int nms, uint8_t* mag, uint8_t* dir) {
+    int x = 0;
+    for (; x + 8 <= n; x += 8) {
+        __m128i gx16 = _mm_loadu_si128((const __m128i*)(gx + x)), gy16 = _mm_loadu_si128((const __m128i*)(gy + x));
+        __m128i m[2], d[2];
+        for (int h = 0; h < 2; h++) {
+            __m128i vx, vy, ax, ay;
+            widen4_sse2(gx16, h, &vx, &ax);
+            widen4_sse2(gy16, h, &vy, &ay);
+            int c = x + 4 * h;
+            m[h] = nms ? nms4_sse2(vx, vy, ax, ay, up + c, mid + c, down + c)
+                       : _mm_loadu_si128((const __m128i*)(mid + c));
+            m[h] = magsq4_sse2(m[h]);
+            if (dir) d[h] = dir4_sse2(vx, vy, ax, ay);
+        }
+        __m128i q = _mm_packs_epi32(m[0], m[1]);
+        _mm_storel_epi64((__m128i*)(mag + x), _mm_packus_epi16(q, q));
+        if (dir) {
+            q = _mm_packs_epi32(d[0], d[1]);
+            _mm_storel_epi64((__m128i*)(dir + x), _mm_packus_epi16(q, q));
+        }
+    }
+    finish_scalar(gx + x, gy + x, up + x, mid + x, down + x, n - x, nms, mag + x, dir ? dir + x : NULL);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i dir8_avx2(__m256i gx, __m256i gy, __m256i ax, __m256i ay) {
+    __m256i steep = _mm256_cmpgt_epi32(ay, ax);
+    __m256 r = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_min_epi32(ax, ay)), _mm256_cvtepi32_ps(_mm256_max_epi32(ax, ay)));
+    __m256i t = _mm256_setzero_si256();
+    for (int j = 0; j < 32; j++)
+        t = _mm256_sub_epi32(t, _mm256_castps_si256(_mm256_cmp_ps(r, _mm256_set1_ps(dir_cuts[j]), _CMP_GE_OQ)));
+    __m256i k = _mm256_blendv_epi8(t, _mm256_sub_epi32(_mm256_set1_epi32(64), t), steep);
+    // blendv_epi8 mira el bit alto de cada byte: el signo se extiende a los 4 bytes con srai.
+    k = _mm256_blendv_epi8(k, _mm256_sub_epi32(_mm256_set1_epi32(128), k), _mm256_srai_epi32(gx, 31));
+    k = _mm256_blendv_epi8(k, _mm256_sub_epi32(_mm256_set1_epi32(256), k), _mm256_srai_epi32(gy, 31));
+    return _mm256_and_si256(k, _mm256_set1_epi32(255));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i nms8_avx2(__m256i gx, __m256i gy, __m256i ax, __m256i ay, const int32_t* up,
+                                const int32_t* mid, const int32_t* down) {
+    __m256i tg22 = _mm256_mullo_epi32(ax, _mm256_set1_epi32(TAN22_Q15));
+    __m256i yy = _mm256_slli_epi32(ay, 15);
+    __m256i horiz = _mm256_cmpgt_epi32(tg22, yy);
+    __m256i vert = _mm256_cmpgt_epi32(yy, _mm256_add_epi32(tg22, _mm256_slli_epi32(ax, 16)));
+    __m256i neg = _mm256_srai_epi32(_mm256_xor_si256(gx, gy), 31);
+    __m256i da = _mm256_blendv_epi8(_mm256_loadu_si256((const __m256i*)(up - 1)),
+                                    _mm256_loadu_si256((const __m256i*)(up + 1)), neg);
+    __m256i db = _mm256_blendv_epi8(_mm256_loadu_si256((const __m256i*)(down + 1)),
+                                    _mm256_loadu_si256((const __m256i*)(down - 1)), neg);
+    __m256i a = _mm256_blendv_epi8(_mm256_blendv_epi8(da, _mm256_loadu_si256((const __m256i*)up), vert),
+                                   _mm256_loadu_si256((const __m256i*)(mid - 1)), horiz);
+    __m256i b = _mm256_blendv_epi8(_mm256_blendv_epi8(db, _mm256_loadu_si256((const __m256i*)down), vert),
+                                   _mm256_loadu_si256((const __m256i*)(mid + 1)), horiz);
+    __m256i m = _mm256_loadu_si256((const __m256i*)mid);
+    __m256i keep = _mm256_andnot_si256(_mm256_cmpgt_epi32(b, m), _mm256_cmpgt_epi32(m, a));
+    return _mm256_and_si256(m, keep);
+}
+
+// Junta dos vectores de 8 enteros de 32 bits (columnas 0-7 y 8-15) en 16 bytes saturados.
+__attribute__((target("avx2")))
+static inline void store16_avx2(uint8_t* dst, __m256i v0, __m256i v1) {
+    __m256i q = _mm256_permute4x64_epi64(_mm256_packs_epi32(v0, v1), 0xD8);
+    q = _mm256_permute4x64_epi64(_mm256_packus_epi16(q, q), 0x08);
+    _mm_storeu_si128((__m128i*)dst, _mm256_castsi256_si128(q));
+}
+
+__attribute__((target("avx2")))
+static void finish_avx2(const int16_t* gx, const int16_t* gy, const int32_t* up, const int32_t* mid,
+                        const int32_t* down, int n, int nms, uint8_t* mag, uint8_t* dir) {
+    int x = 0;
+    for (; x + 16 <= n; x += 16) {
+        __m256i m[2], d[2];
+        for (int h = 0; h < 2; h++) {
+            int c = x + 8 * h;
+            __m256i vx = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(gx + c)));
+            __m256i vy = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(gy + c)));
+            __m256i ax = _mm256_abs_epi32(vx), ay = _mm256_abs_epi32(vy);
+            m[h] = nms ? nms8_avx2(vx, vy, ax, ay, up + c, mid + c, down + c)
+                       : _mm256_loadu_si256((const __m256i*)(mid + c));
+            m[h] = magsq8_avx2(m[h]);
+            if (dir) d[h] = dir8_avx2(vx, vy, ax, ay);
+        }
+        store16_avx2(mag + x, m[0], m[1]);
+        if (dir) store16_avx2(dir + x, d[0], d[1]);
+    }
+    finish_sse2(gx + x, gy + x, up + x, mid + x, down + x, n - x, nms, mag + x, dir ? dir + x : NULL);
+}
+#endif
+
+typedef void (*FinishFn)(const int16_t*, const int16_t*, const int32_t*, const int32_t*, const int32_t*, int, int,
+                         uint8_t*, uint8_t*);
+
+// --- BANDAS ---
+
+typedef struct {
+    const GrayImage* src;  // Entrada en grises, o NULL si es la vista a color.
+    BgrView view;
+    int width, height;
+    GrayImage* mag;
+    GrayImage* dir;
+    int nms;
+    int failed;            // Solo se escribe 1: no hace falta sincronizar entre bandas.
+} EdgeJob;
+
+static void edges_band(void* ctx, int y0, int y1) {
+    EdgeJob* job = (EdgeJob*)ctx;
+    const int w = job->width, h = job->height;
+    const int halo = 1 + (job->nms != 0); // Filas de entrada de ms a cada lado.
+    const int grad = job->nms || job->dir; // Hace falta Gx, Gy y la magnitud sin redondear.
+    VertFn vert = vert_scalar;
+    MagFn magf = mag_scalar;
+    GradFn gradf = grad_scalar;
+    FinishFn finish = finish_scalar;
+#ifdef EDGES_X86
+    int level = filters_simd_level();
+    if (level >= 2) {
+        vert = vert_avx2;
+        magf = mag_avx2;
+        gradf = grad_avx2;
+        finish = finish_avx2;
+    } else if (level >= 1) {
+        vert = vert_sse2;
+        magf = mag_sse2;
+        gradf = grad_sse2;
+        finish = finish_sse2;
+    }
+#endif
+
+    // Filas de entrada: las de la imagen de grises o la luminancia de la banda y su halo.
+    GrayImage src = { 0 };
+    int base = 0; // Fila de la imagen que corresponde a la fila 0 de src.
+    if (job->src) {
+        src = *job->src;
+    } else {
+        int ly0 = y0 - halo > 0 ? y0 - halo : 0, ly1 = y1 + halo < h ? y1 + halo : h;
+        if (!gray_image_alloc(&src, w, ly1 - ly0)) { job->failed = 1; return; }
+        BgrView band = bgr_view_roi(&job->view, 0, ly0, w, ly1 - ly0);
+        to_grayscale_view(&band, &src);
+        base = ly0;
+    }
+
+    const size_t n2 = (size_t)w + 2;
+    int16_t* s = (int16_t*)malloc(sizeof(int16_t) * 2 * n2);
+    int16_t* gxy = grad ? (int16_t*)malloc(sizeof(int16_t) * 6 * (size_t)w) : NULL; // [fila % 3][gx | gy][x]
+    // [fila % 3][-1 .. w] con las columnas -1 y w en 0, y una cuarta fila de ceros.
+    int32_t* sq = grad ? (int32_t*)calloc(4 * n2, sizeof(int32_t)) : NULL;
+    if (!s || (grad && (!gxy || !sq))) {
+        job->failed = 1;
+        free(s); free(gxy); free(sq);
+        if (!job->src) gray_image_free(&src);
+        return;
+    }
+    int16_t* d = s + n2;
+
+    int next = job->nms && y0 > 0 ? y0 - 1 : y0; // Prxima fila de gradiente a calcular.
+    for (int y = y0; y < y1; y++) {
+        int last = job->nms && y + 1 < h ? y + 1 : y; // Con nms hace falta tambin la fila de abajo.
+        for (; next <= last; next++) {
+            // Pasada vertical de la fila next, repitiendo la primera o la ltima fila.
+            const uint8_t* a = gray_image_row(&src, (next > 0 ? next - 1 : 0) - base);
+            const uint8_t* b = gray_image_row(&src, next - base);
+            const uint8_t* c = gray_image_row(&src, (next + 1 < h ? next + 1 : h - 1) - base);
+            vert(a, b, c, s + 1, d + 1, w);
+            s[0] = s[1];
+            s[w + 1] = s[w];
+            d[0] = d[1];
+            d[w + 1] = d[w];
+            if (!grad) {
+                magf(s + 1, d + 1, gray_image_row(job->mag, next), w);
+            } else {
+                size_t slot = (size_t)(next % 3) * w;
+                gradf(s + 1, d + 1, gxy + 2 * slot, gxy + 2 * slot + w, sq + (size_t)(next % 3) * n2 + 1, w);
+            }
+        }
+        if (!grad) continue;
+        size_t slot = (size_t)(y % 3) * w;
+        const int32_t* zero = sq + 3 * n2 + 1;
+        const int32_t* up = job->nms && y > 0 ? sq + (size_t)((y - 1) % 3) * n2 + 1 : zero;
+        const int32_t* down = job->nms && y + 1 < h ? sq + (size_t)((y + 1) % 3) * n2 + 1 : zero;
+        finish(gxy + 2 * slot, gxy + 2 * slot + w, up, sq + (size_t)(y % 3) * n2 + 1, down, w, job->nms,
+               gray_image_row(job->mag, y), job->dir ? gray_image_row(job->dir, y) : NULL);
+    }
+
+    free(s);
+    free(gxy);
+    free(sq);
+    if (!job->src) gray_image_free(&src);
+}
+
+static int edges_run(EdgeJob* job, int y0, int y1) {
+    if (job->width <= 0 || y1 <= y0) return 1;
+    // Por fila: la entrada, S y D, y con nms o direccin el anillo de Gx, Gy y magnitud.
+    size_t row_bytes = (size_t)job->width * (job->nms || job->dir ? 16 : 6);
+    int band = parallel_band_rows(y1 - y0, row_bytes);
+    if (band < 8) band = 8; // Cada banda recalcula hasta 2 filas de halo.
+    parallel_rows_range(y0, y1, band, edges_band, job);
+    return !job->failed;
+}
+
+// --- FUNCIN sobel_edges ---
+int sobel_edges(const GrayImage* src, GrayImage* mag, GrayImage* dir, int nms) {
+    return sobel_edges_rows(src, mag, dir, nms, 0, src->height);
+}
+
+int sobel_edges_rows(const GrayImage* src, GrayImage* mag, GrayImage* dir, int nms, int y0, int y1) {
+    EdgeJob job = { src, { NULL, 0, 0, 0 }, src->width, src->height, mag, dir, nms, 0 };
+    return edges_run(&job, y0, y1);
+}
+
+// --- FUNCIN sobel_edges_view ---
+int sobel_edges_view(const BgrView* src, GrayImage* mag, GrayImage* dir, int nms) {
+    return sobel_edges_view_rows(src, mag, dir, nms, 0, src->height);
+}
+
+int sobel_edges_view_rows(const BgrView* src, GrayImage* mag, GrayImage* dir, int nms, int y0, int y1) {
+    EdgeJob job = { NULL, *src, src->width, src->height, mag, dir, nms, 0 };
+    return edges_run(&job, y0, y1);
+}
@@ -0,0 +1,29 @@
+// edges.h
+// Detector de bordes Sobel fusionado: Gx, Gy, magnitud y direccin del gradiente en una sola
+// pasada por la imagen, con intermedios de 16 bits que conservan el signo de cada derivada y
+// supresin de no mximos opcional para dejar bordes de un pxel de ancho.
+#ifndef EDGES_H
+#define EDGES_H
+
+#include "bmp.h"
+
+// Calcula los bordes de src en mag (mismo tamao, ya reservada):
+//   mag = round(sqrt(Gx^2 + Gy^2) / 4) saturado a 255, as un escaln de 0 a 255 da 255.
+//   dir (opcional, NULL si no hace falta) = ngulo del gradiente en [0, 360) grados llevado a
+//   [0, 256) y redondeado al paso ms cercano: 0 = ms claro hacia la derecha, 64 = hacia abajo,
+//   128 = a la izquierda, 192 = hacia arriba. Donde no hay gradiente queda 0.
+// Con nms != 0 solo sobreviven los pxeles cuya magnitud es mxima entre sus dos vecinos en la
+// direccin del gradiente (redondeada a 0, 45, 90 o 135 grados); el resto queda en 0.
+// En los bordes de la imagen se repite la fila o la columna ms cercana.
+// Devuelve 1 si tuvo xito, 0 si falta memoria.
+int sobel_edges(const GrayImage* src, GrayImage* mag, GrayImage* dir, int nms);
+
+// Igual, pero solo escribe las filas [y0, y1) de mag y dir.
+int sobel_edges_rows(const GrayImage* src, GrayImage* mag, GrayImage* dir, int nms, int y0, int y1);
+
+// Versiones que leen una vista a color: cada banda calcula la luminancia de sus filas (y de las
+// de halo) al vuelo, sin una imagen de grises intermedia completa.
+int sobel_edges_view(const BgrView* src, GrayImage* mag, GrayImage* dir, int nms);
+int sobel_edges_view_rows(const BgrView* src, GrayImage* mag, GrayImage* dir, int nms, int y0, int y1);
+
+#endif
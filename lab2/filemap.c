@@ -0,0 +1,91 @@
+// filemap.c
+// Proyeccin de archivos en memoria: MapViewOfFile en Windows, mmap en el resto. Tambin la
+// identidad de archivos y el reemplazo de un archivo por otro.
+
+#include "filemap.h"
+#ifdef _WIN32
+#include <windows.h>    // Para CreateFileA, CreateFileMappingA, MapViewOfFile, MoveFileExA
+#else
+#include <fcntl.h>      // Para open
+#include <sys/mman.h>   // Para mmap, munmap
+#include <stdio.h>      // Para rename
+#include <sys/stat.h>   // Para fstat, stat
+#include <unistd.h>     // Para close
+#endif
+
+int file_map_readonly(const char* path, const void** base, size_t* size) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) return 0;
+    LARGE_INTEGER len;
+    if (!GetFileSizeEx(file, &len) || len.QuadPart <= 0 || (unsigned long long)len.QuadPart > (size_t)-1) {
+        CloseHandle(file);
+        return 0;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    void* p = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    // La vista mantiene vivo el archivo; los handles ya no hacen falta.
+    if (mapping) CloseHandle(mapping);
+    CloseHandle(file);
+    if (p == NULL) return 0;
+    *base = p;
+    *size = (size_t)len.QuadPart;
+    return 1;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0 || (unsigned long long)st.st_size > (size_t)-1) {
+        close(fd);
+        return 0;
+    }
+    void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // La proyeccin sigue vlida despus de cerrar el descriptor.
+    if (p == MAP_FAILED) return 0;
+    *base = p;
+    *size = (size_t)st.st_size;
+    return 1;
+#endif
+}
+
+void file_unmap(const void* base, size_t size) {
+#ifdef _WIN32
+    (void)size;
+    UnmapViewOfFile(base);
+#else
+    munmap((void*)base, size);
+#endif
+}
+
+#ifdef _WIN32
+// Identifica el archivo por volumen e ndice (el equivalente de st_dev y st_ino).
+static int file_id(const char* path, BY_HANDLE_FILE_INFORMATION* info) {
+    HANDLE file = CreateFileA(path, 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return 0;
+    int ok = GetFileInformationByHandle(file, info) != 0;
+    CloseHandle(file);
+    return ok;
+}
+#endif
+
+int file_same(const char* a, const char* b) {
+#ifdef _WIN32
+    BY_HANDLE_FILE_INFORMATION ia, ib;
+    return file_id(a, &ia) && file_id(b, &ib) && ia.dwVolumeSerialNumber == ib.dwVolumeSerialNumber
+        && ia.nFileIndexHigh == ib.nFileIndexHigh && ia.nFileIndexLow == ib.nFileIndexLow;
+#else
+    struct stat sa, sb;
+    return stat(a, &sa) == 0 && stat(b, &sb) == 0 && sa.st_dev == sb.st_dev && sa.st_ino == sb.st_ino;
+#endif
+}
+
+int file_replace(const char* tmp_path, const char* path) {
+#ifdef _WIN32
+    // rename no reemplaza un archivo existente en Windows; borrarlo antes dejara un momento sin destino.
+    return MoveFileExA(tmp_path, path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(tmp_path, path) == 0;
+#endif
+}
@@ -0,0 +1,28 @@
+// filemap.h
+// Proyeccin en memoria (mmap) de archivos de solo lectura y otras operaciones sobre archivos que
+// dependen del sistema, con la misma interfaz en Windows y POSIX.
+// Va en un mdulo aparte porque <windows.h> define sus propias estructuras BITMAPFILEHEADER e
+// BITMAPINFOHEADER, que chocaran con las de bmp.h.
+#ifndef FILEMAP_H
+#define FILEMAP_H
+
+#include <stddef.h>     // Para size_t
+
+// Proyecta el archivo completo en memoria de solo lectura. Devuelve 1 si tuvo xito y deja en
+// *base el inicio del archivo y en *size su tamao; 0 si no se pudo (archivo vaco, sin permisos,
+// o el sistema no admite la proyeccin).
+int file_map_readonly(const char* path, const void** base, size_t* size);
+
+// Deshace una proyeccin hecha con file_map_readonly.
+void file_unmap(const void* base, size_t size);
+
+// Devuelve 1 si las dos rutas existen y son el mismo archivo (aunque se escriban distinto, por
+// ejemplo "a.bmp" y "./a.bmp"), 0 si no.
+int file_same(const char* a, const char* b);
+
+// Reemplaza path por tmp_path (que desaparece). Con rename en POSIX y MoveFileExA en Windows el
+// destino no deja de existir en ningn momento; en Windows falla si path est proyectado o abierto.
+// Devuelve 1 si tuvo xito.
+int file_replace(const char* tmp_path, const char* path);
+
+#endif
@@ -0,0 +1,1077 @@
+// filters.c
+// Filtros de imagen del laboratorio: conversin a escala de grises y convolucin 3x3.
+
+#include "filters.h"
+#include "parallel.h"
+#include <stdlib.h>     // Para size_t, getenv
+#include <string.h>     // Para memcpy, strcmp
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FILTERS_X86 1
+#include <immintrin.h>  // Intrnsecos SSE2/AVX2 (habilitados por funcin con __attribute__((target)))
+#endif
+
+// --- CONVERSIN A GRISES VECTORIZADA ---
+// La frmula de referencia es gray = (299*R + 587*G + 114*B) / 1000. La divisin entera por 1000
+// se reemplaza por punto fijo: para todo x en [0, 255000] (rango posible de la suma ponderada)
+// se cumple floor(x / 1000) == ((x >> 3) * 33555) >> 22, verificado de forma exhaustiva.
+// Como el resultado nunca supera 255, tampoco hace falta clampi. As el kernel vectorizado
+// produce exactamente los mismos bytes que la frmula original.
+#define GRAY_WR 299
+#define GRAY_WG 587
+#define GRAY_WB 114
+#define GRAY_DIV_MUL 33555
+#define GRAY_DIV_SHIFT 22
+
+// Gris de un pxel en punto fijo (misma salida que la frmula con divisin).
+static inline uint8_t gray_fixed(const BGR* p) {
+    uint32_t x = p->r * GRAY_WR + p->g * GRAY_WG + p->b * GRAY_WB; // Suma ponderada, mximo 255000.
+    return (uint8_t)(((x >> 3) * GRAY_DIV_MUL) >> GRAY_DIV_SHIFT);  // floor(x / 1000) sin dividir.
+}
+
+// Todas las versiones escriben el resultado en plane (un byte por pxel) si no es NULL, o
+// replicado en los tres canales de dst si plane es NULL. src y dst pueden ser el mismo buffer.
+
+// Versin portable: un pxel por iteracin.
+static void gray_row_scalar(const BGR* src, BGR* dst, uint8_t* plane, size_t n) {
+    if (plane) {
+        for (size_t i = 0; i < n; i++) plane[i] = gray_fixed(&src[i]);
+        return;
+    }
+    for (size_t i = 0; i < n; i++) {
+        uint8_t g = gray_fixed(&src[i]);
+        dst[i].b = g;
+        dst[i].g = g;
+        dst[i].r = g;
+    }
+}
+
+#ifdef FILTERS_X86
+// Lee 4 bytes sin requerir alineacin (el 4 byte es el azul del pxel siguiente y se descarta).
+static inline int load32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return (int)v;
+}
+
+// Versin SSE2: 8 pxeles por iteracin. Cada pxel se carga en un entero de 32 bits
+// [b g r x]; con mscaras se separan los pares (b, r) y (g, x) en mitades de 16 bits y
+// _mm_madd_epi16 calcula 114*b + 299*r y 587*g en una sola instruccin cada una.
+// La divisin se hace en 16 bits con _mm_mulhi_epu16 (y * 33555) >> 16 y un desplazamiento de 6.
+__attribute__((target("sse2")))
+static void gray_row_sse2(const BGR* src, BGR* dst, uint8_t* plane, size_t n) {
+    const uint8_t* s = (const uint8_t*)src;
+    uint8_t* d = (uint8_t*)dst;
+    const __m128i mask = _mm_set1_epi32(0x00FF00FF);                 // Deja los bytes 0 y 2 de cada entero.
+    const __m128i w_br = _mm_set1_epi32((GRAY_WR << 16) | GRAY_WB);  // Pesos para el par (b, r).
+    const __m128i w_g  = _mm_set1_epi32(GRAY_WG);                    // Pesos para el par (g, x): x pesa 0.
+    const __m128i mul  = _mm_set1_epi16((short)GRAY_DIV_MUL);
+    size_t i = 0;
+    // Se exige i + 9 <= n porque la ltima carga de 32 bits toca el primer byte del pxel i + 8.
+    for (; i + 9 <= n; i += 8) {
+        const uint8_t* p = s + 3 * i;
+        __m128i a = _mm_set_epi32(load32(p + 9), load32(p + 6), load32(p + 3), load32(p));
+        __m128i b = _mm_set_epi32(load32(p + 21), load32(p + 18), load32(p + 15), load32(p + 12));
+        __m128i xa = _mm_add_epi32(_mm_madd_epi16(_mm_and_si128(a, mask), w_br),
+                                   _mm_madd_epi16(_mm_and_si128(_mm_srli_epi32(a, 8), mask), w_g));
+        __m128i xb = _mm_add_epi32(_mm_madd_epi16(_mm_and_si128(b, mask), w_br),
+                                   _mm_madd_epi16(_mm_and_si128(_mm_srli_epi32(b, 8), mask), w_g));
+        // x >> 3 <= 31875 entra en 16 bits con signo: se empaquetan los 8 valores en un registro.
+        __m128i y = _mm_packs_epi32(_mm_srli_epi32(xa, 3), _mm_srli_epi32(xb, 3));
+        __m128i q = _mm_srli_epi16(_mm_mulhi_epu16(y, mul), GRAY_DIV_SHIFT - 16);
+        __m128i g8 = _mm_packus_epi16(q, q);
+        if (plane) {
+            _mm_storel_epi64((__m128i*)(plane + i), g8); // Plano: 8 bytes de una vez.
+            continue;
+        }
+        uint8_t g[16];
+        _mm_storeu_si128((__m128i*)g, g8);
+        // Escribe los 24 bytes de salida: cada gris se replica en b, g, r con una escritura de 4 bytes
+        // que pisa el azul del pxel siguiente (corregido en la prxima escritura). El ltimo pxel se
+        // escribe byte a byte para no tocar el pxel i + 8, que todava no se ley si src == dst.
+        for (int j = 0; j < 7; j++) {
+            uint32_t t = g[j] * 0x010101u;
+            memcpy(d + 3 * (i + j), &t, 4);
+        }
+        d[3 * (i + 7)] = d[3 * (i + 7) + 1] = d[3 * (i + 7) + 2] = g[7];
+    }
+    gray_row_scalar(src + i, dst + i, plane ? plane + i : NULL, n - i); // Pxeles restantes.
+}
+
+// Versin AVX2: 8 pxeles por iteracin en un registro de 256 bits. Cada mitad de 128 bits
+// recibe 4 pxeles (12 bytes) y vpshufb los separa en enteros de 32 bits [b g r 0]. El resultado
+// se replica a [g g g 0], vpshufb lo compacta a 12 bytes por mitad y se escribe en bloque.
+__attribute__((target("avx2")))
+static void gray_row_avx2(const BGR* src, BGR* dst, uint8_t* plane, size_t n) {
+    const uint8_t* s = (const uint8_t*)src;
+    uint8_t* d = (uint8_t*)dst;
+    const __m256i spread = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                                            0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m256i pack = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                          0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const __m256i mask = _mm256_set1_epi32(0x00FF00FF);
+    const __m256i w_br = _mm256_set1_epi32((GRAY_WR << 16) | GRAY_WB);
+    const __m256i w_g  = _mm256_set1_epi32(GRAY_WG);
+    const __m256i mul  = _mm256_set1_epi32(GRAY_DIV_MUL);
+    const __m256i rep  = _mm256_set1_epi32(0x010101);
+    const __m256i low  = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                          0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    size_t i = 0;
+    // La segunda carga de 16 bytes empieza en el pxel i + 4 y llega al primer byte del pxel i + 9.
+    for (; i + 10 <= n; i += 8) {
+        const uint8_t* p = s + 3 * i;
+        __m128i lo = _mm_loadu_si128((const __m128i*)p);
+        __m128i hi = _mm_loadu_si128((const __m128i*)(p + 12));
+        __m256i v = _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1), spread);
+        __m256i x = _mm256_add_epi32(_mm256_madd_epi16(_mm256_and_si256(v, mask), w_br),
+                                     _mm256_madd_epi16(_mm256_and_si256(_mm256_srli_epi32(v, 8), mask), w_g));
+        __m256i q = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(x, 3), mul), GRAY_DIV_SHIFT);
+        if (plane) {
+            // Plano: toma el byte bajo de cada entero, 4 por mitad, y los escribe juntos.
+            __m256i g4 = _mm256_shuffle_epi8(q, low);
+            int t0 = _mm_cvtsi128_si32(_mm256_castsi256_si128(g4));
+            int t1 = _mm_cvtsi128_si32(_mm256_extracti128_si256(g4, 1));
+            memcpy(plane + i, &t0, 4);
+            memcpy(plane + i + 4, &t1, 4);
+            continue;
+        }
+        __m256i out = _mm256_shuffle_epi8(_mm256_mullo_epi32(q, rep), pack);
+        __m128i out_lo = _mm256_castsi256_si128(out);
+        __m128i out_hi = _mm256_extracti128_si256(out, 1);
+        _mm_storel_epi64((__m128i*)(d + 3 * i), out_lo);
+        int t;
+        t = _mm_cvtsi128_si32(_mm_srli_si128(out_lo, 8));
+        memcpy(d + 3 * i + 8, &t, 4);
+        _mm_storel_epi64((__m128i*)(d + 3 * i + 12), out_hi);
+        t = _mm_cvtsi128_si32(_mm_srli_si128(out_hi, 8));
+        memcpy(d + 3 * i + 20, &t, 4);
+    }
+    gray_row_scalar(src + i, dst + i, plane ? plane + i : NULL, n - i);
+}
+#endif
+
+// --- GRISES DESDE BGRA ---
+// Con pxeles de 4 bytes cada entero de 32 bits ya es [b g r a]: las mismas cuentas que arriba sin
+// reordenar bytes (el alfa queda en la mitad alta del par (g, a), que pesa 0).
+
+static void gray_bgra_row_scalar(const BGRA* src, uint8_t* plane, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        uint32_t x = src[i].r * GRAY_WR + src[i].g * GRAY_WG + src[i].b * GRAY_WB;
+        plane[i] = (uint8_t)(((x >> 3) * GRAY_DIV_MUL) >> GRAY_DIV_SHIFT);
+    }
+}
+
+#ifdef FILTERS_X86
+__attribute__((target("sse2")))
+static void gray_bgra_row_sse2(const BGRA* src, uint8_t* plane, size_t n) {
+    const __m128i mask = _mm_set1_epi32(0x00FF00FF);
+    const __m128i w_br = _mm_set1_epi32((GRAY_WR << 16) | GRAY_WB);
+    const __m128i w_g  = _mm_set1_epi32(GRAY_WG);
+    const __m128i mul  = _mm_set1_epi16((short)GRAY_DIV_MUL);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + i + 4));
+        __m128i xa = _mm_add_epi32(_mm_madd_epi16(_mm_and_si128(a, mask), w_br),
+                                   _mm_madd_epi16(_mm_and_si128(_mm_srli_epi32(a, 8), mask), w_g));
+        __m128i xb = _mm_add_epi32(_mm_madd_epi16(_mm_and_si128(b, mask), w_br),
+                                   _mm_madd_epi16(_mm_and_si128(_mm_srli_epi32(b, 8), mask), w_g));
+        __m128i y = _mm_packs_epi32(_mm_srli_epi32(xa, 3), _mm_srli_epi32(xb, 3));
+        __m128i q = _mm_srli_epi16(_mm_mulhi_epu16(y, mul), GRAY_DIV_SHIFT - 16);
+        _mm_storel_epi64((__m128i*)(plane + i), _mm_packus_epi16(q, q));
+    }
+    gray_bgra_row_scalar(src + i, plane + i, n - i);
+}
+
+// 16 pxeles por iteracin: dos registros de 8 se empaquetan a 16 bits y luego a bytes.
+__attribute__((target("avx2")))
+static void gray_bgra_row_avx2(const BGRA* src, uint8_t* plane, size_t n) {
+    const __m256i mask = _mm256_set1_epi32(0x00FF00FF);
+    const __m256i w_br = _mm256_set1_epi32((GRAY_WR << 16) | GRAY_WB);
+    const __m256i w_g  = _mm256_set1_epi32(GRAY_WG);
+    const __m256i mul  = _mm256_set1_epi16((short)GRAY_DIV_MUL);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(src + i + 8));
+        __m256i xa = _mm256_add_epi32(_mm256_madd_epi16(_mm256_and_si256(a, mask), w_br),
+                                      _mm256_madd_epi16(_mm256_and_si256(_mm256_srli_epi32(a, 8), mask), w_g));
+        __m256i xb = _mm256_add_epi32(_mm256_madd_epi16(_mm256_and_si256(b, mask), w_br),
+                                      _mm256_madd_epi16(_mm256_and_si256(_mm256_srli_epi32(b, 8), mask), w_g));
+        __m256i y = _mm256_packs_epi32(_mm256_srli_epi32(xa, 3), _mm256_srli_epi32(xb, 3));
+        // packs trabaja por mitades: y = [a0..a3 b0..b3 | a4..a7 b4..b7] (a = pxeles i..i+7,
+        // b = i+8..i+15). El permute deja [a0..a7 | b0..b7] y packus junta las dos mitades.
+        __m256i q = _mm256_permute4x64_epi64(_mm256_srli_epi16(_mm256_mulhi_epu16(y, mul), GRAY_DIV_SHIFT - 16), 0xD8);
+        _mm_storeu_si128((__m128i*)(plane + i),
+                         _mm_packus_epi16(_mm256_castsi256_si128(q), _mm256_extracti128_si256(q, 1)));
+    }
+    gray_bgra_row_sse2(src + i, plane + i, n - i);
+}
+#endif
+
+// Kernels elegidos en tiempo de ejecucin segn la CPU (o la variable de entorno LAB2_SIMD).
+typedef void (*GrayRowFn)(const BGR* src, BGR* dst, uint8_t* plane, size_t n);
+static GrayRowFn gray_row = NULL;
+typedef void (*GrayBgraRowFn)(const BGRA* src, uint8_t* plane, size_t n);
+static GrayBgraRowFn gray_bgra_row = gray_bgra_row_scalar;
+static const char* gray_path = "escalar";
+static int simd_level = 0; // 0 = escalar, 1 = SSE2, 2 = AVX2.
+
+// Elige la mejor versin disponible hasta max_level (0 = escalar, 1 = SSE2, 2 = AVX2).
+static void select_kernels_up_to(int max_level) {
+    gray_row = gray_row_scalar;
+    gray_bgra_row = gray_bgra_row_scalar;
+    gray_path = "escalar";
+    simd_level = 0;
+#ifdef FILTERS_X86
+    __builtin_cpu_init();
+    if (max_level >= 2 && __builtin_cpu_supports("avx2")) {
+        gray_row = gray_row_avx2;
+        gray_bgra_row = gray_bgra_row_avx2;
+        gray_path = "AVX2";
+        simd_level = 2;
+    } else if (max_level >= 1 && __builtin_cpu_supports("sse2")) {
+        gray_row = gray_row_sse2;
+        gray_bgra_row = gray_bgra_row_sse2;
+        gray_path = "SSE2";
+        simd_level = 1;
+    }
+#else
+    (void)max_level;
+#endif
+}
+
+// LAB2_SIMD=scalar|sse2|avx2 fuerza una ruta (til para comparar).
+static void select_kernels(void) {
+    const char* forced = getenv("LAB2_SIMD");
+    int max_level = 2;
+    if (forced && strcmp(forced, "scalar") == 0) max_level = 0;
+    else if (forced && strcmp(forced, "sse2") == 0) max_level = 1;
+    select_kernels_up_to(max_level);
+}
+
+int filters_set_simd_level(int level) {
+    if (level < 0) select_kernels();
+    else select_kernels_up_to(level);
+    return simd_level;
+}
+
+const char* filters_simd_path(void) {
+    if (!gray_row) select_kernels();
+    return gray_path;
+}
+
+int filters_simd_level(void) {
+    if (!gray_row) select_kernels();
+    return simd_level;
+}
+
+// Datos de una conversin a grises por bandas. Si out no es NULL el resultado va a esa imagen y
+// la entrada es la vista src; si no, se convierte en sitio el buffer contiguo pixels.
+typedef struct {
+    BGR* pixels;
+    BgrView src;
+    const GrayImage* out;
+    int width;
+} GrayJob;
+
+static void gray_band(void* ctx, int y0, int y1) {
+    GrayJob* job = (GrayJob*)ctx;
+    size_t first = (size_t)y0 * job->width;
+    if (!job->out) {
+        BGR* p = job->pixels + first;
+        gray_row(p, p, NULL, (size_t)(y1 - y0) * job->width);
+    } else if (job->src.stride == (ptrdiff_t)job->width * (ptrdiff_t)sizeof(BGR) && gray_image_is_packed(job->out)) {
+        // Filas contiguas y sin padding: la banda entera es una sola tira de pxeles.
+        const BGR* p = bgr_view_row(&job->src, y0);
+        gray_row(p, (BGR*)p, gray_image_row(job->out, y0), (size_t)(y1 - y0) * job->width);
+    } else {
+        for (int y = y0; y < y1; y++) {
+            const BGR* p = bgr_view_row(&job->src, y);
+            gray_row(p, (BGR*)p, gray_image_row(job->out, y), (size_t)job->width);
+        }
+    }
+}
+
+// --- FUNCIN to_grayscale ---
+// Convierte una imagen de color a escala de grises, modificando el buffer recibido.
+// El valor de gris se calcula usando la luminancia perceptual del ojo humano
+// (0.299*R + 0.587*G + 0.114*B), con el kernel vectorizado que corresponda a la CPU,
+// repartiendo bandas de filas entre los hilos del motor paralelo.
+// Parmetros:
+//   pixels -> buffer de pxeles (modificado en sitio).
+//   width  -> ancho de la imagen en pxeles.
+//   height -> alto de la imagen en pxeles.
+void to_grayscale(BGR* pixels, int width, int height) {
+    if (!gray_row) select_kernels();
+    if (width <= 0 || height <= 0) return;
+    GrayJob job = { pixels, bgr_view_packed(pixels, width, height), NULL, width };
+    parallel_rows(height, parallel_band_rows(height, (size_t)width * sizeof(BGR)), gray_band, &job);
+}
+
+// --- FUNCIN to_grayscale_plane ---
+// Igual que to_grayscale, pero deja el resultado en una imagen de grises planar (1 byte por
+// pxel) sin modificar la imagen de color.
+// Parmetros:
+//   pixels -> buffer de pxeles BGR de entrada.
+//   width  -> ancho de la imagen en pxeles.
+//   height -> alto de la imagen en pxeles.
+//   out    -> imagen de grises ya reservada con gray_image_alloc(out, width, height).
+void to_grayscale_plane(const BGR* pixels, int width, int height, GrayImage* out) {
+    BgrView src = bgr_view_packed(pixels, width, height);
+    to_grayscale_view(&src, out);
+}
+
+// --- FUNCIN to_grayscale_view ---
+// Conversin a grises desde una vista con stride (por ejemplo un BMP proyectado en memoria, con
+// padding y quizs bottom-up, o una regin de inters) hacia una imagen planar del mismo tamao,
+// que tambin puede ser una regin de otra. Lee la vista sin copiarla.
+void to_grayscale_view(const BgrView* src, GrayImage* out) {
+    if (!gray_row) select_kernels();
+    if (src->width <= 0 || src->height <= 0) return;
+    // El kernel no escribe en la entrada cuando recibe un plano, as que quitar const es seguro.
+    GrayJob job = { NULL, *src, out, src->width };
+    parallel_rows(src->height, parallel_band_rows(src->height, (size_t)src->width * sizeof(BGR)), gray_band, &job);
+}
+
+typedef struct {
+    const BGRA* pixels;
+    const GrayImage* out;
+    int width;
+} GrayBgraJob;
+
+static void gray_bgra_band(void* ctx, int y0, int y1) {
+    GrayBgraJob* job = (GrayBgraJob*)ctx;
+    if (gray_image_is_packed(job->out)) {
+        size_t first = (size_t)y0 * job->width;
+        gray_bgra_row(job->pixels + first, gray_image_row(job->out, y0), (size_t)(y1 - y0) * job->width);
+        return;
+    }
+    for (int y = y0; y < y1; y++)
+        gray_bgra_row(job->pixels + (size_t)y * job->width, gray_image_row(job->out, y), (size_t)job->width);
+}
+
+// --- FUNCIN to_grayscale_bgra ---
+// Conversin a grises desde una imagen BGRA contigua (load_bmp32) hacia una imagen planar del
+// mismo tamao. Mismo resultado que to_grayscale_plane; el alfa no interviene.
+void to_grayscale_bgra(const BGRA* pixels, int width, int height, GrayImage* out) {
+    if (!gray_row) select_kernels();
+    if (width <= 0 || height <= 0) return;
+    GrayBgraJob job = { pixels, out, width };
+    parallel_rows(height, parallel_band_rows(height, (size_t)width * sizeof(BGRA)), gray_bgra_band, &job);
+}
+
+// --- CONVOLUCIN 3x3 RPIDA ---
+// La imagen se separa en interior (todos los vecinos existen, sin verificar lmites) y borde
+// (primera/ltima fila y columna, con la verificacin original). El interior se calcula sobre un
+// plano empaquetado de 8 bits (un byte por pxel, el canal r) en lugar de saltar de 3 en 3 bytes.
+// Si el kernel es separable (k = columna x fila, como blur o Sobel) se aplica en dos pasadas 1D:
+// 3 + 3 multiplicaciones por pxel en vez de 9. Todo en aritmtica entera, por lo que la suma es
+// idntica a la de la versin original.
+// Cuando 255 * sum|k| cabe en 16 bits (todos los kernels de ejemplo), el interior usa SSE2 con
+// acumuladores de 16 bits; la divisin por el divisor se hace en float, que es exacta al truncar
+// porque |suma| < 2^24 (el error de redondeo queda por debajo de 1/|divisor|).
+
+// Parmetros comunes de normalizacin: resultado = clampi(suma / divisor + offset).
+typedef struct {
+    int divisor;
+    int offset;
+} ConvNorm;
+
+// Valor de un pxel del borde: igual que la versin original, solo suma los vecinos existentes.
+// rows[0..2] son las filas y - 1, y, y + 1 del plano (NULL si quedan fuera de la imagen).
+static uint8_t conv_border_pixel(const uint8_t* const rows[3], int width, int x,
+                                 const int k[3][3], ConvNorm norm) {
+    int suma = 0;
+    for (int ky = 0; ky < 3; ky++) {
+        if (!rows[ky]) continue;
+        for (int kx = -1; kx <= 1; kx++) {
+            int px = x + kx;
+            if (px >= 0 && px < width) {
+                suma += rows[ky][px] * k[ky][kx + 1];
+            }
+        }
+    }
+    return clampi(suma / norm.divisor + norm.offset);
+}
+
+// Detecta si k = col * row (rango 1) con enteros. Devuelve 1 y llena col/row si es separable.
+static int kernel_separable(const int k[3][3], int col[3], int row[3]) {
+    int i0 = -1, j0 = -1;
+    for (int i = 0; i < 3 && i0 < 0; i++)
+        for (int j = 0; j < 3; j++)
+            if (k[i][j] != 0) { i0 = i; j0 = j; break; }
+    if (i0 < 0) return 0; // Kernel nulo: no vale la pena separarlo.
+
+    // La fila base es la primera fila no nula dividida por el mcd de sus elementos.
+    int g = 0;
+    for (int j = 0; j < 3; j++) {
+        int a = k[i0][j] < 0 ? -k[i0][j] : k[i0][j];
+        while (a) { int t = g % a; g = a; a = t; }
+    }
+    for (int j = 0; j < 3; j++) row[j] = k[i0][j] / g;
+    for (int i = 0; i < 3; i++) {
+        if (k[i][j0] % row[j0] != 0) return 0;
+        col[i] = k[i][j0] / row[j0];
+        for (int j = 0; j < 3; j++)
+            if (k[i][j] != col[i] * row[j]) return 0;
+    }
+    return 1;
+}
+
+// --- Pasadas escalares sobre el interior (sin verificar lmites) ---
+// En todas, las filas apuntan a la columna x - 1 del primer pxel interior y n = width - 2.
+
+static void conv_sum9_scalar(const uint8_t* r0, const uint8_t* r1, const uint8_t* r2, int32_t* acc,
+                             int n, const int k[3][3]) {
+    for (int x = 0; x < n; x++) {
+        acc[x] = r0[x] * k[0][0] + r0[x + 1] * k[0][1] + r0[x + 2] * k[0][2]
+               + r1[x] * k[1][0] + r1[x + 1] * k[1][1] + r1[x + 2] * k[1][2]
+               + r2[x] * k[2][0] + r2[x + 1] * k[2][1] + r2[x + 2] * k[2][2];
+    }
+}
+
+static void conv_hpass_scalar(const uint8_t* r, int32_t* h, int n, const int row[3]) {
+    for (int x = 0; x < n; x++)
+        h[x] = r[x] * row[0] + r[x + 1] * row[1] + r[x + 2] * row[2];
+}
+
+static void conv_vpass_scalar(const int32_t* h0, const int32_t* h1, const int32_t* h2, int32_t* acc,
+                              int n, const int col[3]) {
+    for (int x = 0; x < n; x++)
+        acc[x] = h0[x] * col[0] + h1[x] * col[1] + h2[x] * col[2];
+}
+
+static void conv_finish_scalar(const int32_t* acc, uint8_t* out, int n, ConvNorm norm) {
+    for (int x = 0; x < n; x++)
+        out[x] = clampi(acc[x] / norm.divisor + norm.offset);
+}
+
+#ifdef FILTERS_X86
+// --- Pasadas SSE2: 8 pxeles por iteracin con acumuladores de 16 bits ---
+
+// Carga 8 bytes y los extiende a 8 enteros de 16 bits.
+__attribute__((target("sse2")))
+static inline __m128i load8_u16(const uint8_t* p) {
+    return _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)p), _mm_setzero_si128());
+}
+
+__attribute__((target("sse2")))
+static void conv_sum9_sse2(const uint8_t* r0, const uint8_t* r1, const uint8_t* r2, int16_t* acc,
+                           int n, const int k[3][3]) {
+    const uint8_t* rows[3] = { r0, r1, r2 };
+    __m128i kv[9];
+    for (int t = 0; t < 9; t++) kv[t] = _mm_set1_epi16((short)k[t / 3][t % 3]);
+    int x = 0;
+    for (; x + 8 <= n; x += 8) {
+        __m128i s = _mm_setzero_si128();
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 3; j++)
+                s = _mm_add_epi16(s, _mm_mullo_epi16(load8_u16(rows[i] + x + j), kv[i * 3 + j]));
+        _mm_storeu_si128((__m128i*)(acc + x), s);
+    }
+    for (; x < n; x++) {
+        int suma = 0;
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 3; j++)
+                suma += rows[i][x + j] * k[i][j];
+        acc[x] = (int16_t)suma;
+    }
+}
+
+__attribute__((target("sse2")))
+static void conv_hpass_sse2(const uint8_t* r, int16_t* h, int n, const int row[3]) {
+    const __m128i w0 = _mm_set1_epi16((short)row[0]);
+    const __m128i w1 = _mm_set1_epi16((short)row[1]);
+    const __m128i w2 = _mm_set1_epi16((short)row[2]);
+    int x = 0;
+    for (; x + 8 <= n; x += 8) {
+        __m128i s = _mm_mullo_epi16(load8_u16(r + x), w0);
+        s = _mm_add_epi16(s, _mm_mullo_epi16(load8_u16(r + x + 1), w1));
+        s = _mm_add_epi16(s, _mm_mullo_epi16(load8_u16(r + x + 2), w2));
+        _mm_storeu_si128((__m128i*)(h + x), s);
+    }
+    for (; x < n; x++)
+        h[x] = (int16_t)(r[x] * row[0] + r[x + 1] * row[1] + r[x + 2] * row[2]);
+}
+
+__attribute__((target("sse2")))
+static void conv_vpass_sse2(const int16_t* h0, const int16_t* h1, const int16_t* h2, int16_t* acc,
+                            int n, const int col[3]) {
+    const __m128i w0 = _mm_set1_epi16((short)col[0]);
+    const __m128i w1 = _mm_set1_epi16((short)col[1]);
+    const __m128i w2 = _mm_set1_epi16((short)col[2]);
+    int x = 0;
+    for (; x + 8 <= n; x += 8) {
+        __m128i s = _mm_mullo_epi16(_mm_loadu_si128((const __m128i*)(h0 + x)), w0);
+        s = _mm_add_epi16(s, _mm_mullo_epi16(_mm_loadu_si128((const __m128i*)(h1 + x)), w1));
+        s = _mm_add_epi16(s, _mm_mullo_epi16(_mm_loadu_si128((const __m128i*)(h2 + x)), w2));
+        _mm_storeu_si128((__m128i*)(acc + x), s);
+    }
+    for (; x < n; x++)
+        acc[x] = (int16_t)(h0[x] * col[0] + h1[x] * col[1] + h2[x] * col[2]);
+}
+
+// Normaliza 8 sumas: divisin truncada (en float, exacta en este rango), offset y saturacin a [0,255].
+__attribute__((target("sse2")))
+static void conv_finish_sse2(const int16_t* acc, uint8_t* out, int n, ConvNorm norm) {
+    const __m128 dv = _mm_set1_ps((float)norm.divisor);
+    const __m128i off = _mm_set1_epi32(norm.offset);
+    int x = 0;
+    for (; x + 8 <= n; x += 8) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(acc + x));
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16); // Extensin de signo a 32 bits.
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+        if (norm.divisor != 1) {
+            lo = _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(lo), dv));
+            hi = _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(hi), dv));
+        }
+        __m128i p = _mm_packs_epi32(_mm_add_epi32(lo, off), _mm_add_epi32(hi, off));
+        _mm_storel_epi64((__m128i*)(out + x), _mm_packus_epi16(p, p)); // La saturacin equivale a clampi.
+    }
+    for (; x < n; x++)
+        out[x] = clampi(acc[x] / norm.divisor + norm.offset);
+}
+#endif
+
+// Replica una fila de grises en los tres canales de una fila BGR.
+static void gray_to_bgr_row(const uint8_t* g, BGR* dst, int n) {
+    for (int x = 0; x < n; x++) {
+        dst[x].b = g[x];
+        dst[x].g = g[x];
+        dst[x].r = g[x];
+    }
+}
+
+// Datos compartidos por las bandas de una convolucin.
+// La entrada es la vista src (BGR, se usa el canal r) o src_plane; la salida es dst (BGR) o dst_plane.
+// Los planos tienen su propio stride en bytes (pueden ser regiones de una imagen ms grande).
+typedef struct {
+    BgrView src;
+    BGR* dst;
+    const uint8_t* src_plane;
+    uint8_t* dst_plane;
+    ptrdiff_t src_stride, dst_stride;
+    int width, height;
+    const int (*k)[3];
+    ConvNorm norm;
+    int separable;
+    int col[3], row[3];
+    int use_sse2;
+    int ok;               // Se pone en 0 si una banda no pudo reservar memoria (sus filas quedan sin escribir).
+} ConvJob;
+
+// Calcula la fila de salida y a partir de rows[0..2] = filas y - 1, y, y + 1 en grises (NULL fuera
+// de la imagen) y la deja en orow. acc y ring son buffers de trabajo de n = width - 2 enteros y
+// 3 * n enteros; primed indica si ring ya tiene las pasadas horizontales de las filas y - 1 e y
+// (solo vlido si la fila anterior se calcul con los mismos buffers).
+static void conv_row(const ConvJob* job, const uint8_t* const rows[3], int y, uint8_t* orow,
+                     int32_t* acc, int32_t* ring, int* primed) {
+    const int width = job->width, height = job->height;
+    const int n = width - 2; // Pxeles interiores por fila.
+    const int (*k)[3] = job->k;
+    if (y == 0 || y == height - 1 || n <= 0) {
+        // Fila de borde completa.
+        for (int x = 0; x < width; x++)
+            orow[x] = conv_border_pixel(rows, width, x, k, job->norm);
+        return;
+    }
+    orow[0] = conv_border_pixel(rows, width, 0, k, job->norm);
+    orow[width - 1] = conv_border_pixel(rows, width, width - 1, k, job->norm);
+    // Posicin de las filas y - 1, y, y + 1 dentro del anillo.
+    size_t s0 = (size_t)((y - 1) % 3) * n, s1 = (size_t)(y % 3) * n, s2 = (size_t)((y + 1) % 3) * n;
+#ifdef FILTERS_X86
+    if (job->use_sse2) {
+        int16_t* acc16 = (int16_t*)acc;
+        int16_t* ring16 = (int16_t*)ring;
+        if (job->separable) {
+            // La pasada horizontal de la fila y + 1 reemplaza en el anillo a la de y - 2.
+            if (!*primed) {
+                conv_hpass_sse2(rows[0], ring16 + s0, n, job->row);
+                conv_hpass_sse2(rows[1], ring16 + s1, n, job->row);
+                *primed = 1;
+            }
+            conv_hpass_sse2(rows[2], ring16 + s2, n, job->row);
+            conv_vpass_sse2(ring16 + s0, ring16 + s1, ring16 + s2, acc16, n, job->col);
+        } else {
+            conv_sum9_sse2(rows[0], rows[1], rows[2], acc16, n, k);
+        }
+        conv_finish_sse2(acc16, orow + 1, n, job->norm);
+        return;
+    }
+#endif
+    if (job->separable) {
+        if (!*primed) {
+            conv_hpass_scalar(rows[0], ring + s0, n, job->row);
+            conv_hpass_scalar(rows[1], ring + s1, n, job->row);
+            *primed = 1;
+        }
+        conv_hpass_scalar(rows[2], ring + s2, n, job->row);
+        conv_vpass_scalar(ring + s0, ring + s1, ring + s2, acc, n, job->col);
+    } else {
+        conv_sum9_scalar(rows[0], rows[1], rows[2], acc, n, k);
+    }
+    conv_finish_scalar(acc, orow + 1, n, job->norm);
+}
+
+// Reserva los buffers de trabajo de conv_row. Se reservan en 32 bits; la ruta de 16 bits usa la
+// misma memoria. Devuelve 1 si tuvo xito.
+static int conv_scratch_alloc(int width, int32_t** acc, int32_t** ring) {
+    int n = width - 2 > 0 ? width - 2 : 1;
+    *acc = (int32_t*)malloc(sizeof(int32_t) * n);
+    *ring = (int32_t*)malloc(sizeof(int32_t) * 3 * n);
+    return *acc && *ring;
+}
+
+// Convoluciona las filas [y0, y1). Con entrada BGR cada banda extrae a un plano local de 8 bits
+// sus filas ms una fila de halo arriba y abajo, de modo que las bandas no comparten nada
+// escribible y el plano de trabajo queda en cach. Con entrada planar lee el plano directamente.
+static void conv_band(void* ctx, int y0, int y1) {
+    ConvJob* job = (ConvJob*)ctx;
+    const int width = job->width, height = job->height;
+    int py0 = y0 > 0 ? y0 - 1 : 0;                // Primera fila del plano local (halo superior).
+    int py1 = y1 < height ? y1 + 1 : height;      // Fin del plano local (halo inferior).
+
+    const uint8_t* plane;
+    uint8_t* local = NULL;
+    ptrdiff_t pstride = width; // Stride del plano que se lee.
+    if (job->src_plane) {
+        plane = job->src_plane + (ptrdiff_t)py0 * job->src_stride;
+        pstride = job->src_stride;
+    } else {
+        local = (uint8_t*)malloc((size_t)(py1 - py0) * width);
+        plane = local;
+    }
+    uint8_t* out = (uint8_t*)malloc(width);
+    int32_t *acc, *ring;
+    int ok = conv_scratch_alloc(width, &acc, &ring);
+    if (!plane || !out || !ok) {
+        job->ok = 0; // Solo se escribe 0: no hace falta sincronizar entre bandas.
+        free(local); free(out); free(acc); free(ring);
+        return;
+    }
+    for (int y = py0; local && y < py1; y++) {
+        const BGR* srow = bgr_view_row(&job->src, y);
+        uint8_t* prow = local + (size_t)(y - py0) * width;
+        for (int x = 0; x < width; x++) prow[x] = srow[x].r;
+    }
+
+    int primed = 0; // Si el anillo ya tiene las filas y - 1 e y.
+    for (int y = y0; y < y1; y++) {
+        const uint8_t* rows[3];
+        rows[0] = y > 0 ? plane + (ptrdiff_t)(y - 1 - py0) * pstride : NULL;
+        rows[1] = plane + (ptrdiff_t)(y - py0) * pstride;
+        rows[2] = y < height - 1 ? plane + (ptrdiff_t)(y + 1 - py0) * pstride : NULL;
+        // Con salida planar se escribe directo en la fila destino; si no, en out y luego se expande.
+        uint8_t* orow = job->dst_plane ? job->dst_plane + (ptrdiff_t)y * job->dst_stride : out;
+        conv_row(job, rows, y, orow, acc, ring, &primed);
+        if (!job->dst_plane)
+            gray_to_bgr_row(out, job->dst + (size_t)y * width, width);
+    }
+
+    free(local);
+    free(out);
+    free(acc);
+    free(ring);
+}
+
+// Prepara los datos comunes de una convolucin: normalizacin, deteccin de kernel separable y
+// si las sumas caben en 16 bits para la ruta SSE2.
+static void conv_job_init(ConvJob* job, int width, int height, const int k[3][3], int divisor, int offset) {
+    memset(job, 0, sizeof(*job));
+    job->width = width;
+    job->height = height;
+    job->k = k;
+    job->norm.divisor = divisor == 0 ? 1 : divisor; // Para evitar divisin por cero.
+    job->norm.offset = offset;
+    job->separable = kernel_separable(k, job->col, job->row);
+    int sum_abs = 0;
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            sum_abs += k[i][j] < 0 ? -k[i][j] : k[i][j];
+    job->use_sse2 = simd_level >= 1 && sum_abs <= 32767 / 255; // Las sumas caben en 16 bits con signo.
+    job->ok = 1;
+}
+
+// --- FUNCIN convolve3x3_gray ---
+// Aplica una convolucin 3x3 sobre una imagen en escala de grises, en bandas de filas paralelas.
+// Parmetros:
+//   src     -> buffer de entrada (debe estar en escala de grises).
+//   dst     -> buffer de salida (donde se guardar el resultado).
+//   width   -> ancho de la imagen en pxeles.
+//   height  -> alto de la imagen en pxeles.
+//   k       -> kernel 3x3 de enteros (matriz de convolucin).
+//   divisor -> divisor para normalizar el resultado (suma de los valores del kernel, si es 0 se usa 1).
+//   offset  -> valor a sumar al resultado final (bias).
+// Devuelve 1 si tuvo xito, 0 si falta memoria (dst queda incompleto).
+int convolve3x3_gray(const BGR* src, BGR* dst, int width, int height, const int k[3][3], int divisor, int offset) {
+    if (width <= 0 || height <= 0) return 1;
+    if (!gray_row) select_kernels();
+    ConvJob job;
+    conv_job_init(&job, width, height, k, divisor, offset);
+    job.src = bgr_view_packed(src, width, height);
+    job.dst = dst;
+    parallel_rows(height, parallel_band_rows(height, (size_t)width * sizeof(BGR)), conv_band, &job);
+    return job.ok;
+}
+
+// --- FUNCIN convolve3x3_plane ---
+// Igual que convolve3x3_gray pero entre imgenes de grises planares (1 byte por pxel), sin
+// copias intermedias. src y dst deben tener el mismo tamao y no pueden ser la misma imagen.
+int convolve3x3_plane(const GrayImage* src, GrayImage* dst, const int k[3][3], int divisor, int offset) {
+    return convolve3x3_plane_rows(src, dst, k, divisor, offset, 0, src->height);
+}
+
+// --- FUNCIN convolve3x3_plane_rows ---
+// Solo calcula las filas [y0, y1) de dst; las filas vecinas de src se leen pero no se escriben.
+int convolve3x3_plane_rows(const GrayImage* src, GrayImage* dst, const int k[3][3], int divisor, int offset,
+                           int y0, int y1) {
+    if (src->width <= 0 || y1 <= y0) return 1;
+    if (!gray_row) select_kernels();
+    ConvJob job;
+    conv_job_init(&job, src->width, src->height, k, divisor, offset);
+    job.src_plane = src->data;
+    job.src_stride = src->stride;
+    job.dst_plane = dst->data;
+    job.dst_stride = dst->stride;
+    parallel_rows_range(y0, y1, parallel_band_rows(y1 - y0, (size_t)src->width), conv_band, &job);
+    return job.ok;
+}
+
+// --- FUNCIN convolve3x3_view ---
+// Convolucin 3x3 leyendo el canal r de una vista con stride (por ejemplo un BMP en grises
+// proyectado en memoria) hacia una imagen planar del mismo tamao, sin copiar la entrada completa.
+int convolve3x3_view(const BgrView* src, GrayImage* dst, const int k[3][3], int divisor, int offset) {
+    if (src->width <= 0 || src->height <= 0) return 1;
+    if (!gray_row) select_kernels();
+    ConvJob job;
+    conv_job_init(&job, src->width, src->height, k, divisor, offset);
+    job.src = *src;
+    job.dst_plane = dst->data;
+    job.dst_stride = dst->stride;
+    parallel_rows(src->height, parallel_band_rows(src->height, (size_t)src->width * sizeof(BGR)), conv_band, &job);
+    return job.ok;
+}
+
+// Origen de filas de color para los recorridos en streaming: una imagen en memoria o un lector
+// incremental de BMP. Las filas se piden siempre en orden, de arriba hacia abajo.
+typedef struct {
+    const BgrView* view; // Imagen accesible en memoria (buffer o proyeccin), o NULL si se lee de reader.
+    BmpReader* reader;
+} RowSource;
+
+// Devuelve la fila y del origen (NULL si hubo un error de lectura).
+static const BGR* row_source_get(RowSource* src, int y) {
+    if (src->view) return bgr_view_row(src->view, y);
+    return bmp_reader_next_row(src->reader);
+}
+
+// Ncleo de gray_conv_to_bmp y gray_conv_file: grises + convolucin en un anillo de 3 filas,
+// entregando cada fila resultante al escritor.
+static int gray_conv_stream(RowSource* src, int width, int height, const int k[3][3], int divisor, int offset,
+                            const char* path) {
+    if (!gray_row) select_kernels();
+    ConvJob job;
+    conv_job_init(&job, width, height, k, divisor, offset);
+
+    BmpWriter w;
+    if (!bmp_writer_open(&w, path, width, height)) return 0;
+    uint8_t* gring = (uint8_t*)malloc((size_t)3 * (width > 0 ? width : 1)); // Anillo de 3 filas de grises.
+    uint8_t* out = (uint8_t*)malloc(width > 0 ? width : 1);
+    int32_t *acc, *ring;
+    int ok = conv_scratch_alloc(width, &acc, &ring) && gring && out;
+    if (!ok) printf("Sin memoria para la convolucin.\n");
+
+    int next = 0;   // Prxima fila de color a convertir.
+    int primed = 0; // Si el anillo de pasadas horizontales ya tiene las filas y - 1 e y.
+    for (int y = 0; ok && y < height; y++) {
+        // Convierte las filas que faltan hasta y + 1; la fila y - 2, ya sin uso, queda sobrescrita.
+        int need = y + 2 < height ? y + 2 : height;
+        for (; ok && next < need; next++) {
+            const BGR* srow = row_source_get(src, next);
+            if (srow == NULL) { ok = 0; break; }
+            gray_row(srow, (BGR*)srow, gring + (size_t)(next % 3) * width, (size_t)width);
+        }
+        if (!ok) break;
+        const uint8_t* rows[3];
+        rows[0] = y > 0 ? gring + (size_t)((y - 1) % 3) * width : NULL;
+        rows[1] = gring + (size_t)(y % 3) * width;
+        rows[2] = y < height - 1 ? gring + (size_t)((y + 1) % 3) * width : NULL;
+        conv_row(&job, rows, y, out, acc, ring, &primed);
+        ok = bmp_writer_gray_row(&w, out);
+    }
+
+    free(gring);
+    free(out);
+    free(acc);
+    free(ring);
+    // La entrada se cierra antes de reemplazar la salida: pueden ser el mismo archivo.
+    if (src->reader) bmp_reader_close(src->reader);
+    if (!bmp_writer_close(&w)) ok = 0;
+    if (!ok) printf("Error escribiendo %s\n", path);
+    return ok;
+}
+
+// --- FUNCIN gray_conv_to_bmp ---
+// Conversin a grises + convolucin 3x3 + guardado fusionados en una sola pasada por filas.
+// Cada fila de color se convierte a grises justo cuando la convolucin la necesita, dentro de un
+// anillo de 3 filas (las filas y - 1, y, y + 1), y la fila resultante va directo al escritor BMP.
+// Cada pxel de entrada se lee una sola vez y la memoria extra es O(width): el anillo, una fila
+// de salida y los buffers de trabajo, en lugar de dos imgenes completas intermedias.
+// Parmetros:
+//   pixels  -> imagen BGR de entrada (no se modifica).
+//   width   -> ancho de la imagen en pxeles.
+//   height  -> alto de la imagen en pxeles.
+//   k       -> kernel 3x3 de enteros.
+//   divisor -> divisor para normalizar el resultado (si es 0 se usa 1).
+//   offset  -> valor a sumar al resultado final (bias).
+//   path    -> archivo BMP de salida.
+// Retorno: 1 si tuvo xito, 0 si hubo error.
+int gray_conv_to_bmp(const BGR* pixels, int width, int height, const int k[3][3], int divisor, int offset,
+                     const char* path) {
+    BgrView view = bgr_view_packed(pixels, width, height);
+    return gray_conv_view_to_bmp(&view, k, divisor, offset, path);
+}
+
+// Igual que gray_conv_to_bmp, leyendo las filas de una vista con stride (p. ej. un BMP proyectado).
+int gray_conv_view_to_bmp(const BgrView* src, const int k[3][3], int divisor, int offset, const char* path) {
+    RowSource rs = { src, NULL };
+    return gray_conv_stream(&rs, src->width, src->height, k, divisor, offset, path);
+}
+
+// --- FUNCIN gray_conv_file ---
+// Igual que gray_conv_to_bmp, pero leyendo la imagen de entrada por lotes desde el archivo: la
+// imagen nunca se carga completa, as que sirve para BMP ms grandes que la memoria disponible.
+// Retorno: 1 si tuvo xito, 0 si hubo error.
+int gray_conv_file(const char* in_path, const char* out_path, const int k[3][3], int divisor, int offset) {
+    BmpReader r;
+    if (!bmp_reader_open(&r, in_path)) return 0;
+    RowSource src = { NULL, &r };
+    int ok = gray_conv_stream(&src, r.width, r.height, k, divisor, offset, out_path);
+    bmp_reader_close(&r);
+    return ok;
+}
+
+// --- FUNCIN to_grayscale_file ---
+// Conversin a grises de archivo a archivo por lotes de filas, con memoria acotada.
+// Retorno: 1 si tuvo xito, 0 si hubo error.
+int to_grayscale_file(const char* in_path, const char* out_path) {
+    if (!gray_row) select_kernels();
+    BmpReader r;
+    if (!bmp_reader_open(&r, in_path)) return 0;
+    BmpWriter w;
+    uint8_t* plane = (uint8_t*)malloc(r.width);
+    int ok = plane != NULL && bmp_writer_open(&w, out_path, r.width, r.height);
+    if (plane == NULL) printf("Sin memoria para la conversin.\n");
+    if (ok) {
+        for (int y = 0; ok && y < r.height; y++) {
+            const BGR* srow = bmp_reader_next_row(&r);
+            if (srow == NULL) { ok = 0; break; }
+            gray_row(srow, (BGR*)srow, plane, (size_t)r.width);
+            ok = bmp_writer_gray_row(&w, plane);
+        }
+        bmp_reader_close(&r); // Antes de reemplazar la salida, que puede ser la misma entrada.
+        if (!bmp_writer_close(&w)) ok = 0;
+        if (!ok) printf("Error escribiendo %s\n", out_path);
+    }
+    free(plane);
+    bmp_reader_close(&r);
+    return ok;
+}
+
+// --- CONVOLUCIN A COLOR ---
+// Cada canal (B, G, R) se convoluciona por separado con el mismo kernel. Las filas BGR se separan
+// en tres planos (SoA) dentro de un anillo de 3 filas por canal; as cada canal usa exactamente
+// los mismos kernels de 8 bits que la ruta de grises (interior SIMD, deteccin separable) y al
+// final las tres filas resultantes se vuelven a intercalar en BGR.
+
+// Separa n pxeles BGR en tres planos.
+static void deinterleave_scalar(const BGR* src, uint8_t* b, uint8_t* g, uint8_t* r, int n) {
+    for (int x = 0; x < n; x++) {
+        b[x] = src[x].b;
+        g[x] = src[x].g;
+        r[x] = src[x].r;
+    }
+}
+
+// Junta tres planos en n pxeles BGR.
+static void interleave_scalar(const uint8_t* b, const uint8_t* g, const uint8_t* r, BGR* dst, int n) {
+    for (int x = 0; x < n; x++) {
+        dst[x].b = b[x];
+        dst[x].g = g[x];
+        dst[x].r = r[x];
+    }
+}
+
+#ifdef FILTERS_X86
+// Mscaras de pshufb para 16 pxeles (48 bytes en 3 registros). Para separar, el byte i del canal
+// c sale del byte 3i + c de la entrada; para intercalar, el byte o de la salida sale del pxel o / 3
+// del canal o % 3. 0x80 deja el byte en cero, y la unin de los tres registros da el resultado.
+static void shuffle_masks(uint8_t split[3][3][16], uint8_t join[3][3][16]) {
+    for (int j = 0; j < 3; j++)
+        for (int c = 0; c < 3; c++)
+            for (int i = 0; i < 16; i++) {
+                int from = 3 * i + c;
+                split[c][j][i] = from / 16 == j ? (uint8_t)(from % 16) : 0x80;
+                int o = 16 * j + i;
+                join[j][c][i] = o % 3 == c ? (uint8_t)(o / 3) : 0x80;
+            }
+}
+
+__attribute__((target("avx2")))
+static void deinterleave_avx2(const BGR* src, uint8_t* b, uint8_t* g, uint8_t* r, int n) {
+    uint8_t split[3][3][16], join[3][3][16];
+    shuffle_masks(split, join);
+    uint8_t* dst[3] = { b, g, r };
+    __m128i m[3][3];
+    for (int c = 0; c < 3; c++)
+        for (int j = 0; j < 3; j++) m[c][j] = _mm_loadu_si128((const __m128i*)split[c][j]);
+    const uint8_t* s = (const uint8_t*)src;
+    int x = 0;
+    for (; x + 16 <= n; x += 16) {
+        __m128i a0 = _mm_loadu_si128((const __m128i*)(s + 3 * x));
+        __m128i a1 = _mm_loadu_si128((const __m128i*)(s + 3 * x + 16));
+        __m128i a2 = _mm_loadu_si128((const __m128i*)(s + 3 * x + 32));
+        for (int c = 0; c < 3; c++) {
+            __m128i v = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a0, m[c][0]), _mm_shuffle_epi8(a1, m[c][1])),
+                                     _mm_shuffle_epi8(a2, m[c][2]));
+            _mm_storeu_si128((__m128i*)(dst[c] + x), v);
+        }
+    }
+    deinterleave_scalar(src + x, b + x, g + x, r + x, n - x);
+}
+
+__attribute__((target("avx2")))
+static void interleave_avx2(const uint8_t* b, const uint8_t* g, const uint8_t* r, BGR* dst, int n) {
+    uint8_t split[3][3][16], join[3][3][16];
+    shuffle_masks(split, join);
+    __m128i m[3][3];
+    for (int j = 0; j < 3; j++)
+        for (int c = 0; c < 3; c++) m[j][c] = _mm_loadu_si128((const __m128i*)join[j][c]);
+    uint8_t* d = (uint8_t*)dst;
+    int x = 0;
+    for (; x + 16 <= n; x += 16) {
+        __m128i p[3] = { _mm_loadu_si128((const __m128i*)(b + x)), _mm_loadu_si128((const __m128i*)(g + x)),
+                         _mm_loadu_si128((const __m128i*)(r + x)) };
+        for (int j = 0; j < 3; j++) {
+            __m128i v = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(p[0], m[j][0]), _mm_shuffle_epi8(p[1], m[j][1])),
+                                     _mm_shuffle_epi8(p[2], m[j][2]));
+            _mm_storeu_si128((__m128i*)(d + 3 * x + 16 * j), v);
+        }
+    }
+    interleave_scalar(b + x, g + x, r + x, dst + x, n - x);
+}
+#endif
+
+// Datos de una convolucin a color: la salida va al buffer dst o, fila por fila, al escritor.
+typedef struct {
+    ConvJob conv;
+    BgrView src;
+    BGR* dst;
+    ptrdiff_t dst_stride;
+    BmpWriter* writer;
+    int ok;               // Se pone en 0 si falla la memoria o la escritura.
+} ColorJob;
+
+// Convoluciona a color las filas [y0, y1): cada banda tiene su propio anillo de 3 filas por canal
+// (empezando en la fila de halo y0 - 1) y sus buffers de trabajo por canal.
+static void color_band(void* ctx, int y0, int y1) {
+    ColorJob* job = (ColorJob*)ctx;
+    const int width = job->conv.width, height = job->conv.height;
+    const size_t w = (size_t)width;
+    uint8_t* ring = (uint8_t*)malloc(9 * w);   // [canal][fila % 3][x]
+    uint8_t* out = (uint8_t*)malloc(3 * w);    // [canal][x]
+    BGR* orow = (BGR*)malloc(w * sizeof(BGR));
+    int32_t *acc[3] = { NULL, NULL, NULL }, *hring[3] = { NULL, NULL, NULL };
+    int ok = ring && out && orow;
+    for (int c = 0; c < 3; c++)
+        if (!conv_scratch_alloc(width, &acc[c], &hring[c])) ok = 0;
+    void (*split)(const BGR*, uint8_t*, uint8_t*, uint8_t*, int) = deinterleave_scalar;
+    void (*join)(const uint8_t*, const uint8_t*, const uint8_t*, BGR*, int) = interleave_scalar;
+#ifdef FILTERS_X86
+    if (simd_level >= 2) {
+        split = deinterleave_avx2;
+        join = interleave_avx2;
+    }
+#endif
+
+    int next = y0 > 0 ? y0 - 1 : 0;     // Prxima fila de entrada a separar en el anillo.
+    int primed[3] = { 0, 0, 0 };
+    for (int y = y0; ok && y < y1; y++) {
+        int need = y + 2 < height ? y + 2 : height;
+        for (; next < need; next++) {
+            size_t slot = (size_t)(next % 3) * w;
+            split(bgr_view_row(&job->src, next), ring + slot, ring + 3 * w + slot, ring + 6 * w + slot, width);
+        }
+        for (int c = 0; c < 3; c++) {
+            const uint8_t* plane = ring + (size_t)c * 3 * w;
+            const uint8_t* rows[3];
+            rows[0] = y > 0 ? plane + (size_t)((y - 1) % 3) * w : NULL;
+            rows[1] = plane + (size_t)(y % 3) * w;
+            rows[2] = y < height - 1 ? plane + (size_t)((y + 1) % 3) * w : NULL;
+            conv_row(&job->conv, rows, y, out + c * w, acc[c], hring[c], &primed[c]);
+        }
+        if (job->writer) {
+            join(out, out + w, out + 2 * w, orow, width);
+            ok = bmp_writer_row(job->writer, orow);
+        } else {
+            join(out, out + w, out + 2 * w, (BGR*)((uint8_t*)job->dst + (ptrdiff_t)y * job->dst_stride), width);
+        }
+    }
+    if (!ok) job->ok = 0; // Solo se escribe 0: no hace falta sincronizar entre bandas.
+
+    free(ring);
+    free(out);
+    free(orow);
+    for (int c = 0; c < 3; c++) {
+        free(acc[c]);
+        free(hring[c]);
+    }
+}
+
+// --- FUNCIN convolve3x3_color ---
+// Convolucin 3x3 de cada canal de una imagen a color (sin pasar a grises), en bandas paralelas.
+// Parmetros:
+//   src     -> vista de la imagen BGR de entrada.
+//   dst     -> buffer BGR de salida de src->width x src->height (contiguo, distinto de la entrada).
+//   k, divisor, offset -> igual que en convolve3x3_gray.
+// Retorno: 1 si tuvo xito, 0 si falt memoria.
+int convolve3x3_color(const BgrView* src, BGR* dst, const int k[3][3], int divisor, int offset) {
+    return convolve3x3_color_rows(src, dst, (ptrdiff_t)src->width * (ptrdiff_t)sizeof(BGR), k, divisor, offset,
+                                  0, src->height);
+}
+
+int convolve3x3_color_rows(const BgrView* src, BGR* dst, ptrdiff_t dst_stride, const int k[3][3], int divisor,
+                           int offset, int y0, int y1) {
+    if (src->width <= 0 || y1 <= y0) return 1;
+    if (!gray_row) select_kernels();
+    ColorJob job;
+    conv_job_init(&job.conv, src->width, src->height, k, divisor, offset);
+    job.src = *src;
+    job.dst = dst;
+    job.dst_stride = dst_stride;
+    job.writer = NULL;
+    job.ok = 1;
+    parallel_rows_range(y0, y1, parallel_band_rows(y1 - y0, (size_t)src->width * sizeof(BGR)), color_band, &job);
+    return job.ok;
+}
+
+// --- FUNCIN color_conv_view_to_bmp ---
+// Convolucin 3x3 a color y guardado fusionados: recorre la imagen una vez por filas, como
+// gray_conv_to_bmp, con memoria extra O(width).
+// Retorno: 1 si tuvo xito, 0 si hubo error.
+int color_conv_view_to_bmp(const BgrView* src, const int k[3][3], int divisor, int offset, const char* path) {
+    if (!gray_row) select_kernels();
+    BmpWriter w;
+    if (!bmp_writer_open(&w, path, src->width, src->height)) return 0;
+    ColorJob job;
+    conv_job_init(&job.conv, src->width, src->height, k, divisor, offset);
+    job.src = *src;
+    job.dst = NULL;
+    job.writer = &w;
+    job.ok = 1;
+    if (src->height > 0) color_band(&job, 0, src->height);
+    int ok = bmp_writer_close(&w) && job.ok;
+    if (!ok) printf("Error escribiendo %s\n", path);
+    return ok;
+}
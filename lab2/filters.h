@@ -0,0 +1,65 @@
+// filters.h
+// Cabecera de los filtros de imagen: conversin a grises y convolucin 3x3.
+#ifndef FILTERS_H
+#define FILTERS_H
+
+#include "bmp.h"
+
+// Nombre de la ruta vectorizada elegida para esta CPU ("AVX2", "SSE2" o "escalar").
+const char* filters_simd_path(void);
+
+// Nivel SIMD elegido: 0 = escalar, 1 = SSE2, 2 = AVX2. Lo comparten los dems mdulos de filtros.
+int filters_simd_level(void);
+
+// Limita el nivel SIMD a level (segn lo que soporte la CPU) o, con -1, vuelve a la eleccin
+// automtica. Devuelve el nivel efectivo. Sirve para comparar las rutas; no llamar con filtros en curso.
+int filters_set_simd_level(int level);
+
+// Convierte el buffer a escala de grises en sitio (r = g = b = luminancia).
+void to_grayscale(BGR* pixels, int width, int height);
+
+// Convolucin 3x3 sobre una imagen en grises (lee el canal r de src, escribe r = g = b en dst).
+// Las convoluciones 3x3 devuelven 1 si tuvieron xito y 0 si falta memoria.
+int convolve3x3_gray(const BGR* src, BGR* dst, int width, int height, const int k[3][3], int divisor, int offset);
+
+// Conversin a grises hacia una imagen planar ya reservada del mismo tamao (no modifica pixels).
+void to_grayscale_plane(const BGR* pixels, int width, int height, GrayImage* out);
+
+// Convolucin 3x3 entre imgenes de grises planares del mismo tamao.
+int convolve3x3_plane(const GrayImage* src, GrayImage* dst, const int k[3][3], int divisor, int offset);
+
+// Igual, pero solo escribe las filas [y0, y1) de dst (para procesar una imagen por bloques).
+int convolve3x3_plane_rows(const GrayImage* src, GrayImage* dst, const int k[3][3], int divisor, int offset,
+                           int y0, int y1);
+
+// Versiones que leen una vista con stride (p. ej. un BMP proyectado con bmp_map o una regin de
+// inters de bgr_view_roi) sin copiarla. La salida es una imagen planar ya reservada del mismo
+// tamao (o una regin de otra, con gray_image_roi); la convolucin usa el canal r.
+void to_grayscale_view(const BgrView* src, GrayImage* out);
+
+// Conversin a grises desde una imagen BGRA contigua (4 bytes por pxel) hacia un plano ya reservado.
+void to_grayscale_bgra(const BGRA* pixels, int width, int height, GrayImage* out);
+int convolve3x3_view(const BgrView* src, GrayImage* dst, const int k[3][3], int divisor, int offset);
+
+// Grises + convolucin 3x3 + guardado en BMP fusionados: recorre la imagen una vez por filas con
+// un anillo de 3 filas de grises, usando O(width) memoria extra. Devuelve 1 si tuvo xito, 0 si no.
+int gray_conv_to_bmp(const BGR* pixels, int width, int height, const int k[3][3], int divisor, int offset,
+                     const char* path);
+int gray_conv_view_to_bmp(const BgrView* src, const int k[3][3], int divisor, int offset, const char* path);
+
+// Convolucin 3x3 a color: cada canal B, G, R se filtra por separado con el mismo kernel, sin
+// pasar por grises. La primera escribe en un buffer BGR contiguo (en bandas paralelas) y la
+// segunda va fila por fila a un BMP. Devuelven 1 si tuvieron xito, 0 si no.
+int convolve3x3_color(const BgrView* src, BGR* dst, const int k[3][3], int divisor, int offset);
+int color_conv_view_to_bmp(const BgrView* src, const int k[3][3], int divisor, int offset, const char* path);
+// Como convolve3x3_color, pero solo escribe las filas [y0, y1) de dst, cuya fila y empieza
+// dst_stride bytes despus de la anterior.
+int convolve3x3_color_rows(const BgrView* src, BGR* dst, ptrdiff_t dst_stride, const int k[3][3], int divisor,
+                           int offset, int y0, int y1);
+
+// Versiones de archivo a archivo que leen la entrada por lotes con BmpReader, para imgenes ms
+// grandes que la memoria. Devuelven 1 si tuvieron xito, 0 si no.
+int to_grayscale_file(const char* in_path, const char* out_path);
+int gray_conv_file(const char* in_path, const char* out_path, const int k[3][3], int divisor, int offset);
+
+#endif
@@ -0,0 +1,200 @@
+// integral.c
+// Construccin de la tabla de sumas acumuladas y filtros locales de radio arbitrario sobre ella.
+
+#include "integral.h"
+#include "parallel.h"
+#include <stdlib.h>     // Para malloc, calloc, free
+#include <string.h>     // Para memset
+#include <math.h>       // Para sqrt
+
+// --- CONSTRUCCIN EN PARALELO ---
+// La tabla se arma en tres pasos sobre bloques de filas consecutivas:
+//   1. En paralelo, cada bloque calcula sus sumas como si fuera la imagen completa: la suma
+//      acumulada de cada fila (de izquierda a derecha) ms la fila anterior del mismo bloque.
+//   2. En orden, la ltima fila de cada bloque suma la ltima fila (ya definitiva) del anterior.
+//   3. En paralelo, las dems filas de cada bloque suman la ltima fila del bloque anterior.
+// Los pasos 1 y 3 recorren la tabla una vez cada uno con todos los hilos; el 2 toca una fila por
+// bloque. Las sumas de 32 bits se desbordan mdulo 2^32 sin afectar a las sumas de ventana.
+
+typedef struct {
+    IntegralImage* ii;
+    const GrayImage* src;
+    int block;          // Filas de la tabla por bloque (la fila 0 de la tabla no pertenece a ninguno).
+    int rows;           // Filas de la tabla con datos: 1 .. rows.
+} BuildJob;
+
+// Filas [t0, t1) de la tabla que forman el bloque b.
+static void block_rows(const BuildJob* job, int b, int* t0, int* t1) {
+    *t0 = 1 + b * job->block;
+    *t1 = *t0 + job->block < job->rows + 1 ? *t0 + job->block : job->rows + 1;
+}
+
+// Paso 1 para los bloques [b0, b1).
+static void build_local(void* ctx, int b0, int b1) {
+    BuildJob* job = (BuildJob*)ctx;
+    IntegralImage* ii = job->ii;
+    const int width = ii->width;
+    for (int b = b0; b < b1; b++) {
+        int t0, t1;
+        block_rows(job, b, &t0, &t1);
+        for (int t = t0; t < t1; t++) {
+            const uint8_t* p = gray_image_row(job->src, ii->y0 + t - 1);
+            uint32_t* row = ii->sum + (size_t)t * ii->stride;
+            const uint32_t* prev = row - ii->stride;
+            int first = t == t0; // La primera fila del bloque no suma la anterior.
+            uint32_t acc = 0;
+            row[0] = 0;
+            for (int x = 0; x < width; x++) {
+                acc += p[x];
+                row[x + 1] = first ? acc : acc + prev[x + 1];
+            }
+            if (!ii->sqsum) continue;
+            uint64_t* sq = ii->sqsum + (size_t)t * ii->stride;
+            const uint64_t* sq_prev = sq - ii->stride;
+            uint64_t acc2 = 0;
+            sq[0] = 0;
+            for (int x = 0; x < width; x++) {
+                acc2 += (uint32_t)p[x] * p[x];
+                sq[x + 1] = first ? acc2 : acc2 + sq_prev[x + 1];
+            }
+        }
+    }
+}
+
+// Paso 3 para los bloques [b0, b1): suma la ltima fila del bloque anterior a las dems filas.
+static void build_carry(void* ctx, int b0, int b1) {
+    BuildJob* job = (BuildJob*)ctx;
+    IntegralImage* ii = job->ii;
+    const size_t n = ii->stride;
+    for (int b = b0 > 1 ? b0 : 1; b < b1; b++) {
+        int t0, t1;
+        block_rows(job, b, &t0, &t1);
+        const uint32_t* carry = ii->sum + (size_t)(t0 - 1) * n;
+        for (int t = t0; t < t1 - 1; t++) {
+            uint32_t* row = ii->sum + (size_t)t * n;
+            for (size_t x = 0; x < n; x++) row[x] += carry[x];
+        }
+        if (!ii->sqsum) continue;
+        const uint64_t* sq_carry = ii->sqsum + (size_t)(t0 - 1) * n;
+        for (int t = t0; t < t1 - 1; t++) {
+            uint64_t* row = ii->sqsum + (size_t)t * n;
+            for (size_t x = 0; x < n; x++) row[x] += sq_carry[x];
+        }
+    }
+}
+
+int integral_build(IntegralImage* ii, const GrayImage* src, int y0, int y1, int with_squares) {
+    memset(ii, 0, sizeof(*ii));
+    if (y1 <= y0) return 0;
+    ii->width = src->width;
+    ii->height = y1 - y0;
+    ii->y0 = y0;
+    ii->stride = (size_t)src->width + 1;
+    size_t entries = ii->stride * ((size_t)ii->height + 1);
+    ii->sum = (uint32_t*)malloc(entries * sizeof(uint32_t));
+    if (with_squares) ii->sqsum = (uint64_t*)malloc(entries * sizeof(uint64_t));
+    if (!ii->sum || (with_squares && !ii->sqsum)) {
+        integral_free(ii);
+        return 0;
+    }
+    memset(ii->sum, 0, ii->stride * sizeof(uint32_t));
+    if (ii->sqsum) memset(ii->sqsum, 0, ii->stride * sizeof(uint64_t));
+
+    size_t row_bytes = ii->stride * (sizeof(uint32_t) + (with_squares ? sizeof(uint64_t) : 0));
+    BuildJob job = { ii, src, parallel_band_rows(ii->height, row_bytes), ii->height };
+    int blocks = (ii->height + job.block - 1) / job.block;
+    // Cada "fila" de parallel_rows es un bloque entero.
+    parallel_rows(blocks, 1, build_local, &job);
+    for (int b = 1; b < blocks; b++) {
+        int t0, t1, p0, p1;
+        block_rows(&job, b, &t0, &t1);
+        block_rows(&job, b - 1, &p0, &p1);
+        uint32_t* last = ii->sum + (size_t)(t1 - 1) * ii->stride;
+        const uint32_t* carry = ii->sum + (size_t)(p1 - 1) * ii->stride;
+        for (size_t x = 0; x < ii->stride; x++) last[x] += carry[x];
+        if (!ii->sqsum) continue;
+        uint64_t* sq_last = ii->sqsum + (size_t)(t1 - 1) * ii->stride;
+        const uint64_t* sq_carry = ii->sqsum + (size_t)(p1 - 1) * ii->stride;
+        for (size_t x = 0; x < ii->stride; x++) sq_last[x] += sq_carry[x];
+    }
+    parallel_rows(blocks, 1, build_carry, &job);
+    return 1;
+}
+
+void integral_free(IntegralImage* ii) {
+    free(ii->sum);
+    free(ii->sqsum);
+    memset(ii, 0, sizeof(*ii));
+}
+
+// --- FILTROS LOCALES ---
+
+typedef struct {
+    const IntegralImage* ii;
+    const GrayImage* src;
+    GrayImage* dst;
+    LocalOp op;
+    int radius;
+    int c;
+} LocalJob;
+
+static void local_band(void* ctx, int y0, int y1) {
+    LocalJob* job = (LocalJob*)ctx;
+    const IntegralImage* ii = job->ii;
+    const int width = job->src->width, height = job->src->height, r = job->radius;
+    for (int y = y0; y < y1; y++) {
+        // Ventana vertical recortada a la imagen.
+        int wy0 = y - r > 0 ? y - r : 0;
+        int wy1 = y + r + 1 < height ? y + r + 1 : height;
+        const uint8_t* in = gray_image_row(job->src, y);
+        uint8_t* out = gray_image_row(job->dst, y);
+        for (int x = 0; x < width; x++) {
+            int wx0 = x - r > 0 ? x - r : 0;
+            int wx1 = x + r + 1 < width ? x + r + 1 : width;
+            uint64_t count = (uint64_t)(wx1 - wx0) * (uint64_t)(wy1 - wy0);
+            uint64_t sum = integral_sum(ii, wx0, wy0, wx1, wy1);
+            switch (job->op) {
+            case LOCAL_MEAN:
+                out[x] = (uint8_t)((sum + count / 2) / count);
+                break;
+            case LOCAL_THRESHOLD:
+                // pixel > sum / count - c, sin dividir.
+                out[x] = (int64_t)(in[x] + job->c) * (int64_t)count > (int64_t)sum ? 255 : 0;
+                break;
+            default: {
+                double mean = (double)sum / count;
+                double var = (double)integral_sqsum(ii, wx0, wy0, wx1, wy1) / count - mean * mean;
+                out[x] = clampi((int)(sqrt(var > 0 ? var : 0) + 0.5));
+            }
+            }
+        }
+    }
+}
+
+int local_filter_rows(const GrayImage* src, GrayImage* dst, LocalOp op, int radius, int c, int y0, int y1) {
+    if (radius < 0 || radius > INTEGRAL_MAX_RADIUS) return 0;
+    if (y0 < 0) y0 = 0;
+    if (y1 > src->height) y1 = src->height;
+    if (y1 <= y0 || src->width <= 0) return 1;
+    // La tabla solo cubre las filas que tocan las ventanas de [y0, y1).
+    int t0 = y0 - radius > 0 ? y0 - radius : 0;
+    int t1 = y1 + radius < src->height ? y1 + radius : src->height;
+    IntegralImage ii;
+    if (!integral_build(&ii, src, t0, t1, op == LOCAL_STDDEV)) return 0;
+    LocalJob job = { &ii, src, dst, op, radius, c };
+    parallel_rows_range(y0, y1, parallel_band_rows(y1 - y0, (size_t)src->width * 2), local_band, &job);
+    integral_free(&ii);
+    return 1;
+}
+
+int local_filter(const GrayImage* src, GrayImage* dst, LocalOp op, int radius, int c) {
+    return local_filter_rows(src, dst, op, radius, c, 0, src->height);
+}
+
+const char* local_op_name(LocalOp op) {
+    switch (op) {
+    case LOCAL_MEAN: return "media";
+    case LOCAL_STDDEV: return "desvio";
+    default: return "umbral adaptativo";
+    }
+}
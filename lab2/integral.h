@@ -0,0 +1,62 @@
+// integral.h
+// Tabla de sumas acumuladas (imagen integral) sobre un plano de grises. Con ella la suma de
+// cualquier rectngulo sale de 4 lecturas, as que la media, el desvo estndar y el umbral
+// adaptativo de una ventana cuadrada cuestan lo mismo por pxel sea cual sea su radio.
+#ifndef INTEGRAL_H
+#define INTEGRAL_H
+
+#include "bmp.h"
+
+// Radio mximo de las ventanas: (2r + 1)^2 * 255 < 2^32, as que la suma de una ventana es exacta
+// en 32 bits aunque la tabla, que tambin es de 32 bits, se desborde (las restas son mdulo 2^32).
+#define INTEGRAL_MAX_RADIUS 2047
+
+// Tabla de las filas [y0, y0 + height) de una imagen: sum[t * stride + x] es la suma de los
+// pxeles de las columnas [0, x) y de las filas [y0, y0 + t). La fila y la columna 0 valen 0.
+typedef struct {
+    int width, height;  // Columnas y filas de la imagen que cubre la tabla.
+    int y0;             // Primera fila de la imagen cubierta.
+    size_t stride;      // width + 1 entradas por fila de la tabla.
+    uint32_t* sum;      // (width + 1) x (height + 1) sumas, mdulo 2^32.
+    uint64_t* sqsum;    // Igual con los cuadrados de los niveles (NULL si no se pidieron).
+} IntegralImage;
+
+// Construye la tabla de las filas [y0, y1) de src, con las sumas de cuadrados si with_squares.
+// Las sumas se calculan en paralelo por bloques de filas. Devuelve 1 o 0 (memoria).
+int integral_build(IntegralImage* ii, const GrayImage* src, int y0, int y1, int with_squares);
+
+void integral_free(IntegralImage* ii);
+
+// Suma de los niveles del rectngulo de columnas [x0, x1) y filas [y0, y1) de la imagen, que
+// deben estar dentro de las cubiertas por la tabla.
+static inline uint32_t integral_sum(const IntegralImage* ii, int x0, int y0, int x1, int y1) {
+    const uint32_t* top = ii->sum + (size_t)(y0 - ii->y0) * ii->stride;
+    const uint32_t* bottom = ii->sum + (size_t)(y1 - ii->y0) * ii->stride;
+    return bottom[x1] - bottom[x0] - top[x1] + top[x0];
+}
+
+// Igual, con los cuadrados (la tabla debe tener sqsum).
+static inline uint64_t integral_sqsum(const IntegralImage* ii, int x0, int y0, int x1, int y1) {
+    const uint64_t* top = ii->sqsum + (size_t)(y0 - ii->y0) * ii->stride;
+    const uint64_t* bottom = ii->sqsum + (size_t)(y1 - ii->y0) * ii->stride;
+    return bottom[x1] - bottom[x0] - top[x1] + top[x0];
+}
+
+// Operaciones sobre la ventana de (2 * radio + 1) x (2 * radio + 1) centrada en cada pxel. En los
+// bordes la ventana se recorta a la imagen y se promedia solo lo que queda adentro.
+typedef enum {
+    LOCAL_MEAN,       // Media redondeada: desenfoque de caja de cualquier radio.
+    LOCAL_STDDEV,     // Desvo estndar redondeado.
+    LOCAL_THRESHOLD   // Umbral adaptativo: 255 si el pxel es mayor que la media - c, 0 si no.
+} LocalOp;
+
+// Aplica op con el radio dado (0 a INTEGRAL_MAX_RADIUS) de src en dst (mismo tamao, ya reservada).
+// c solo se usa en LOCAL_THRESHOLD. Devuelve 1 si tuvo xito, 0 si el radio no es vlido o falta memoria.
+int local_filter(const GrayImage* src, GrayImage* dst, LocalOp op, int radius, int c);
+
+// Igual, pero solo escribe las filas [y0, y1) de dst (la tabla cubre solo las filas que hacen falta).
+int local_filter_rows(const GrayImage* src, GrayImage* dst, LocalOp op, int radius, int c, int y0, int y1);
+
+const char* local_op_name(LocalOp op);
+
+#endif
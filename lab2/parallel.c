@@ -0,0 +1,129 @@
+// parallel.c
+// Implementacin del motor de bandas con pthreads. Cada llamada crea los hilos, que toman
+// bandas de un contador compartido (el hilo que llama tambin trabaja) y se unen al final.
+
+#include "parallel.h"
+#include <stdlib.h>     // Para getenv, atoi, malloc, free
+#include <pthread.h>    // Para pthread_create, pthread_join, pthread_mutex_t
+#ifdef _WIN32
+#include <windows.h>    // Para GetSystemInfo
+#else
+#include <unistd.h>     // Para sysconf
+#include <time.h>       // Para clock_gettime
+#endif
+
+#define BAND_CACHE_BYTES (256 * 1024) // Bytes de entrada por banda: aproximadamente la cach L2.
+#define BANDS_PER_THREAD 4            // Bandas mnimas por hilo para balancear la carga.
+
+static int num_threads = 0;
+static __thread int inside_band = 0; // 1 mientras este hilo ejecuta una banda de parallel_rows.
+
+static int online_cpus(void) {
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return si.dwNumberOfProcessors > 0 ? (int)si.dwNumberOfProcessors : 1;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+int parallel_threads(void) {
+    if (num_threads <= 0) {
+        const char* env = getenv("LAB2_THREADS");
+        int n = env ? atoi(env) : 0;
+        num_threads = n > 0 ? n : online_cpus();
+    }
+    return num_threads;
+}
+
+void parallel_set_threads(int n) {
+    num_threads = n > 0 ? n : 0;
+}
+
+double wall_seconds(void) {
+#ifdef _WIN32
+    LARGE_INTEGER freq, now;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (double)now.QuadPart / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
+
+int parallel_band_rows(int height, size_t row_bytes) {
+    size_t rows = BAND_CACHE_BYTES / (row_bytes > 0 ? row_bytes : 1);
+    if (rows < 1) rows = 1;
+    // Con imgenes chicas se achican las bandas para que todos los hilos tengan trabajo.
+    int nt = parallel_threads();
+    size_t balanced = ((size_t)height + (size_t)nt * BANDS_PER_THREAD - 1) / ((size_t)nt * BANDS_PER_THREAD);
+    if (balanced >= 1 && balanced < rows) rows = balanced;
+    return rows > (size_t)height && height > 0 ? height : (int)rows;
+}
+
+// Cola de bandas compartida por los hilos de una llamada a parallel_rows.
+typedef struct {
+    BandFn fn;
+    void* ctx;
+    int end;                  // Fin (exclusivo) de las filas a procesar.
+    int band_rows;
+    int next;                 // Primera fila de la prxima banda libre.
+    pthread_mutex_t lock;
+} BandQueue;
+
+static void* band_worker(void* arg) {
+    BandQueue* q = (BandQueue*)arg;
+    while (1) {
+        pthread_mutex_lock(&q->lock);
+        int y0 = q->next;
+        if (y0 < q->end) q->next += q->band_rows;
+        pthread_mutex_unlock(&q->lock);
+        if (y0 >= q->end) break;
+        int y1 = y0 + q->band_rows < q->end ? y0 + q->band_rows : q->end;
+        int outer = inside_band;
+        inside_band = 1;
+        q->fn(q->ctx, y0, y1);
+        inside_band = outer;
+    }
+    return NULL;
+}
+
+void parallel_rows(int height, int band_rows, BandFn fn, void* ctx) {
+    parallel_rows_range(0, height, band_rows, fn, ctx);
+}
+
+void parallel_rows_range(int y0, int y1, int band_rows, BandFn fn, void* ctx) {
+    if (y1 <= y0) return;
+    if (band_rows < 1) band_rows = 1;
+    int bands = (y1 - y0 + band_rows - 1) / band_rows;
+    int nt = parallel_threads();
+    if (nt > bands) nt = bands;
+    // Dentro de una banda (por ejemplo, un filtro aplicado a un bloque de la cadena de operaciones)
+    // ya estn ocupados todos los hilos: la llamada anidada se ejecuta en el hilo actual.
+    if (inside_band) nt = 1;
+
+    BandQueue q;
+    q.fn = fn;
+    q.ctx = ctx;
+    q.end = y1;
+    q.band_rows = band_rows;
+    q.next = y0;
+    pthread_mutex_init(&q.lock, NULL);
+
+    // El hilo actual es uno de los nt trabajadores; si no se pueden crear hilos, hace todo solo.
+    pthread_t* threads = nt > 1 ? (pthread_t*)malloc(sizeof(pthread_t) * (nt - 1)) : NULL;
+    int created = 0;
+    for (int i = 0; threads && i < nt - 1; i++)
+        if (pthread_create(&threads[created], NULL, band_worker, &q) == 0)
+            created++;
+    band_worker(&q);
+    for (int i = 0; i < created; i++)
+        pthread_join(threads[i], NULL);
+
+    free(threads);
+    pthread_mutex_destroy(&q.lock);
+}
@@ -0,0 +1,34 @@
+// parallel.h
+// Motor de ejecucin paralela por bandas de filas para los filtros del laboratorio.
+// La imagen se divide en bandas horizontales de tamao acorde a la cach; varios hilos toman
+// bandas de una cola compartida hasta agotarlas.
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stddef.h>     // Para size_t
+
+// Funcin que procesa las filas [y0, y1) de una operacin. ctx apunta a los datos de la operacin.
+typedef void (*BandFn)(void* ctx, int y0, int y1);
+
+// Cantidad de hilos a usar: LAB2_THREADS si est definida, si no la cantidad de CPU en lnea.
+int parallel_threads(void);
+
+// Fija la cantidad de hilos (<= 0 vuelve a la deteccin automtica).
+void parallel_set_threads(int n);
+
+// Reloj de pared en segundos. Para medir operaciones paralelas: clock() suma el tiempo de CPU de
+// todos los hilos.
+double wall_seconds(void);
+
+// Filas por banda para que una banda de row_bytes por fila quepa en la cach, con al menos
+// unas cuantas bandas por hilo para repartir la carga.
+int parallel_band_rows(int height, size_t row_bytes);
+
+// Ejecuta fn sobre todas las filas [0, height) en bandas de band_rows filas, en paralelo.
+// Vuelve cuando todas las bandas terminaron. Si se llama desde dentro de una banda, no crea hilos.
+void parallel_rows(int height, int band_rows, BandFn fn, void* ctx);
+
+// Igual que parallel_rows, pero solo sobre las filas [y0, y1).
+void parallel_rows_range(int y0, int y1, int band_rows, BandFn fn, void* ctx);
+
+#endif
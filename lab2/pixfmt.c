@@ -0,0 +1,339 @@
+// pixfmt.c
+// Interpretacin de los formatos de pxel de BMP y conversin de filas a BGR / BGRA.
+// Las conversiones de 8 y 32 bits, que son las habituales, tienen versin AVX2: una bsqueda en la
+// paleta con vpgatherdd y reordenamientos de bytes con vpshufb (SSE2 no tiene un shuffle de bytes,
+// as que en ese nivel se usan las versiones escalares, que ya escriben 4 bytes por pxel).
+
+#include "pixfmt.h"
+#include "filters.h"    // Para filters_simd_level
+#include <stdio.h>      // Para printf
+#include <string.h>     // Para memset, memcpy
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PIXFMT_X86 1
+#include <immintrin.h>  // Intrnsecos AVX2 (habilitados por funcin con __attribute__((target)))
+#endif
+
+#define ALPHA_OPAQUE 0xFF000000u
+
+// --- INTERPRETACIN DEL FORMATO ---
+
+static uint32_t read_u32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+// Paleta de 2^bits colores (o biClrUsed) en formato RGBQUAD (B, G, R, reservado). Empieza justo
+// despus de la cabecera de informacin, cuyo tamao es biSize.
+static int init_palette(PixelFormat* pf, const BITMAPINFOHEADER* ih, const uint8_t* extra, size_t extra_len) {
+    size_t count = ih->biClrUsed ? ih->biClrUsed : (1u << pf->bits);
+    if (count > (1u << pf->bits)) count = 1u << pf->bits;
+    size_t offset = ih->biSize - 40;
+    if (offset > extra_len || (extra_len - offset) / 4 < count) {
+        printf("La paleta del BMP est incompleta.\n");
+        return 0;
+    }
+    for (int i = 0; i < 256; i++) pf->palette[i] = ALPHA_OPAQUE; // ndices fuera de la paleta: negro.
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t* q = extra + offset + 4 * i;
+        pf->palette[i] = q[0] | (uint32_t)q[1] << 8 | (uint32_t)q[2] << 16 | ALPHA_OPAQUE;
+    }
+    pf->kind = PIX_PALETTE;
+    return 1;
+}
+
+// Mscaras en el orden B, G, R, A. Cada una debe ser un bloque de bits contiguos dentro del pxel;
+// B, G y R no pueden faltar. Si todas son de 8 bits alineadas a un byte, el pxel es un simple
+// reordenamiento de bytes (PIX_BYTES32); si no, cada canal se extrae y se escala con una tabla.
+static int init_masks(PixelFormat* pf, const uint32_t mask[4]) {
+    uint32_t limit = pf->bits == 32 ? 0xFFFFFFFFu : (1u << pf->bits) - 1;
+    int bytes = pf->bits == 32;
+    for (int c = 0; c < 4; c++) {
+        uint32_t m = mask[c];
+        if (m == 0 && c == 3) continue; // Sin alfa.
+        uint32_t run = m ? m >> __builtin_ctz(m) : 0;
+        if (m == 0 || (m & ~limit) != 0 || (run & (run + 1)) != 0) {
+            printf("Mscaras de color del BMP no soportadas.\n");
+            return 0;
+        }
+        if (run != 0xFF || __builtin_ctz(m) % 8 != 0) bytes = 0;
+    }
+    pf->has_alpha = mask[3] != 0;
+    if (bytes) {
+        pf->kind = PIX_BYTES32;
+        for (int c = 0; c < 4; c++) pf->order[c] = mask[c] ? (uint8_t)(__builtin_ctz(mask[c]) / 8) : 3;
+        return 1;
+    }
+    pf->kind = PIX_MASKS;
+    for (int c = 0; c < 4; c++) {
+        pf->mask[c] = mask[c];
+        if (mask[c] == 0) {
+            memset(pf->scale[c], 255, 256); // Sin alfa: opaco.
+            continue;
+        }
+        // Los canales de ms de 8 bits se reducen a sus 8 bits altos antes de escalar.
+        int low = __builtin_ctz(mask[c]);
+        int width = 32 - __builtin_clz(mask[c]) - low;
+        int drop = width > 8 ? width - 8 : 0;
+        uint32_t max = (1u << (width - drop)) - 1;
+        pf->shift[c] = (uint8_t)(low + drop);
+        for (uint32_t v = 0; v < 256; v++)
+            pf->scale[c][v] = (uint8_t)(v <= max ? (v * 255 + max / 2) / max : 255);
+    }
+    return 1;
+}
+
+int pixfmt_init(PixelFormat* pf, const BITMAPINFOHEADER* ih, const uint8_t* extra, size_t extra_len) {
+    memset(pf, 0, sizeof(*pf));
+    pf->bits = ih->biBitCount;
+    uint32_t comp = ih->biCompression;
+    if (comp == BMP_BI_RGB) {
+        switch (ih->biBitCount) {
+        case 24:
+            pf->kind = PIX_BGR24;
+            return 1;
+        case 1: case 4: case 8:
+            return init_palette(pf, ih, extra, extra_len);
+        case 16: {
+            const uint32_t rgb555[4] = { 0x001F, 0x03E0, 0x7C00, 0 };
+            return init_masks(pf, rgb555);
+        }
+        case 32: {
+            const uint32_t bgrx[4] = { 0x000000FF, 0x0000FF00, 0x00FF0000, 0 }; // El 4 byte no es alfa.
+            return init_masks(pf, bgrx);
+        }
+        }
+    } else if ((comp == BMP_BI_BITFIELDS || comp == BMP_BI_ALPHABITFIELDS)
+               && (ih->biBitCount == 16 || ih->biBitCount == 32)) {
+        // Las mscaras R, G, B (y A) siguen a los 40 bytes de la cabecera, ya sea fuera de ella
+        // (BITMAPINFOHEADER) o dentro (cabeceras V2 a V5). La de alfa existe desde la V3 (56 bytes).
+        int with_alpha = comp == BMP_BI_ALPHABITFIELDS || ih->biSize >= 56;
+        if (extra_len < (size_t)(with_alpha ? 16 : 12)) {
+            printf("Faltan las mscaras de color del BMP.\n");
+            return 0;
+        }
+        uint32_t mask[4] = { read_u32(extra + 8), read_u32(extra + 4), read_u32(extra),
+                             with_alpha ? read_u32(extra + 12) : 0 };
+        return init_masks(pf, mask);
+    }
+    printf("Formato BMP no soportado: %d bits, compresin %u.\n", (int)ih->biBitCount, (unsigned)comp);
+    return 0;
+}
+
+size_t pixfmt_row_bytes(const PixelFormat* pf, int width) {
+    return ((size_t)width * pf->bits + 31) / 32 * 4;
+}
+
+// --- CONVERSIONES ESCALARES ---
+
+// ndice del pxel x en una fila de 1, 4 u 8 bits (el primer pxel est en los bits altos).
+static inline unsigned palette_index(const uint8_t* src, int bits, size_t x) {
+    if (bits == 8) return src[x];
+    if (bits == 4) return (src[x >> 1] >> (x & 1 ? 0 : 4)) & 0xF;
+    return (src[x >> 3] >> (7 - (x & 7))) & 1;
+}
+
+static inline uint32_t masks_pixel(const PixelFormat* pf, uint32_t v) {
+    return pf->scale[0][(v & pf->mask[0]) >> pf->shift[0]]
+         | (uint32_t)pf->scale[1][(v & pf->mask[1]) >> pf->shift[1]] << 8
+         | (uint32_t)pf->scale[2][(v & pf->mask[2]) >> pf->shift[2]] << 16
+         | (uint32_t)pf->scale[3][(v & pf->mask[3]) >> pf->shift[3]] << 24;
+}
+
+// Pxel i del archivo como BGRA empaquetado, para los formatos distintos de 24 bits.
+static inline uint32_t file_pixel(const PixelFormat* pf, const uint8_t* src, size_t i) {
+    switch (pf->kind) {
+    case PIX_PALETTE:
+        return pf->palette[palette_index(src, pf->bits, i)];
+    case PIX_BYTES32: {
+        const uint8_t* p = src + 4 * i;
+        return p[pf->order[0]] | (uint32_t)p[pf->order[1]] << 8 | (uint32_t)p[pf->order[2]] << 16
+             | (pf->has_alpha ? (uint32_t)p[pf->order[3]] << 24 : ALPHA_OPAQUE);
+    }
+    case PIX_MASKS: {
+        uint32_t v;
+        if (pf->bits == 16) {
+            uint16_t v16;
+            memcpy(&v16, src + 2 * i, 2);
+            v = v16;
+        } else {
+            memcpy(&v, src + 4 * i, 4);
+        }
+        return masks_pixel(pf, v);
+    }
+    default: {
+        const uint8_t* p = src + 3 * i;
+        return p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | ALPHA_OPAQUE;
+    }
+    }
+}
+
+// Convierten los pxeles [i, n) de la fila src. La versin BGR escribe cada pxel con un store de
+// 4 bytes cuyo ltimo byte pisa el pxel siguiente (se corrige en la prxima iteracin); el ltimo
+// se escribe byte a byte.
+static void row_to_bgr_scalar(const PixelFormat* pf, const uint8_t* src, uint8_t* d, size_t i, size_t n) {
+    if (i >= n) return;
+    for (; i + 1 < n; i++) {
+        uint32_t v = file_pixel(pf, src, i);
+        memcpy(d + 3 * i, &v, 4);
+    }
+    uint32_t v = file_pixel(pf, src, i);
+    d[3 * i] = (uint8_t)v;
+    d[3 * i + 1] = (uint8_t)(v >> 8);
+    d[3 * i + 2] = (uint8_t)(v >> 16);
+}
+
+static void row_to_bgra_scalar(const PixelFormat* pf, const uint8_t* src, BGRA* dst, size_t i, size_t n) {
+    for (; i < n; i++) {
+        uint32_t v = file_pixel(pf, src, i);
+        memcpy(&dst[i], &v, 4);
+    }
+}
+
+#ifdef PIXFMT_X86
+// --- CONVERSIONES AVX2 ---
+// Todas procesan 8 pxeles por iteracin. Las que escriben BGR guardan 16 bytes por cada mitad de
+// 128 bits (12 tiles): los 4 de ms se pisan en la siguiente escritura, por eso el bucle se
+// detiene cuando quedan menos de 10 pxeles y el resto lo hace la versin escalar.
+
+// Compacta cada mitad [b g r a] x 4 a 12 bytes B, G, R.
+static const int8_t pack_bgr[32] = { 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                     0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1 };
+
+__attribute__((target("avx2")))
+static inline void store_bgr8(uint8_t* d, __m256i bgra) {
+    __m256i bgr = _mm256_shuffle_epi8(bgra, _mm256_loadu_si256((const __m256i*)pack_bgr));
+    _mm_storeu_si128((__m128i*)d, _mm256_castsi256_si128(bgr));
+    _mm_storeu_si128((__m128i*)(d + 12), _mm256_extracti128_si256(bgr, 1));
+}
+
+// 8 ndices -> 8 colores de la paleta con una sola instruccin de gather.
+__attribute__((target("avx2")))
+static inline __m256i palette_gather8(const uint32_t* palette, const uint8_t* src) {
+    __m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)src));
+    return _mm256_i32gather_epi32((const int*)palette, idx, 4);
+}
+
+// Mscara de vpshufb que lleva los bytes order[] de cada pxel a B, G, R, A (A = 0 si no hay alfa).
+static void bytes32_shuffle(const PixelFormat* pf, int8_t sh[32]) {
+    for (int p = 0; p < 8; p++) {
+        int base = (p % 4) * 4; // vpshufb trabaja dentro de cada mitad de 16 bytes.
+        for (int c = 0; c < 4; c++)
+            sh[4 * p + c] = (int8_t)(c < 3 || pf->has_alpha ? base + pf->order[c] : -1);
+    }
+}
+
+// Las dos devuelven cuntos pxeles convirtieron (0 si el formato no tiene versin vectorizada).
+__attribute__((target("avx2")))
+static size_t row_to_bgr_avx2(const PixelFormat* pf, const uint8_t* src, uint8_t* d, size_t n) {
+    size_t i = 0;
+    if (pf->kind == PIX_PALETTE && pf->bits == 8) {
+        for (; i + 10 <= n; i += 8) store_bgr8(d + 3 * i, palette_gather8(pf->palette, src + i));
+    } else if (pf->kind == PIX_BYTES32) {
+        int8_t sh[32];
+        bytes32_shuffle(pf, sh);
+        const __m256i order = _mm256_loadu_si256((const __m256i*)sh);
+        for (; i + 10 <= n; i += 8) {
+            __m256i v = _mm256_loadu_si256((const __m256i*)(src + 4 * i));
+            store_bgr8(d + 3 * i, _mm256_shuffle_epi8(v, order));
+        }
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t row_to_bgra_avx2(const PixelFormat* pf, const uint8_t* src, BGRA* dst, size_t n) {
+    size_t i = 0;
+    if (pf->kind == PIX_PALETTE && pf->bits == 8) {
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_si256((__m256i*)(dst + i), palette_gather8(pf->palette, src + i));
+    } else if (pf->kind == PIX_BYTES32) {
+        int8_t sh[32];
+        bytes32_shuffle(pf, sh);
+        const __m256i order = _mm256_loadu_si256((const __m256i*)sh);
+        const __m256i alpha = _mm256_set1_epi32(pf->has_alpha ? 0 : (int)ALPHA_OPAQUE);
+        for (; i + 8 <= n; i += 8) {
+            __m256i v = _mm256_loadu_si256((const __m256i*)(src + 4 * i));
+            _mm256_storeu_si256((__m256i*)(dst + i), _mm256_or_si256(_mm256_shuffle_epi8(v, order), alpha));
+        }
+    }
+    return i;
+}
+
+// BGR -> BGRA: como en la conversin a grises, cada mitad carga 4 pxeles (12 bytes) y vpshufb
+// los separa en enteros de 32 bits; el alfa se completa con un OR.
+__attribute__((target("avx2")))
+static size_t bgr_to_bgra_avx2(const uint8_t* s, BGRA* dst, size_t n) {
+    const __m256i spread = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                                            0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m256i alpha = _mm256_set1_epi32((int)ALPHA_OPAQUE);
+    size_t i = 0;
+    for (; i + 10 <= n; i += 8) { // La segunda carga llega hasta el primer byte del pxel i + 9.
+        const uint8_t* p = s + 3 * i;
+        __m128i lo = _mm_loadu_si128((const __m128i*)p);
+        __m128i hi = _mm_loadu_si128((const __m128i*)(p + 12));
+        __m256i v = _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1), spread);
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_or_si256(v, alpha));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t bgra_to_bgr_avx2(const BGRA* src, uint8_t* d, size_t n) {
+    size_t i = 0;
+    for (; i + 10 <= n; i += 8) store_bgr8(d + 3 * i, _mm256_loadu_si256((const __m256i*)(src + i)));
+    return i;
+}
+#endif
+
+// --- FUNCIONES PBLICAS ---
+
+void pixfmt_row_to_bgr(const PixelFormat* pf, const uint8_t* src, BGR* dst, size_t n) {
+    if (pf->kind == PIX_BGR24) {
+        memcpy(dst, src, n * sizeof(BGR));
+        return;
+    }
+    size_t i = 0;
+#ifdef PIXFMT_X86
+    if (filters_simd_level() >= 2) i = row_to_bgr_avx2(pf, src, (uint8_t*)dst, n);
+#endif
+    row_to_bgr_scalar(pf, src, (uint8_t*)dst, i, n);
+}
+
+void pixfmt_row_to_bgra(const PixelFormat* pf, const uint8_t* src, BGRA* dst, size_t n) {
+    if (pf->kind == PIX_BGR24) {
+        bgr_to_bgra((const BGR*)src, dst, n);
+        return;
+    }
+    size_t i = 0;
+#ifdef PIXFMT_X86
+    if (filters_simd_level() >= 2) i = row_to_bgra_avx2(pf, src, dst, n);
+#endif
+    row_to_bgra_scalar(pf, src, dst, i, n);
+}
+
+void bgr_to_bgra(const BGR* src, BGRA* dst, size_t n) {
+    size_t i = 0;
+#ifdef PIXFMT_X86
+    if (filters_simd_level() >= 2) i = bgr_to_bgra_avx2((const uint8_t*)src, dst, n);
+#endif
+    for (; i < n; i++) {
+        dst[i].b = src[i].b;
+        dst[i].g = src[i].g;
+        dst[i].r = src[i].r;
+        dst[i].a = 255;
+    }
+}
+
+void bgra_to_bgr(const BGRA* src, BGR* dst, size_t n) {
+    size_t i = 0;
+#ifdef PIXFMT_X86
+    if (filters_simd_level() >= 2) i = bgra_to_bgr_avx2(src, (uint8_t*)dst, n);
+#endif
+    for (; i < n; i++) {
+        dst[i].b = src[i].b;
+        dst[i].g = src[i].g;
+        dst[i].r = src[i].r;
+    }
+}
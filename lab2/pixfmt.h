@@ -0,0 +1,51 @@
+// pixfmt.h
+// Formatos de pxel de los BMP que se pueden leer adems del BGR de 24 bits: con paleta de 1, 4 u
+// 8 bits, de 16 bits y de 32 bits (BI_RGB o BI_BITFIELDS con mscaras). Cada fila del archivo se
+// convierte a uno de los dos formatos internos: BGR de 3 bytes o BGRA de 4 bytes alineados.
+#ifndef PIXFMT_H
+#define PIXFMT_H
+
+#include "bmp.h"
+
+// Valores de biCompression que se aceptan.
+#define BMP_BI_RGB 0
+#define BMP_BI_BITFIELDS 3
+#define BMP_BI_ALPHABITFIELDS 6
+
+typedef enum {
+    PIX_BGR24,    // B, G, R: el formato interno, las filas se usan tal como estn en el archivo.
+    PIX_PALETTE,  // ndices de 1, 4 u 8 bits en una paleta de colores.
+    PIX_BYTES32,  // 32 bits con un canal por byte (BI_RGB = B, G, R, X o mscaras de 8 bits
+                  // alineadas en cualquier orden): se reordena byte a byte.
+    PIX_MASKS     // 16 o 32 bits con mscaras arbitrarias (p. ej. 565, 555 o 10 bits por canal).
+} PixKind;
+
+struct PixelFormat {
+    PixKind kind;
+    int bits;               // Bits por pxel en el archivo.
+    int has_alpha;          // 1 si el archivo trae alfa; si no, los BGRA quedan con a = 255.
+    uint32_t palette[256];  // PIX_PALETTE: colores como BGRA empaquetado (b | g << 8 | r << 16 | a << 24).
+    uint8_t order[4];       // PIX_BYTES32: byte del pxel de origen que va a B, G, R y A.
+    uint32_t mask[4];       // PIX_MASKS: mscaras de B, G, R y A (0 = canal ausente).
+    uint8_t shift[4];       // Desplazamiento que deja cada canal en los bits bajos, ya reducido a 8 bits.
+    uint8_t scale[4][256];  // Valor del canal (hasta 8 bits) llevado a [0, 255].
+};
+typedef struct PixelFormat PixelFormat;
+
+// Interpreta el formato de un BMP. extra son los bytes del archivo que siguen a los primeros 40 de
+// la cabecera de informacin, hasta bfOffBits (all estn las mscaras y la paleta).
+// Devuelve 1 si el formato se soporta; si no, imprime el motivo y devuelve 0.
+int pixfmt_init(PixelFormat* pf, const BITMAPINFOHEADER* ih, const uint8_t* extra, size_t extra_len);
+
+// Bytes de una fila de width pxeles en el archivo, con el relleno a mltiplo de 4.
+size_t pixfmt_row_bytes(const PixelFormat* pf, int width);
+
+// Convierten n pxeles de una fila del archivo al formato interno.
+void pixfmt_row_to_bgr(const PixelFormat* pf, const uint8_t* src, BGR* dst, size_t n);
+void pixfmt_row_to_bgra(const PixelFormat* pf, const uint8_t* src, BGRA* dst, size_t n);
+
+// Conversin entre los dos formatos internos (a = 255 al pasar a BGRA; el alfa se descarta al volver).
+void bgr_to_bgra(const BGR* src, BGRA* dst, size_t n);
+void bgra_to_bgr(const BGRA* src, BGR* dst, size_t n);
+
+#endif
@@ -0,0 +1,57 @@
+// resize.h
+// Cambio de tamao por remuestreo separable: caja (promedio de rea), bilineal y Lanczos de 3
+// lbulos, con tablas de pesos por columna y por fila calculadas una sola vez por tamao.
+#ifndef RESIZE_H
+#define RESIZE_H
+
+#include "bmp.h"
+
+typedef enum {
+    RESIZE_NEAREST,   // Vecino ms cercano (un solo peso por muestra).
+    RESIZE_BOX,       // Promedio del rea que cubre cada pxel de salida (ideal para miniaturas).
+    RESIZE_BILINEAR,  // Tringulo: interpolacin lineal al agrandar, promedio ponderado al achicar.
+    RESIZE_LANCZOS    // Lanczos 3: el ms ntido, con lbulos negativos (se satura a [0, 255]).
+} ResizeFilter;
+
+// Tabla de pesos de un eje: la muestra de salida i es la suma de len[i] muestras de entrada desde
+// first[i], con los pesos w[i * taps ..] en punto fijo de bits bits (suman exactamente 1 << bits).
+typedef struct {
+    int in_n, out_n;
+    int taps;       // Pesos reservados por muestra de salida (el mximo de len).
+    int bits;       // Precisin de los pesos: la mayor que cabe en 16 bits con signo.
+    int* first;
+    int* len;
+    int16_t* w;
+} ResizeAxis;
+
+// Calcula la tabla para pasar de in_n a out_n muestras con el filtro dado. Al achicar, el filtro
+// se estira en proporcin para promediar todas las muestras que caen en cada salida.
+// Devuelve 1 o 0 (tamaos invlidos o memoria).
+int resize_axis_init(ResizeAxis* ax, int in_n, int out_n, ResizeFilter filter);
+
+void resize_axis_free(ResizeAxis* ax);
+
+// Muestras de entrada [*in0, *in1) que leen las salidas [o0, o1).
+void resize_axis_span(const ResizeAxis* ax, int o0, int o1, int* in0, int* in1);
+
+// Calcula las filas [y0, y1) de la salida con las tablas hx (columnas) y vy (filas). src apunta a
+// la fila src_y0 de la entrada, que debe incluir las filas de resize_axis_span(vy, y0, y1), y dst
+// a la fila y0 de la salida. channels es 1 (grises) o 3 (BGR). Las dos pasadas (a lo ancho y entre
+// filas) van en el orden que menos trabaja y usan SSE2/AVX2 si hay.
+// Devuelve 1 o 0 (memoria).
+int resize_rows(const ResizeAxis* hx, const ResizeAxis* vy, int channels,
+                const uint8_t* src, ptrdiff_t src_stride, int src_y0,
+                uint8_t* dst, ptrdiff_t dst_stride, int y0, int y1);
+
+// Redimensionan una imagen entera en bandas paralelas hacia un destino ya reservado: dst de
+// width x height pxeles BGR contiguos (lo que espera save_bmp24) o una imagen de grises.
+// Devuelven 1 o 0 (tamaos invlidos o memoria).
+int resize_view(const BgrView* src, BGR* dst, int width, int height, ResizeFilter filter);
+int resize_gray(const GrayImage* src, GrayImage* dst, ResizeFilter filter);
+
+const char* resize_filter_name(ResizeFilter filter);
+
+// Interpreta "nearest", "box", "bilinear" o "lanczos". Devuelve 1 si el nombre es vlido.
+int resize_filter_parse(const char* name, ResizeFilter* filter);
+
+#endif
@@ -0,0 +1,263 @@
+// stats.c
+// Histogramas por canal con reduccin en paralelo, estadsticas derivadas de ellos, umbral de
+// Otsu y tablas de ecualizacin y autocontraste.
+
+#include "stats.h"
+#include "filters.h"
+#include "parallel.h"
+#include <stdio.h>      // Para printf
+#include <stdlib.h>     // Para malloc, free
+#include <string.h>     // Para memset
+#include <math.h>       // Para sqrt
+#include <pthread.h>    // Para pthread_mutex_t
+
+// --- HISTOGRAMAS EN PARALELO ---
+// Cada banda cuenta en histogramas propios de 32 bits (una banda nunca llega a 2^32 pxeles) y al
+// terminar los suma, bajo un mutex, a los totales de 64 bits: los hilos no comparten contadores
+// mientras recorren la imagen y la suma final cuesta 1024 entradas por banda.
+// Un histograma no se vectoriza (cada pxel incrementa una posicin distinta), pero s lo que lo
+// alimenta: la luminancia de la banda sale del kernel SIMD de to_grayscale_view. Para que dos
+// pxeles seguidos con el mismo nivel no esperen uno al incremento del otro, los pxeles pares e
+// impares cuentan en copias distintas del histograma, que se suman al final de la banda.
+
+#define STATS_COPIES 2
+
+typedef struct {
+    BgrView src;            // Imagen a color (data NULL si es de grises).
+    const GrayImage* gray;  // Imagen de grises (NULL si es a color).
+    ImageStats* st;
+    pthread_mutex_t lock;
+    int failed;             // Alguna banda no pudo reservar su fila de luminancia.
+} StatsJob;
+
+// Suma al histograma h los niveles de n bytes, alternando entre las STATS_COPIES copias.
+static void count_plane(uint32_t h[STATS_COPIES][256], const uint8_t* p, size_t n) {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        h[0][p[i]]++;
+        h[1][p[i + 1]]++;
+    }
+    if (i < n) h[0][p[i]]++;
+}
+
+static void stats_band(void* ctx, int y0, int y1) {
+    StatsJob* job = (StatsJob*)ctx;
+    uint32_t h[STAT_CHANNELS][STATS_COPIES][256];
+    memset(h, 0, sizeof(h));
+    int width = job->gray ? job->gray->width : job->src.width;
+    size_t n = (size_t)width * (size_t)(y1 - y0);
+
+    if (job->gray && gray_image_is_packed(job->gray)) {
+        count_plane(h[STAT_LUMA], gray_image_row(job->gray, y0), n);
+    } else if (job->gray) {
+        for (int y = y0; y < y1; y++) count_plane(h[STAT_LUMA], gray_image_row(job->gray, y), (size_t)width);
+    } else {
+        // Luminancia de toda la banda con el kernel vectorizado (dentro de una banda no crea hilos).
+        GrayImage luma = gray_image_packed((uint8_t*)malloc(n), width, y1 - y0);
+        if (!luma.data) {
+            pthread_mutex_lock(&job->lock);
+            job->failed = 1;
+            pthread_mutex_unlock(&job->lock);
+            return;
+        }
+        BgrView band = job->src;
+        band.data = (const uint8_t*)bgr_view_row(&job->src, y0);
+        band.height = y1 - y0;
+        to_grayscale_view(&band, &luma);
+        count_plane(h[STAT_LUMA], luma.data, n);
+        free(luma.data);
+        for (int y = y0; y < y1; y++) {
+            const uint8_t* p = (const uint8_t*)bgr_view_row(&job->src, y);
+            int x = 0;
+            for (; x + 2 <= width; x += 2, p += 6) {
+                h[STAT_B][0][p[0]]++;
+                h[STAT_G][0][p[1]]++;
+                h[STAT_R][0][p[2]]++;
+                h[STAT_B][1][p[3]]++;
+                h[STAT_G][1][p[4]]++;
+                h[STAT_R][1][p[5]]++;
+            }
+            if (x < width) {
+                h[STAT_B][0][p[0]]++;
+                h[STAT_G][0][p[1]]++;
+                h[STAT_R][0][p[2]]++;
+            }
+        }
+    }
+
+    pthread_mutex_lock(&job->lock);
+    for (int c = 0; c < STAT_CHANNELS; c++)
+        for (int v = 0; v < 256; v++) job->st->hist[c][v] += (uint64_t)h[c][0][v] + h[c][1][v];
+    pthread_mutex_unlock(&job->lock);
+}
+
+// Mnimo, mximo, media, desvo y Otsu de cada canal a partir de su histograma.
+static void stats_finish(ImageStats* st) {
+    for (int c = 0; c < STAT_CHANNELS; c++) {
+        const uint64_t* h = st->hist[c];
+        double sum = 0, sq = 0;
+        st->min[c] = 255;
+        st->max[c] = 0;
+        for (int v = 0; v < 256; v++) {
+            if (!h[v]) continue;
+            if (v < st->min[c]) st->min[c] = v;
+            st->max[c] = v;
+            sum += (double)h[v] * v;
+            sq += (double)h[v] * v * v;
+        }
+        if (st->count == 0) {
+            st->min[c] = st->max[c] = 0;
+            st->mean[c] = st->stddev[c] = 0;
+        } else {
+            st->mean[c] = sum / st->count;
+            double var = sq / st->count - st->mean[c] * st->mean[c];
+            st->stddev[c] = sqrt(var > 0 ? var : 0);
+        }
+        st->otsu[c] = stats_otsu(h);
+    }
+}
+
+static int stats_run(StatsJob* job, int width, int height) {
+    memset(job->st, 0, sizeof(*job->st));
+    job->st->count = (uint64_t)(width > 0 ? width : 0) * (uint64_t)(height > 0 ? height : 0);
+    if (job->st->count) {
+        pthread_mutex_init(&job->lock, NULL);
+        // Por fila se leen los 3 bytes por pxel de entrada y se escribe 1 de luminancia.
+        parallel_rows(height, parallel_band_rows(height, (size_t)width * 4), stats_band, job);
+        pthread_mutex_destroy(&job->lock);
+        if (job->failed) return 0;
+    }
+    stats_finish(job->st);
+    return 1;
+}
+
+// --- FUNCIN stats_view ---
+int stats_view(const BgrView* src, ImageStats* st) {
+    StatsJob job;
+    memset(&job, 0, sizeof(job));
+    job.src = *src;
+    job.st = st;
+    return stats_run(&job, src->width, src->height);
+}
+
+// --- FUNCIN stats_gray ---
+int stats_gray(const GrayImage* src, ImageStats* st) {
+    StatsJob job;
+    memset(&job, 0, sizeof(job));
+    job.gray = src;
+    job.st = st;
+    if (!stats_run(&job, src->width, src->height)) return 0;
+    for (int c = STAT_B; c < STAT_LUMA; c++) {
+        memcpy(st->hist[c], st->hist[STAT_LUMA], sizeof(st->hist[c]));
+        st->min[c] = st->min[STAT_LUMA];
+        st->max[c] = st->max[STAT_LUMA];
+        st->mean[c] = st->mean[STAT_LUMA];
+        st->stddev[c] = st->stddev[STAT_LUMA];
+        st->otsu[c] = st->otsu[STAT_LUMA];
+    }
+    return 1;
+}
+
+// --- FUNCIN stats_otsu ---
+// Recorre los 256 cortes posibles manteniendo el peso y la suma de la clase baja, y se queda con
+// el que maximiza w0 * w1 * (m0 - m1)^2 (proporcional a la varianza entre clases).
+int stats_otsu(const uint64_t hist[256]) {
+    double total = 0, sum = 0;
+    int lo = -1, hi = 0;
+    for (int v = 0; v < 256; v++) {
+        total += (double)hist[v];
+        sum += (double)hist[v] * v;
+        if (hist[v]) {
+            if (lo < 0) lo = v;
+            hi = v;
+        }
+    }
+    if (lo < 0) return 128;      // Imagen vaca.
+    if (lo == hi) return lo;     // Un solo nivel: todo queda en la clase alta.
+    double w0 = 0, sum0 = 0, best = -1;
+    int best_t = hi;
+    for (int t = lo + 1; t <= hi; t++) {
+        // Clase baja: niveles [0, t).
+        w0 += (double)hist[t - 1];
+        sum0 += (double)hist[t - 1] * (t - 1);
+        double w1 = total - w0;
+        if (w0 == 0 || w1 == 0) continue;
+        double diff = sum0 / w0 - (sum - sum0) / w1;
+        double between = w0 * w1 * diff * diff;
+        if (between > best) {
+            best = between;
+            best_t = t;
+        }
+    }
+    return best_t;
+}
+
+// --- FUNCIN stats_equalize_lut ---
+// lut[v] = (cdf(v) - cdf_min) * 255 / (total - cdf_min), donde cdf_min es la frecuencia acumulada
+// del nivel ms bajo presente: as ese nivel pasa a 0 y el ms alto a 255.
+void stats_equalize_lut(const uint64_t hist[256], uint8_t lut[256]) {
+    uint64_t total = 0, cdf_min = 0;
+    for (int v = 0; v < 256; v++) {
+        if (!cdf_min && hist[v]) cdf_min = hist[v];
+        total += hist[v];
+    }
+    if (total == cdf_min) { // Vaca o de un solo nivel: no hay nada que repartir.
+        for (int v = 0; v < 256; v++) lut[v] = (uint8_t)v;
+        return;
+    }
+    uint64_t cdf = 0;
+    double scale = 255.0 / (double)(total - cdf_min);
+    for (int v = 0; v < 256; v++) {
+        cdf += hist[v];
+        lut[v] = cdf <= cdf_min ? 0 : clampi((int)((double)(cdf - cdf_min) * scale + 0.5));
+    }
+}
+
+// --- FUNCIN stats_autocontrast_lut ---
+void stats_autocontrast_lut(const uint64_t hist[256], double clip_percent, uint8_t lut[256]) {
+    uint64_t total = 0;
+    for (int v = 0; v < 256; v++) total += hist[v];
+    if (clip_percent < 0) clip_percent = 0;
+    if (clip_percent > 49) clip_percent = 49;
+    uint64_t clip = (uint64_t)((double)total * clip_percent / 100.0);
+    // lo: primer nivel con ms de clip pxeles por debajo o en l; hi: igual desde arriba.
+    int lo = 0, hi = 255;
+    uint64_t acc = 0;
+    for (lo = 0; lo < 255; lo++) {
+        acc += hist[lo];
+        if (acc > clip) break;
+    }
+    acc = 0;
+    for (hi = 255; hi > 0; hi--) {
+        acc += hist[hi];
+        if (acc > clip) break;
+    }
+    if (hi <= lo) { // Sin rango que estirar.
+        for (int v = 0; v < 256; v++) lut[v] = (uint8_t)v;
+        return;
+    }
+    for (int v = 0; v < 256; v++) lut[v] = clampi(((v - lo) * 255 + (hi - lo) / 2) / (hi - lo));
+}
+
+// --- FUNCIN stats_print ---
+void stats_print(const ImageStats* st, int is_gray) {
+    static const char* names[STAT_CHANNELS] = { "Azul", "Verde", "Rojo", "Luminancia" };
+    printf("Pixeles: %llu\n", (unsigned long long)st->count);
+    printf("%-11s %5s %5s %8s %8s %5s\n", "Canal", "Min", "Max", "Media", "Desvio", "Otsu");
+    for (int c = is_gray ? STAT_LUMA : STAT_B; c < STAT_CHANNELS; c++)
+        printf("%-11s %5d %5d %8.2f %8.2f %5d\n", names[c], st->min[c], st->max[c], st->mean[c],
+               st->stddev[c], st->otsu[c]);
+
+    // Histograma de luminancia en 16 grupos de 16 niveles, con barras proporcionales al mayor.
+    uint64_t groups[16] = { 0 }, top = 0;
+    for (int v = 0; v < 256; v++) groups[v / 16] += st->hist[STAT_LUMA][v];
+    for (int g = 0; g < 16; g++)
+        if (groups[g] > top) top = groups[g];
+    printf("\nHistograma de luminancia:\n");
+    for (int g = 0; g < 16; g++) {
+        int len = top ? (int)(groups[g] * 50 / top) : 0;
+        printf("%3d-%3d |", g * 16, g * 16 + 15);
+        for (int i = 0; i < len; i++) putchar('#');
+        printf(" %.1f%%\n", st->count ? 100.0 * (double)groups[g] / (double)st->count : 0.0);
+    }
+}
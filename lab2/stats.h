@@ -0,0 +1,41 @@
+// stats.h
+// Estadsticas de imagen: histogramas por canal y de luminancia, mnimo, mximo, media, desvo y
+// umbral de Otsu, y las tablas de ecualizacin y autocontraste que se construyen con ellos.
+#ifndef STATS_H
+#define STATS_H
+
+#include "bmp.h"
+
+// Canales de ImageStats: los tres de color y la luminancia (la misma frmula que to_grayscale).
+enum { STAT_B, STAT_G, STAT_R, STAT_LUMA, STAT_CHANNELS };
+
+typedef struct {
+    uint64_t hist[STAT_CHANNELS][256];  // Cantidad de pxeles con cada nivel.
+    uint64_t count;                     // Pxeles de la imagen.
+    int min[STAT_CHANNELS], max[STAT_CHANNELS];
+    double mean[STAT_CHANNELS], stddev[STAT_CHANNELS];
+    int otsu[STAT_CHANNELS];            // Umbral de Otsu de cada canal (ver stats_otsu).
+} ImageStats;
+
+// Calcula las estadsticas de una imagen a color (cualquier stride). Los hilos cuentan en
+// histogramas privados que se suman al final. Devuelve 1 si tuvo xito, 0 si falta memoria.
+int stats_view(const BgrView* src, ImageStats* st);
+
+// Igual para una imagen de grises: los cuatro canales quedan iguales.
+int stats_gray(const GrayImage* src, ImageStats* st);
+
+// Umbral de Otsu: el nivel t que maximiza la varianza entre las clases [0, t) y [t, 255], o sea
+// el valor para "255 si el nivel es >= t". Con un histograma de un solo nivel devuelve ese nivel.
+int stats_otsu(const uint64_t hist[256]);
+
+// Tabla de ecualizacin: cada nivel pasa a su frecuencia acumulada escalada a [0, 255].
+void stats_equalize_lut(const uint64_t hist[256], uint8_t lut[256]);
+
+// Tabla de autocontraste: estira [mn, mx] a [0, 255] ignorando clip_percent % de los pxeles
+// en cada extremo (0 usa el mnimo y el mximo exactos).
+void stats_autocontrast_lut(const uint64_t hist[256], double clip_percent, uint8_t lut[256]);
+
+// Imprime la tabla de estadsticas y un histograma de luminancia en texto.
+void stats_print(const ImageStats* st, int is_gray);
+
+#endif